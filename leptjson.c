@@ -1,10 +1,36 @@
 #include "leptjson.h"
-#include <stdio.h>      /* sprintf() */
+#include <stdio.h>      /* fwrite(), fflush() */
 #include <assert.h>     /* assert() */
 #include <stdlib.h>     /* NULL, strtod(), malloc(), realloc(), free(), strtol() */
 #include <string.h>     /* strchr() */
 #include <math.h>       /* HUGE_VAL */
-#include <errno.h>      /* errno, ERANGE */
+#include <locale.h>     /* localeconv() */
+#include <stdint.h>     /* uint64_t */
+#include <errno.h>      /* errno, EINTR */
+#include <limits.h>     /* UINT_MAX */
+#if defined(_WIN32)
+#include <io.h>         /* _write() */
+#define LEPT_WRITE_FD(fd, buf, len)     _write(fd, buf, (unsigned)(len))
+#else
+#include <unistd.h>     /* write(), sysconf() */
+#include <fcntl.h>      /* open() */
+#include <sys/mman.h>   /* mmap() */
+#include <sys/stat.h>   /* fstat() */
+#define LEPT_WRITE_FD(fd, buf, len)     write(fd, buf, len)
+#endif
+
+#if !defined(LEPT_NO_THREADS) && !defined(_WIN32)
+#define LEPT_THREADS 1
+#include <pthread.h>
+#endif
+
+#if !defined(LEPT_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define LEPT_SIMD_X86 1
+#include <immintrin.h>  /* SSE2, AVX2 */
+#elif !defined(LEPT_NO_SIMD) && defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define LEPT_SIMD_ARM 1
+#include <arm_neon.h>
+#endif
 
 #ifndef LEPT_PARSE_STACK_INIT_SIZE
 #define LEPT_PARSE_STACK_INIT_SIZE 256
@@ -14,29 +40,277 @@
 #define LEPT_PARSE_STRINGIFY_INIT_SIZE 256
 #endif
 
+#ifndef LEPT_OBJECT_INDEX_THRESHOLD
+#define LEPT_OBJECT_INDEX_THRESHOLD 16  /* objects with at least this capacity are hash indexed */
+#endif
+
+#ifndef LEPT_NDJSON_CHUNK_SIZE
+#define LEPT_NDJSON_CHUNK_SIZE (1 << 20)    /* the largest unit of work for a thread, NDJSON or array elements */
+#endif
+
+#ifndef LEPT_ARENA_BLOCK_SIZE
+#define LEPT_ARENA_BLOCK_SIZE 16384
+#endif
+
+/* Storage flags of lept_value */
+#define LEPT_VALUE_BORROWED         0x01    /* string, elements or members are not owned (arena, in situ) */
+#define LEPT_VALUE_KEYS_BORROWED    0x02    /* member keys of an object are not owned */
+#define LEPT_VALUE_LAZY             0x04    /* an array or object not parsed yet, u.s is its span of the text */
+#define LEPT_VALUE_INLINE           0x08    /* a short string in u.b, see LEPT_STRING() */
+
+/*
+ * The size of a string, array or object, and the capacity of the storage of an array or object.
+ * A compact value keeps a 32-bit size beside its payload and the capacity in a header in front of the
+ * elements or members, see lept_set_array_storage().
+ */
+#ifdef LEPT_COMPACT
+typedef union {
+    size_t capacity;
+    double n;       /* aligns the elements that follow */
+    void *p;
+} lept_storage_header;
+#define LEPT_STORAGE_HEADER_SIZE    sizeof(lept_storage_header)
+#define LEPT_SIZE_MAX               ((size_t)UINT_MAX)
+#define LEPT_ARRAY_SIZE(v)          ((v)->size)
+#define LEPT_OBJECT_SIZE(v)         ((v)->size)
+#define LEPT_SPAN_LEN(v)            ((v)->size)     /* heap or borrowed string, or the text of a lazy value */
+#define LEPT_ARRAY_CAPACITY(v)      lept_storage_capacity((v)->u.a.e)
+#define LEPT_OBJECT_CAPACITY(v)     lept_storage_capacity((v)->u.o.m)
+#else
+#define LEPT_STORAGE_HEADER_SIZE    0
+#define LEPT_SIZE_MAX               ((size_t)-1)
+#define LEPT_ARRAY_SIZE(v)          ((v)->u.a.size)
+#define LEPT_OBJECT_SIZE(v)         ((v)->u.o.size)
+#define LEPT_SPAN_LEN(v)            ((v)->u.s.len)
+#define LEPT_ARRAY_CAPACITY(v)      ((v)->u.a.capacity)
+#define LEPT_OBJECT_CAPACITY(v)     ((v)->u.o.capacity)
+#endif
+
+/* Bytes of storage for the elements of an array */
+#define LEPT_ARRAY_STORAGE_SIZE(capacity)   (LEPT_STORAGE_HEADER_SIZE + (capacity) * sizeof(lept_value))
+
+/* The block to free or reallocate for the elements or members p */
+static void* lept_storage_block(void *p) {
+    return p != NULL ? (char *)p - LEPT_STORAGE_HEADER_SIZE : NULL;
+}
+
+#ifdef LEPT_COMPACT
+static size_t lept_storage_capacity(const void *p) {
+    return p != NULL ? ((const lept_storage_header *)p - 1)->capacity : 0;
+}
+
+/* The elements or members in a block of storage for capacity of them, recording the capacity */
+static void* lept_storage_data(void *block, size_t capacity) {
+    if (block == NULL)
+        return NULL;
+    ((lept_storage_header *)block)->capacity = capacity;
+    return (lept_storage_header *)block + 1;
+}
+
+#define lept_set_array_storage(v, block, n) \
+    ((v)->u.a.e = (lept_value *)lept_storage_data(block, n))
+#define lept_set_object_storage(v, block, n) \
+    ((v)->u.o.m = (lept_member *)lept_storage_data(block, n))
+#else
+/* Points an array at a block of LEPT_ARRAY_STORAGE_SIZE(n) bytes */
+#define lept_set_array_storage(v, block, n) \
+    ((v)->u.a.e = (lept_value *)(block), (v)->u.a.capacity = (n))
+/* Points an object at a block of lept_object_storage_size(n) bytes */
+#define lept_set_object_storage(v, block, n) \
+    ((v)->u.o.m = (lept_member *)(block), (v)->u.o.capacity = (n))
+#endif
+
+/*
+ * A short string fills u.b: its last byte holds the unused capacity, which becomes the null terminator
+ * of a string of the full capacity.
+ */
+#define LEPT_STRING_INLINE_MAX  (sizeof(((lept_value *)0)->u.b) - 1)
+#define LEPT_STRING(v)          ((v)->flags & LEPT_VALUE_INLINE ? (v)->u.b : (v)->u.s.s)
+#define LEPT_STRING_LEN(v)      ((v)->flags & LEPT_VALUE_INLINE ? \
+    LEPT_STRING_INLINE_MAX - (unsigned char)(v)->u.b[LEPT_STRING_INLINE_MAX] : LEPT_SPAN_LEN(v))
+
+/* A key shorter than LEPT_KEY_INLINE_SIZE is stored in the member, whatever the storage of the object */
+#define LEPT_KEY_INLINE(klen)   ((klen) < LEPT_KEY_INLINE_SIZE)
+#define LEPT_KEY(m)             (LEPT_KEY_INLINE((m)->klen) ? (m)->k.s : (m)->k.p)
+
+/* Accessors expand lazy values, which does not change them logically, hence the cast */
+#define LEPT_EXPAND(v)      do { if ((v)->flags & LEPT_VALUE_LAZY) lept_expand((lept_value *)(v)); } while(0)
+
 #define EXPECT(c, ch)       do { assert(*c->json == (ch)); c->json++; } while(0)
 #define ISDIGIT(ch)         ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)     ((ch) >= '1' && (ch) <= '9')
 #define PUT(c, ch)          do { *((char *)lept_context_push((c), sizeof(char))) = (ch); } while(0)
 #define PUTS(c, s, len)     memcpy(lept_context_push(c, len), s, len)
+#define PEEK(c)             ((c)->json != (c)->end ? *(c)->json : '\0')   /* the end reads as '\0' */
+
+typedef struct lept_parallel_job lept_parallel_job;
+typedef struct lept_projection lept_projection;
 
 /* The JSON parsing context, i.e. the position where we currently parse */
 typedef struct {
     const char* json;
+    const char *end;        /* end of the JSON text, which need not be null-terminated */
     char *stack;
     size_t size, top;
+    lept_arena *arena;      /* if not NULL, the parsed tree is allocated from it */
+    int insitu;             /* strings are unescaped in place, json is writable */
+    const lept_handler *handler;    /* if not NULL, values are reported to it instead of being built */
+    void *sax_ctx;          /* user context of the handler */
+    unsigned flags;         /* LEPT_PARSE_* flags */
+    const char *base;       /* start of the JSON text */
+    uint64_t *index;        /* structural index of the text, see lept_build_structural_index() */
+    int lazy;               /* nested arrays and objects are only skipped, see lept_parse_lazy() */
+    int split_depth;        /* if > 0, the elements of arrays at this depth are left to lept_parallel_job */
+    lept_parallel_job *split;
+    const lept_projection *projection;  /* if not NULL, only the selected paths are parsed */
+    lept_symtab *symtab;    /* if not NULL, member keys are interned into it */
+    size_t depth;           /* open arrays and objects */
+    size_t max_depth;       /* a deeper one fails with LEPT_PARSE_DEPTH_EXCEEDED */
 }lept_context;
 
+typedef union { double d; void *p; size_t s; long l; } lept_arena_align;
+
+#define LEPT_ARENA_ALIGN(size)      (((size) + sizeof(lept_arena_align) - 1) & ~(sizeof(lept_arena_align) - 1))
+#define LEPT_ARENA_BLOCK_DATA(b)    ((char *)(b) + LEPT_ARENA_ALIGN(sizeof(lept_arena_block)))
+
+struct lept_arena_block {
+    lept_arena_block *next;     /* next older block */
+    size_t size, used;          /* capacity and used bytes of the data following the header */
+};
+
+void lept_arena_init(lept_arena *a, size_t block_size) {
+    assert(a != NULL);
+    a->head = NULL;
+    a->block_size = block_size > 0 ? block_size : LEPT_ARENA_BLOCK_SIZE;
+}
+
+static lept_arena_block* lept_arena_new_block(size_t size) {
+    lept_arena_block *b = (lept_arena_block *)malloc(LEPT_ARENA_ALIGN(sizeof(lept_arena_block)) + size);
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+void* lept_arena_alloc(lept_arena *a, size_t size) {
+    lept_arena_block *b;
+    void *ret;
+    assert(a != NULL);
+    size = LEPT_ARENA_ALIGN(size);
+    if (a->head != NULL && a->head->size - a->head->used >= size)
+        b = a->head;
+    else if (size > a->block_size / 4) {
+        /* a large request gets a block of its own, linked behind the head to keep its free space */
+        b = lept_arena_new_block(size);
+        if (a->head != NULL) {
+            b->next = a->head->next;
+            a->head->next = b;
+        }
+        else
+            a->head = b;
+    }
+    else {
+        b = lept_arena_new_block(a->block_size);
+        b->next = a->head;
+        a->head = b;
+    }
+    ret = LEPT_ARENA_BLOCK_DATA(b) + b->used;
+    b->used += size;
+    return ret;
+}
+
+/* Releases everything allocated from the arena, one regular block is kept for reuse */
+void lept_arena_reset(lept_arena *a) {
+    lept_arena_block *b, *keep = NULL;
+    assert(a != NULL);
+    for (b = a->head; b != NULL; ) {
+        lept_arena_block *next = b->next;
+        if (keep == NULL && b->size == a->block_size) {
+            keep = b;
+            keep->next = NULL;
+            keep->used = 0;
+        }
+        else
+            free(b);
+        b = next;
+    }
+    a->head = keep;
+}
+
+void lept_arena_free(lept_arena *a) {
+    lept_arena_reset(a);
+    free(a->head);
+    a->head = NULL;
+}
+
+/* Moves all blocks of src into a, the memory allocated from src is released with a */
+static void lept_arena_merge(lept_arena *a, lept_arena *src) {
+    lept_arena_block *tail = src->head;
+    if (tail == NULL)
+        return;
+    while (tail->next != NULL)
+        tail = tail->next;
+    /* behind the head of a, which keeps serving allocations */
+    if (a->head != NULL) {
+        tail->next = a->head->next;
+        a->head->next = src->head;
+    }
+    else
+        a->head = src->head;
+    src->head = NULL;
+}
+
+/* Allocates memory for the parsed tree, the caller marks the value borrowed if c->arena is set */
+static void* lept_context_alloc(lept_context *c, size_t size) {
+    return c->arena != NULL ? lept_arena_alloc(c->arena, size) : malloc(size);
+}
+
+/* Makes v a string stored in place, len is at most LEPT_STRING_INLINE_MAX */
+static void lept_set_inline_string(lept_value *v, const char *s, size_t len) {
+    if (len > 0)
+        memcpy(v->u.b, s, len);
+    v->u.b[len] = '\0';
+    v->u.b[LEPT_STRING_INLINE_MAX] = (char)(LEPT_STRING_INLINE_MAX - len);
+    v->type = LEPT_STRING;
+    v->flags = LEPT_VALUE_INLINE;
+}
+
+/* Copies key into m, in place if it is short or else to the heap */
+static void lept_member_copy_key(lept_member *m, const char *key, size_t klen) {
+    char *k = LEPT_KEY_INLINE(klen) ? m->k.s : (m->k.p = (char *)malloc(klen + 1));
+    if (klen > 0)
+        memcpy(k, key, klen);
+    k[klen] = '\0';
+    m->klen = klen;
+}
+
+/* Frees the key of a member whose object owns its keys */
+static void lept_member_free_key(lept_member *m) {
+    if (!LEPT_KEY_INLINE(m->klen))
+        free(m->k.p);
+}
+
+#define LEPT_CONTEXT_BORROWS_STRINGS(c)     ((c)->arena != NULL || (c)->insitu)
+#define LEPT_CONTEXT_BORROWS_KEYS(c)        (LEPT_CONTEXT_BORROWS_STRINGS(c) || (c)->symtab != NULL)
+
+/* Reports an event to the handler of c, a missing callback accepts it and a callback returning 0 cancels */
+#define LEPT_SAX(c, event, args) \
+    ((c)->handler->event == NULL || (c)->handler->event args ? LEPT_PARSE_OK : LEPT_PARSE_CANCELED)
+
+/* The rare part of lept_context_push(), kept out of it so that the common part is inlined */
+static void lept_context_grow(lept_context *c, size_t size) {
+    if (c->size == 0)
+        c->size = LEPT_PARSE_STACK_INIT_SIZE;
+    while (c->top + size >= c->size)
+        c->size += c->size >> 1;
+    c->stack = (char *)realloc(c->stack, c->size);
+}
+
 static void* lept_context_push(lept_context *c, size_t size) {
     void *ret;
     assert(size > 0);
-    if (c->top + size >= c->size) {
-        if (c->size == 0)
-            c->size = LEPT_PARSE_STACK_INIT_SIZE;
-        while (c->top + size >= c->size)
-            c->size += c->size >> 1;
-        c->stack = (char *)realloc(c->stack, c->size);
-    }
+    if (c->top + size >= c->size)
+        lept_context_grow(c, size);
     ret = c->stack + c->top;
     c->top += size;
     return ret;
@@ -48,67 +322,1274 @@ static void* lept_context_pop(lept_context *c, size_t size) {
     return c->stack + c->top;
 }    
 
-/* This function skips all whitespaces in JSON text until reaching a non-space literal or the end */
-static void lept_parse_whitespace(lept_context* c) {
-    const char *p = c->json;
-    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+/*
+ * Trees are walked without recursion, e.g. by lept_copy(), lept_free(), lept_is_equal() and the writers.
+ * The containers on the path from the root are kept as frames on an explicit stack, each with the
+ * position of its next child.
+ */
+typedef struct {
+    lept_value *v;          /* the container being visited */
+    lept_value *other;      /* the source of a copy, or the other side of a comparison */
+    size_t i;               /* its next child */
+} lept_visit;
+
+static void lept_visit_push(lept_context *s, lept_value *v, const lept_value *other, size_t i) {
+    lept_visit *f = (lept_visit *)lept_context_push(s, sizeof(lept_visit));
+    f->v = v;
+    f->other = (lept_value *)other;
+    f->i = i;
+}
+
+#define ISWHITESPACE(ch)    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/* Scanners for the hot loops of the parser, each returns the first position in [p, end) that stops the scan */
+typedef const char* (*lept_scan_func)(const char *p, const char *end);
+
+static const char* lept_skip_whitespace_scalar(const char *p, const char *end) {
+    while (p != end && ISWHITESPACE(*p))
+        p++;
+    return p;
+}
+
+/* Stops at a quotation mark, a backslash or a control character, i.e. where a string run needs attention */
+static const char* lept_scan_string_scalar(const char *p, const char *end) {
+    while (p != end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
         p++;
+    return p;
+}
+
+/* Character classes of a 64-byte block for the structural index, one bit per byte */
+enum { LEPT_CLASS_QUOTE, LEPT_CLASS_BACKSLASH, LEPT_CLASS_WHITESPACE, LEPT_CLASS_STRUCTURAL };
+typedef void (*lept_classify_func)(const char *p, uint64_t m[4]);
+
+#define ISSTRUCTURAL(ch)    ((ch) == '{' || (ch) == '}' || (ch) == '[' || (ch) == ']' || (ch) == ':' || (ch) == ',')
+
+static void lept_classify_scalar(const char *p, uint64_t m[4]) {
+    int i;
+    m[0] = m[1] = m[2] = m[3] = 0;
+    for (i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        if (p[i] == '"')
+            m[LEPT_CLASS_QUOTE] |= bit;
+        else if (p[i] == '\\')
+            m[LEPT_CLASS_BACKSLASH] |= bit;
+        else if (ISWHITESPACE(p[i]))
+            m[LEPT_CLASS_WHITESPACE] |= bit;
+        else if (ISSTRUCTURAL(p[i]))
+            m[LEPT_CLASS_STRUCTURAL] |= bit;
+    }
+}
+
+#if defined(LEPT_SIMD_X86)
+static const char* lept_skip_whitespace_sse2(const char *p, const char *end) {
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(ws) ^ 0xFFFF;
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return lept_skip_whitespace_scalar(p, end);
+}
+
+static const char* lept_scan_string_sse2(const char *p, const char *end) {
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), ctrl = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(x, ctrl), ctrl));     /* x <= 0x1F */
+        unsigned mask = (unsigned)_mm_movemask_epi8(stop);
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return lept_scan_string_scalar(p, end);
+}
+
+static void lept_classify_sse2(const char *p, uint64_t m[4]) {
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    const __m128i lower = _mm_set1_epi8(0x20), curly = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+    int i;
+    m[0] = m[1] = m[2] = m[3] = 0;
+    for (i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i folded = _mm_or_si128(x, lower);   /* '[' and ']' become '{' and '}' */
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, curly), _mm_cmpeq_epi8(folded, close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, colon), _mm_cmpeq_epi8(x, comma)));
+        m[LEPT_CLASS_QUOTE] |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)) << i;
+        m[LEPT_CLASS_BACKSLASH] |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)) << i;
+        m[LEPT_CLASS_WHITESPACE] |= (uint64_t)(unsigned)_mm_movemask_epi8(ws) << i;
+        m[LEPT_CLASS_STRUCTURAL] |= (uint64_t)(unsigned)_mm_movemask_epi8(op) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+static const char* lept_skip_whitespace_avx2(const char *p, const char *end) {
+    const __m256i sp = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(x, lf), _mm256_cmpeq_epi8(x, cr)));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(ws);
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return lept_skip_whitespace_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* lept_scan_string_avx2(const char *p, const char *end) {
+    const __m256i quote = _mm256_set1_epi8('"'), backslash = _mm256_set1_epi8('\\'), ctrl = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i stop = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+                                       _mm256_cmpeq_epi8(_mm256_max_epu8(x, ctrl), ctrl));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(stop);
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return lept_scan_string_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static void lept_classify_avx2(const char *p, uint64_t m[4]) {
+    const __m256i quote = _mm256_set1_epi8('"'), backslash = _mm256_set1_epi8('\\');
+    const __m256i sp = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    const __m256i lower = _mm256_set1_epi8(0x20), curly = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':'), comma = _mm256_set1_epi8(',');
+    int i;
+    m[0] = m[1] = m[2] = m[3] = 0;
+    for (i = 0; i < 64; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i folded = _mm256_or_si256(x, lower);
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(x, lf), _mm256_cmpeq_epi8(x, cr)));
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, curly), _mm256_cmpeq_epi8(folded, close)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(x, colon), _mm256_cmpeq_epi8(x, comma)));
+        m[LEPT_CLASS_QUOTE] |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, quote)) << i;
+        m[LEPT_CLASS_BACKSLASH] |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, backslash)) << i;
+        m[LEPT_CLASS_WHITESPACE] |= (uint64_t)(unsigned)_mm256_movemask_epi8(ws) << i;
+        m[LEPT_CLASS_STRUCTURAL] |= (uint64_t)(unsigned)_mm256_movemask_epi8(op) << i;
+    }
+}
+#elif defined(LEPT_SIMD_ARM)
+static const char* lept_skip_whitespace_neon(const char *p, const char *end) {
+    const uint8x16_t sp = vdupq_n_u8(' '), tab = vdupq_n_u8('\t');
+    const uint8x16_t lf = vdupq_n_u8('\n'), cr = vdupq_n_u8('\r');
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t x = vld1q_u8((const unsigned char *)p);
+        uint8x16_t ws = vorrq_u8(vorrq_u8(vceqq_u8(x, sp), vceqq_u8(x, tab)),
+                                 vorrq_u8(vceqq_u8(x, lf), vceqq_u8(x, cr)));
+        /* narrow each byte of the mask to 4 bits, then find the first non-whitespace nibble */
+        uint64_t mask = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(ws), 4)), 0);
+        if (mask != 0)
+            return p + (__builtin_ctzll(mask) >> 2);
+    }
+    return lept_skip_whitespace_scalar(p, end);
+}
+
+static const char* lept_scan_string_neon(const char *p, const char *end) {
+    const uint8x16_t quote = vdupq_n_u8('"'), backslash = vdupq_n_u8('\\'), space = vdupq_n_u8(0x20);
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t x = vld1q_u8((const unsigned char *)p);
+        uint8x16_t stop = vorrq_u8(vorrq_u8(vceqq_u8(x, quote), vceqq_u8(x, backslash)), vcltq_u8(x, space));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(stop), 4)), 0);
+        if (mask != 0)
+            return p + (__builtin_ctzll(mask) >> 2);
+    }
+    return lept_scan_string_scalar(p, end);
+}
+
+/* One bit per byte of a comparison result, the bytes are weighted and summed pairwise */
+static unsigned lept_movemask_neon(uint8x16_t x) {
+    static const unsigned char weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t t = vandq_u8(x, vld1q_u8(weights));
+    uint8x8_t sum = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+    sum = vpadd_u8(sum, sum);
+    sum = vpadd_u8(sum, sum);
+    return vget_lane_u16(vreinterpret_u16_u8(sum), 0);
+}
+
+static void lept_classify_neon(const char *p, uint64_t m[4]) {
+    const uint8x16_t quote = vdupq_n_u8('"'), backslash = vdupq_n_u8('\\');
+    const uint8x16_t sp = vdupq_n_u8(' '), tab = vdupq_n_u8('\t');
+    const uint8x16_t lf = vdupq_n_u8('\n'), cr = vdupq_n_u8('\r');
+    const uint8x16_t lower = vdupq_n_u8(0x20), curly = vdupq_n_u8('{'), close = vdupq_n_u8('}');
+    const uint8x16_t colon = vdupq_n_u8(':'), comma = vdupq_n_u8(',');
+    int i;
+    m[0] = m[1] = m[2] = m[3] = 0;
+    for (i = 0; i < 64; i += 16) {
+        uint8x16_t x = vld1q_u8((const unsigned char *)p + i);
+        uint8x16_t folded = vorrq_u8(x, lower);
+        uint8x16_t ws = vorrq_u8(vorrq_u8(vceqq_u8(x, sp), vceqq_u8(x, tab)),
+                                 vorrq_u8(vceqq_u8(x, lf), vceqq_u8(x, cr)));
+        uint8x16_t op = vorrq_u8(vorrq_u8(vceqq_u8(folded, curly), vceqq_u8(folded, close)),
+                                 vorrq_u8(vceqq_u8(x, colon), vceqq_u8(x, comma)));
+        m[LEPT_CLASS_QUOTE] |= (uint64_t)lept_movemask_neon(vceqq_u8(x, quote)) << i;
+        m[LEPT_CLASS_BACKSLASH] |= (uint64_t)lept_movemask_neon(vceqq_u8(x, backslash)) << i;
+        m[LEPT_CLASS_WHITESPACE] |= (uint64_t)lept_movemask_neon(ws) << i;
+        m[LEPT_CLASS_STRUCTURAL] |= (uint64_t)lept_movemask_neon(op) << i;
+    }
+}
+#endif
+
+/* The implementations chosen by lept_set_simd(), resolved on first use by lept_simd_resolve() */
+static struct {
+    lept_simd simd;
+    lept_scan_func skip_whitespace;
+    lept_scan_func scan_string;
+    lept_classify_func classify;
+} lept_simd_impl = { LEPT_SIMD_AUTO, NULL, NULL, NULL };
+
+static lept_simd lept_simd_best(void) {
+#if defined(LEPT_SIMD_X86)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? LEPT_SIMD_AVX2 : LEPT_SIMD_SSE2;
+#elif defined(LEPT_SIMD_ARM)
+    return LEPT_SIMD_NEON;
+#else
+    return LEPT_SIMD_SCALAR;
+#endif
+}
+
+/* Points the implementations at simd, returns 0 if it is not supported by this build or CPU */
+static int lept_simd_use(lept_simd simd) {
+    lept_simd best = lept_simd_best();
+    if (simd == LEPT_SIMD_AUTO)
+        simd = best;
+    switch (simd) {
+        case LEPT_SIMD_SCALAR:
+            lept_simd_impl.skip_whitespace = lept_skip_whitespace_scalar;
+            lept_simd_impl.scan_string = lept_scan_string_scalar;
+            lept_simd_impl.classify = lept_classify_scalar;
+            break;
+#if defined(LEPT_SIMD_X86)
+        case LEPT_SIMD_SSE2:
+            lept_simd_impl.skip_whitespace = lept_skip_whitespace_sse2;
+            lept_simd_impl.scan_string = lept_scan_string_sse2;
+            lept_simd_impl.classify = lept_classify_sse2;
+            break;
+        case LEPT_SIMD_AVX2:
+            if (best != LEPT_SIMD_AVX2)
+                return 0;
+            lept_simd_impl.skip_whitespace = lept_skip_whitespace_avx2;
+            lept_simd_impl.scan_string = lept_scan_string_avx2;
+            lept_simd_impl.classify = lept_classify_avx2;
+            break;
+#elif defined(LEPT_SIMD_ARM)
+        case LEPT_SIMD_NEON:
+            lept_simd_impl.skip_whitespace = lept_skip_whitespace_neon;
+            lept_simd_impl.scan_string = lept_scan_string_neon;
+            lept_simd_impl.classify = lept_classify_neon;
+            break;
+#endif
+        default:
+            return 0;       /* not supported by this build or CPU */
+    }
+    lept_simd_impl.simd = simd;
+    return 1;
+}
+
+static void lept_simd_init(void) {
+    lept_simd_use(LEPT_SIMD_AUTO);
+}
+
+/* The default is resolved once, threads parsing for the first time at the same moment may all ask for it */
+#if defined(LEPT_THREADS)
+static pthread_once_t lept_simd_once = PTHREAD_ONCE_INIT;
+
+static void lept_simd_resolve(void) {
+    pthread_once(&lept_simd_once, lept_simd_init);
+}
+#else
+static void lept_simd_resolve(void) {
+    if (lept_simd_impl.simd == LEPT_SIMD_AUTO)
+        lept_simd_init();
+}
+#endif
+
+int lept_set_simd(lept_simd simd) {
+    lept_simd_resolve();    /* a later first use must not undo this choice */
+    return lept_simd_use(simd);
+}
+
+lept_simd lept_get_simd(void) {
+    lept_simd_resolve();
+    return lept_simd_impl.simd;
+}
+
+static int lept_ctz64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/*
+ * Stage 1 of the two-stage parser: a bitmap of the structural characters, the opening quotation marks
+ * and the first characters of numbers and literals outside strings, which are the tokens stage 2 walks
+ * in lept_parse_indexed(). A sentinel bit marks the end of the text.
+ */
+static uint64_t* lept_build_structural_index(const char *json, size_t len) {
+    size_t words = len / 64 + 1, i;
+    uint64_t *index = (uint64_t *)malloc(words * sizeof(uint64_t));
+    uint64_t m[4], escaped, backslash, quotes, string, boundary;
+    uint64_t prev_escape = 0, prev_string = 0, prev_boundary = 1;   /* carried over from the previous block */
+    char tail[64];
+    lept_simd_resolve();
+    for (i = 0; i < words; i++) {
+        const char *block = json + i * 64;
+        if (len - i * 64 < 64) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, len - i * 64);
+            block = tail;
+        }
+        lept_simd_impl.classify(block, m);
+
+        /* a backslash escapes the next character unless it is escaped itself, backslashes are rare */
+        escaped = prev_escape;
+        backslash = m[LEPT_CLASS_BACKSLASH] & ~prev_escape;
+        prev_escape = 0;
+        while (backslash != 0) {
+            uint64_t bit = backslash & (0 - backslash);
+            if (bit >> 63)
+                prev_escape = 1;
+            else {
+                escaped |= bit << 1;
+                backslash &= ~(bit << 1);
+            }
+            backslash ^= bit;
+        }
+
+        /* prefix xor of the quotation marks: set from an opening one up to, excluding, the closing one */
+        quotes = m[LEPT_CLASS_QUOTE] & ~escaped;
+        string = quotes ^ (quotes << 1);
+        string ^= string << 2;
+        string ^= string << 4;
+        string ^= string << 8;
+        string ^= string << 16;
+        string ^= string << 32;
+        string ^= prev_string;
+        prev_string = 0 - (string >> 63);
+
+        boundary = (m[LEPT_CLASS_STRUCTURAL] | m[LEPT_CLASS_WHITESPACE] | quotes) & ~string;
+        index[i] = (m[LEPT_CLASS_STRUCTURAL] & ~string) | (quotes & string) |
+                   (~(m[LEPT_CLASS_STRUCTURAL] | m[LEPT_CLASS_WHITESPACE] | quotes) & ~string &
+                    ((boundary << 1) | prev_boundary));
+        prev_boundary = boundary >> 63;
+    }
+    index[len / 64] |= (uint64_t)1 << (len % 64);
+    return index;
+}
+
+/* The next position of the index in order, bits holds the positions of index[*w] not taken yet */
+static size_t lept_structural_pop(const uint64_t *index, size_t *w, uint64_t *bits) {
+    size_t pos;
+    while (*bits == 0)
+        *bits = index[++*w];
+    pos = (*w << 6) + lept_ctz64(*bits);
+    *bits &= *bits - 1;
+    return pos;
+}
+
+/* Skips a run of whitespace at c, which starts with a whitespace character */
+static void lept_skip_whitespace(lept_context* c) {
+    const char *p = c->json + 1;
+    /* most runs are a single space, which is not worth a vector load */
+    if (p != c->end && ISWHITESPACE(*p))
+        p = lept_simd_impl.skip_whitespace(p, c->end);
     c->json = p;    /* update the JSON parsing context */
 }
 
+/* This function skips all whitespaces in JSON text until reaching a non-space literal or the end */
+static void lept_parse_whitespace(lept_context* c) {
+    /* most runs are empty, this test is small enough to be inlined into every caller */
+    if (c->json != c->end && ISWHITESPACE(*c->json))
+        lept_skip_whitespace(c);
+}
+
 /* This function parses JSON true or false or null value in a JSON text */
 static int lept_parse_literal(lept_context *c, lept_value *v, const char *literal, lept_type type) {
     size_t i = 0;
     EXPECT(c, literal[0]);
     for (i = 1; literal[i] != '\0'; ++i) {
-        if (*c->json != literal[i])
+        if (PEEK(c) != literal[i])
             return LEPT_PARSE_INVALID_VALUE;
         c->json++;
     }
+    if (c->handler != NULL)
+        return type == LEPT_NULL ? LEPT_SAX(c, null, (c->sax_ctx))
+                                 : LEPT_SAX(c, boolean, (c->sax_ctx, type == LEPT_TRUE));
     v->type = type;
     return LEPT_PARSE_OK;
 }
 
+#define PEEK_AT(p, end)     ((p) != (end) ? *(p) : '\0')
+
+/*
+ * Decimal to binary conversion of numbers: Clinger's fast path for small exact operands,
+ * otherwise the Eisel-Lemire algorithm, and strtod() only for inputs with more than 19
+ * significant digits whose rounding cannot be decided from the first 19.
+ */
+
+#define LEPT_POW5_MIN_EXP   (-342)
+#define LEPT_POW5_MAX_EXP   308
+
+static const double lept_pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* The 128 most significant bits of 5^q for q in [LEPT_POW5_MIN_EXP, LEPT_POW5_MAX_EXP] */
+static const uint64_t lept_pow5_128[][2] = {
+    { UINT64_C(0xeef453d6923bd65a), UINT64_C(0x113faa2906a13b3f) },
+    { UINT64_C(0x9558b4661b6565f8), UINT64_C(0x4ac7ca59a424c507) },
+    { UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x5d79bcf00d2df649) },
+    { UINT64_C(0xe95a99df8ace6f53), UINT64_C(0xf4d82c2c107973dc) },
+    { UINT64_C(0x91d8a02bb6c10594), UINT64_C(0x79071b9b8a4be869) },
+    { UINT64_C(0xb64ec836a47146f9), UINT64_C(0x9748e2826cdee284) },
+    { UINT64_C(0xe3e27a444d8d98b7), UINT64_C(0xfd1b1b2308169b25) },
+    { UINT64_C(0x8e6d8c6ab0787f72), UINT64_C(0xfe30f0f5e50e20f7) },
+    { UINT64_C(0xb208ef855c969f4f), UINT64_C(0xbdbd2d335e51a935) },
+    { UINT64_C(0xde8b2b66b3bc4723), UINT64_C(0xad2c788035e61382) },
+    { UINT64_C(0x8b16fb203055ac76), UINT64_C(0x4c3bcb5021afcc31) },
+    { UINT64_C(0xaddcb9e83c6b1793), UINT64_C(0xdf4abe242a1bbf3d) },
+    { UINT64_C(0xd953e8624b85dd78), UINT64_C(0xd71d6dad34a2af0d) },
+    { UINT64_C(0x87d4713d6f33aa6b), UINT64_C(0x8672648c40e5ad68) },
+    { UINT64_C(0xa9c98d8ccb009506), UINT64_C(0x680efdaf511f18c2) },
+    { UINT64_C(0xd43bf0effdc0ba48), UINT64_C(0x0212bd1b2566def2) },
+    { UINT64_C(0x84a57695fe98746d), UINT64_C(0x014bb630f7604b57) },
+    { UINT64_C(0xa5ced43b7e3e9188), UINT64_C(0x419ea3bd35385e2d) },
+    { UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x52064cac828675b9) },
+    { UINT64_C(0x818995ce7aa0e1b2), UINT64_C(0x7343efebd1940993) },
+    { UINT64_C(0xa1ebfb4219491a1f), UINT64_C(0x1014ebe6c5f90bf8) },
+    { UINT64_C(0xca66fa129f9b60a6), UINT64_C(0xd41a26e077774ef6) },
+    { UINT64_C(0xfd00b897478238d0), UINT64_C(0x8920b098955522b4) },
+    { UINT64_C(0x9e20735e8cb16382), UINT64_C(0x55b46e5f5d5535b0) },
+    { UINT64_C(0xc5a890362fddbc62), UINT64_C(0xeb2189f734aa831d) },
+    { UINT64_C(0xf712b443bbd52b7b), UINT64_C(0xa5e9ec7501d523e4) },
+    { UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0x47b233c92125366e) },
+    { UINT64_C(0xc1069cd4eabe89f8), UINT64_C(0x999ec0bb696e840a) },
+    { UINT64_C(0xf148440a256e2c76), UINT64_C(0xc00670ea43ca250d) },
+    { UINT64_C(0x96cd2a865764dbca), UINT64_C(0x380406926a5e5728) },
+    { UINT64_C(0xbc807527ed3e12bc), UINT64_C(0xc605083704f5ecf2) },
+    { UINT64_C(0xeba09271e88d976b), UINT64_C(0xf7864a44c633682e) },
+    { UINT64_C(0x93445b8731587ea3), UINT64_C(0x7ab3ee6afbe0211d) },
+    { UINT64_C(0xb8157268fdae9e4c), UINT64_C(0x5960ea05bad82964) },
+    { UINT64_C(0xe61acf033d1a45df), UINT64_C(0x6fb92487298e33bd) },
+    { UINT64_C(0x8fd0c16206306bab), UINT64_C(0xa5d3b6d479f8e056) },
+    { UINT64_C(0xb3c4f1ba87bc8696), UINT64_C(0x8f48a4899877186c) },
+    { UINT64_C(0xe0b62e2929aba83c), UINT64_C(0x331acdabfe94de87) },
+    { UINT64_C(0x8c71dcd9ba0b4925), UINT64_C(0x9ff0c08b7f1d0b14) },
+    { UINT64_C(0xaf8e5410288e1b6f), UINT64_C(0x07ecf0ae5ee44dd9) },
+    { UINT64_C(0xdb71e91432b1a24a), UINT64_C(0xc9e82cd9f69d6150) },
+    { UINT64_C(0x892731ac9faf056e), UINT64_C(0xbe311c083a225cd2) },
+    { UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0x6dbd630a48aaf406) },
+    { UINT64_C(0xd64d3d9db981787d), UINT64_C(0x092cbbccdad5b108) },
+    { UINT64_C(0x85f0468293f0eb4e), UINT64_C(0x25bbf56008c58ea5) },
+    { UINT64_C(0xa76c582338ed2621), UINT64_C(0xaf2af2b80af6f24e) },
+    { UINT64_C(0xd1476e2c07286faa), UINT64_C(0x1af5af660db4aee1) },
+    { UINT64_C(0x82cca4db847945ca), UINT64_C(0x50d98d9fc890ed4d) },
+    { UINT64_C(0xa37fce126597973c), UINT64_C(0xe50ff107bab528a0) },
+    { UINT64_C(0xcc5fc196fefd7d0c), UINT64_C(0x1e53ed49a96272c8) },
+    { UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0x25e8e89c13bb0f7a) },
+    { UINT64_C(0x9faacf3df73609b1), UINT64_C(0x77b191618c54e9ac) },
+    { UINT64_C(0xc795830d75038c1d), UINT64_C(0xd59df5b9ef6a2417) },
+    { UINT64_C(0xf97ae3d0d2446f25), UINT64_C(0x4b0573286b44ad1d) },
+    { UINT64_C(0x9becce62836ac577), UINT64_C(0x4ee367f9430aec32) },
+    { UINT64_C(0xc2e801fb244576d5), UINT64_C(0x229c41f793cda73f) },
+    { UINT64_C(0xf3a20279ed56d48a), UINT64_C(0x6b43527578c1110f) },
+    { UINT64_C(0x9845418c345644d6), UINT64_C(0x830a13896b78aaa9) },
+    { UINT64_C(0xbe5691ef416bd60c), UINT64_C(0x23cc986bc656d553) },
+    { UINT64_C(0xedec366b11c6cb8f), UINT64_C(0x2cbfbe86b7ec8aa8) },
+    { UINT64_C(0x94b3a202eb1c3f39), UINT64_C(0x7bf7d71432f3d6a9) },
+    { UINT64_C(0xb9e08a83a5e34f07), UINT64_C(0xdaf5ccd93fb0cc53) },
+    { UINT64_C(0xe858ad248f5c22c9), UINT64_C(0xd1b3400f8f9cff68) },
+    { UINT64_C(0x91376c36d99995be), UINT64_C(0x23100809b9c21fa1) },
+    { UINT64_C(0xb58547448ffffb2d), UINT64_C(0xabd40a0c2832a78a) },
+    { UINT64_C(0xe2e69915b3fff9f9), UINT64_C(0x16c90c8f323f516c) },
+    { UINT64_C(0x8dd01fad907ffc3b), UINT64_C(0xae3da7d97f6792e3) },
+    { UINT64_C(0xb1442798f49ffb4a), UINT64_C(0x99cd11cfdf41779c) },
+    { UINT64_C(0xdd95317f31c7fa1d), UINT64_C(0x40405643d711d583) },
+    { UINT64_C(0x8a7d3eef7f1cfc52), UINT64_C(0x482835ea666b2572) },
+    { UINT64_C(0xad1c8eab5ee43b66), UINT64_C(0xda3243650005eecf) },
+    { UINT64_C(0xd863b256369d4a40), UINT64_C(0x90bed43e40076a82) },
+    { UINT64_C(0x873e4f75e2224e68), UINT64_C(0x5a7744a6e804a291) },
+    { UINT64_C(0xa90de3535aaae202), UINT64_C(0x711515d0a205cb36) },
+    { UINT64_C(0xd3515c2831559a83), UINT64_C(0x0d5a5b44ca873e03) },
+    { UINT64_C(0x8412d9991ed58091), UINT64_C(0xe858790afe9486c2) },
+    { UINT64_C(0xa5178fff668ae0b6), UINT64_C(0x626e974dbe39a872) },
+    { UINT64_C(0xce5d73ff402d98e3), UINT64_C(0xfb0a3d212dc8128f) },
+    { UINT64_C(0x80fa687f881c7f8e), UINT64_C(0x7ce66634bc9d0b99) },
+    { UINT64_C(0xa139029f6a239f72), UINT64_C(0x1c1fffc1ebc44e80) },
+    { UINT64_C(0xc987434744ac874e), UINT64_C(0xa327ffb266b56220) },
+    { UINT64_C(0xfbe9141915d7a922), UINT64_C(0x4bf1ff9f0062baa8) },
+    { UINT64_C(0x9d71ac8fada6c9b5), UINT64_C(0x6f773fc3603db4a9) },
+    { UINT64_C(0xc4ce17b399107c22), UINT64_C(0xcb550fb4384d21d3) },
+    { UINT64_C(0xf6019da07f549b2b), UINT64_C(0x7e2a53a146606a48) },
+    { UINT64_C(0x99c102844f94e0fb), UINT64_C(0x2eda7444cbfc426d) },
+    { UINT64_C(0xc0314325637a1939), UINT64_C(0xfa911155fefb5308) },
+    { UINT64_C(0xf03d93eebc589f88), UINT64_C(0x793555ab7eba27ca) },
+    { UINT64_C(0x96267c7535b763b5), UINT64_C(0x4bc1558b2f3458de) },
+    { UINT64_C(0xbbb01b9283253ca2), UINT64_C(0x9eb1aaedfb016f16) },
+    { UINT64_C(0xea9c227723ee8bcb), UINT64_C(0x465e15a979c1cadc) },
+    { UINT64_C(0x92a1958a7675175f), UINT64_C(0x0bfacd89ec191ec9) },
+    { UINT64_C(0xb749faed14125d36), UINT64_C(0xcef980ec671f667b) },
+    { UINT64_C(0xe51c79a85916f484), UINT64_C(0x82b7e12780e7401a) },
+    { UINT64_C(0x8f31cc0937ae58d2), UINT64_C(0xd1b2ecb8b0908810) },
+    { UINT64_C(0xb2fe3f0b8599ef07), UINT64_C(0x861fa7e6dcb4aa15) },
+    { UINT64_C(0xdfbdcece67006ac9), UINT64_C(0x67a791e093e1d49a) },
+    { UINT64_C(0x8bd6a141006042bd), UINT64_C(0xe0c8bb2c5c6d24e0) },
+    { UINT64_C(0xaecc49914078536d), UINT64_C(0x58fae9f773886e18) },
+    { UINT64_C(0xda7f5bf590966848), UINT64_C(0xaf39a475506a899e) },
+    { UINT64_C(0x888f99797a5e012d), UINT64_C(0x6d8406c952429603) },
+    { UINT64_C(0xaab37fd7d8f58178), UINT64_C(0xc8e5087ba6d33b83) },
+    { UINT64_C(0xd5605fcdcf32e1d6), UINT64_C(0xfb1e4a9a90880a64) },
+    { UINT64_C(0x855c3be0a17fcd26), UINT64_C(0x5cf2eea09a55067f) },
+    { UINT64_C(0xa6b34ad8c9dfc06f), UINT64_C(0xf42faa48c0ea481e) },
+    { UINT64_C(0xd0601d8efc57b08b), UINT64_C(0xf13b94daf124da26) },
+    { UINT64_C(0x823c12795db6ce57), UINT64_C(0x76c53d08d6b70858) },
+    { UINT64_C(0xa2cb1717b52481ed), UINT64_C(0x54768c4b0c64ca6e) },
+    { UINT64_C(0xcb7ddcdda26da268), UINT64_C(0xa9942f5dcf7dfd09) },
+    { UINT64_C(0xfe5d54150b090b02), UINT64_C(0xd3f93b35435d7c4c) },
+    { UINT64_C(0x9efa548d26e5a6e1), UINT64_C(0xc47bc5014a1a6daf) },
+    { UINT64_C(0xc6b8e9b0709f109a), UINT64_C(0x359ab6419ca1091b) },
+    { UINT64_C(0xf867241c8cc6d4c0), UINT64_C(0xc30163d203c94b62) },
+    { UINT64_C(0x9b407691d7fc44f8), UINT64_C(0x79e0de63425dcf1d) },
+    { UINT64_C(0xc21094364dfb5636), UINT64_C(0x985915fc12f542e4) },
+    { UINT64_C(0xf294b943e17a2bc4), UINT64_C(0x3e6f5b7b17b2939d) },
+    { UINT64_C(0x979cf3ca6cec5b5a), UINT64_C(0xa705992ceecf9c42) },
+    { UINT64_C(0xbd8430bd08277231), UINT64_C(0x50c6ff782a838353) },
+    { UINT64_C(0xece53cec4a314ebd), UINT64_C(0xa4f8bf5635246428) },
+    { UINT64_C(0x940f4613ae5ed136), UINT64_C(0x871b7795e136be99) },
+    { UINT64_C(0xb913179899f68584), UINT64_C(0x28e2557b59846e3f) },
+    { UINT64_C(0xe757dd7ec07426e5), UINT64_C(0x331aeada2fe589cf) },
+    { UINT64_C(0x9096ea6f3848984f), UINT64_C(0x3ff0d2c85def7621) },
+    { UINT64_C(0xb4bca50b065abe63), UINT64_C(0x0fed077a756b53a9) },
+    { UINT64_C(0xe1ebce4dc7f16dfb), UINT64_C(0xd3e8495912c62894) },
+    { UINT64_C(0x8d3360f09cf6e4bd), UINT64_C(0x64712dd7abbbd95c) },
+    { UINT64_C(0xb080392cc4349dec), UINT64_C(0xbd8d794d96aacfb3) },
+    { UINT64_C(0xdca04777f541c567), UINT64_C(0xecf0d7a0fc5583a0) },
+    { UINT64_C(0x89e42caaf9491b60), UINT64_C(0xf41686c49db57244) },
+    { UINT64_C(0xac5d37d5b79b6239), UINT64_C(0x311c2875c522ced5) },
+    { UINT64_C(0xd77485cb25823ac7), UINT64_C(0x7d633293366b828b) },
+    { UINT64_C(0x86a8d39ef77164bc), UINT64_C(0xae5dff9c02033197) },
+    { UINT64_C(0xa8530886b54dbdeb), UINT64_C(0xd9f57f830283fdfc) },
+    { UINT64_C(0xd267caa862a12d66), UINT64_C(0xd072df63c324fd7b) },
+    { UINT64_C(0x8380dea93da4bc60), UINT64_C(0x4247cb9e59f71e6d) },
+    { UINT64_C(0xa46116538d0deb78), UINT64_C(0x52d9be85f074e608) },
+    { UINT64_C(0xcd795be870516656), UINT64_C(0x67902e276c921f8b) },
+    { UINT64_C(0x806bd9714632dff6), UINT64_C(0x00ba1cd8a3db53b6) },
+    { UINT64_C(0xa086cfcd97bf97f3), UINT64_C(0x80e8a40eccd228a4) },
+    { UINT64_C(0xc8a883c0fdaf7df0), UINT64_C(0x6122cd128006b2cd) },
+    { UINT64_C(0xfad2a4b13d1b5d6c), UINT64_C(0x796b805720085f81) },
+    { UINT64_C(0x9cc3a6eec6311a63), UINT64_C(0xcbe3303674053bb0) },
+    { UINT64_C(0xc3f490aa77bd60fc), UINT64_C(0xbedbfc4411068a9c) },
+    { UINT64_C(0xf4f1b4d515acb93b), UINT64_C(0xee92fb5515482d44) },
+    { UINT64_C(0x991711052d8bf3c5), UINT64_C(0x751bdd152d4d1c4a) },
+    { UINT64_C(0xbf5cd54678eef0b6), UINT64_C(0xd262d45a78a0635d) },
+    { UINT64_C(0xef340a98172aace4), UINT64_C(0x86fb897116c87c34) },
+    { UINT64_C(0x9580869f0e7aac0e), UINT64_C(0xd45d35e6ae3d4da0) },
+    { UINT64_C(0xbae0a846d2195712), UINT64_C(0x8974836059cca109) },
+    { UINT64_C(0xe998d258869facd7), UINT64_C(0x2bd1a438703fc94b) },
+    { UINT64_C(0x91ff83775423cc06), UINT64_C(0x7b6306a34627ddcf) },
+    { UINT64_C(0xb67f6455292cbf08), UINT64_C(0x1a3bc84c17b1d542) },
+    { UINT64_C(0xe41f3d6a7377eeca), UINT64_C(0x20caba5f1d9e4a93) },
+    { UINT64_C(0x8e938662882af53e), UINT64_C(0x547eb47b7282ee9c) },
+    { UINT64_C(0xb23867fb2a35b28d), UINT64_C(0xe99e619a4f23aa43) },
+    { UINT64_C(0xdec681f9f4c31f31), UINT64_C(0x6405fa00e2ec94d4) },
+    { UINT64_C(0x8b3c113c38f9f37e), UINT64_C(0xde83bc408dd3dd04) },
+    { UINT64_C(0xae0b158b4738705e), UINT64_C(0x9624ab50b148d445) },
+    { UINT64_C(0xd98ddaee19068c76), UINT64_C(0x3badd624dd9b0957) },
+    { UINT64_C(0x87f8a8d4cfa417c9), UINT64_C(0xe54ca5d70a80e5d6) },
+    { UINT64_C(0xa9f6d30a038d1dbc), UINT64_C(0x5e9fcf4ccd211f4c) },
+    { UINT64_C(0xd47487cc8470652b), UINT64_C(0x7647c3200069671f) },
+    { UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0x29ecd9f40041e073) },
+    { UINT64_C(0xa5fb0a17c777cf09), UINT64_C(0xf468107100525890) },
+    { UINT64_C(0xcf79cc9db955c2cc), UINT64_C(0x7182148d4066eeb4) },
+    { UINT64_C(0x81ac1fe293d599bf), UINT64_C(0xc6f14cd848405530) },
+    { UINT64_C(0xa21727db38cb002f), UINT64_C(0xb8ada00e5a506a7c) },
+    { UINT64_C(0xca9cf1d206fdc03b), UINT64_C(0xa6d90811f0e4851c) },
+    { UINT64_C(0xfd442e4688bd304a), UINT64_C(0x908f4a166d1da663) },
+    { UINT64_C(0x9e4a9cec15763e2e), UINT64_C(0x9a598e4e043287fe) },
+    { UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x40eff1e1853f29fd) },
+    { UINT64_C(0xf7549530e188c128), UINT64_C(0xd12bee59e68ef47c) },
+    { UINT64_C(0x9a94dd3e8cf578b9), UINT64_C(0x82bb74f8301958ce) },
+    { UINT64_C(0xc13a148e3032d6e7), UINT64_C(0xe36a52363c1faf01) },
+    { UINT64_C(0xf18899b1bc3f8ca1), UINT64_C(0xdc44e6c3cb279ac1) },
+    { UINT64_C(0x96f5600f15a7b7e5), UINT64_C(0x29ab103a5ef8c0b9) },
+    { UINT64_C(0xbcb2b812db11a5de), UINT64_C(0x7415d448f6b6f0e7) },
+    { UINT64_C(0xebdf661791d60f56), UINT64_C(0x111b495b3464ad21) },
+    { UINT64_C(0x936b9fcebb25c995), UINT64_C(0xcab10dd900beec34) },
+    { UINT64_C(0xb84687c269ef3bfb), UINT64_C(0x3d5d514f40eea742) },
+    { UINT64_C(0xe65829b3046b0afa), UINT64_C(0x0cb4a5a3112a5112) },
+    { UINT64_C(0x8ff71a0fe2c2e6dc), UINT64_C(0x47f0e785eaba72ab) },
+    { UINT64_C(0xb3f4e093db73a093), UINT64_C(0x59ed216765690f56) },
+    { UINT64_C(0xe0f218b8d25088b8), UINT64_C(0x306869c13ec3532c) },
+    { UINT64_C(0x8c974f7383725573), UINT64_C(0x1e414218c73a13fb) },
+    { UINT64_C(0xafbd2350644eeacf), UINT64_C(0xe5d1929ef90898fa) },
+    { UINT64_C(0xdbac6c247d62a583), UINT64_C(0xdf45f746b74abf39) },
+    { UINT64_C(0x894bc396ce5da772), UINT64_C(0x6b8bba8c328eb783) },
+    { UINT64_C(0xab9eb47c81f5114f), UINT64_C(0x066ea92f3f326564) },
+    { UINT64_C(0xd686619ba27255a2), UINT64_C(0xc80a537b0efefebd) },
+    { UINT64_C(0x8613fd0145877585), UINT64_C(0xbd06742ce95f5f36) },
+    { UINT64_C(0xa798fc4196e952e7), UINT64_C(0x2c48113823b73704) },
+    { UINT64_C(0xd17f3b51fca3a7a0), UINT64_C(0xf75a15862ca504c5) },
+    { UINT64_C(0x82ef85133de648c4), UINT64_C(0x9a984d73dbe722fb) },
+    { UINT64_C(0xa3ab66580d5fdaf5), UINT64_C(0xc13e60d0d2e0ebba) },
+    { UINT64_C(0xcc963fee10b7d1b3), UINT64_C(0x318df905079926a8) },
+    { UINT64_C(0xffbbcfe994e5c61f), UINT64_C(0xfdf17746497f7052) },
+    { UINT64_C(0x9fd561f1fd0f9bd3), UINT64_C(0xfeb6ea8bedefa633) },
+    { UINT64_C(0xc7caba6e7c5382c8), UINT64_C(0xfe64a52ee96b8fc0) },
+    { UINT64_C(0xf9bd690a1b68637b), UINT64_C(0x3dfdce7aa3c673b0) },
+    { UINT64_C(0x9c1661a651213e2d), UINT64_C(0x06bea10ca65c084e) },
+    { UINT64_C(0xc31bfa0fe5698db8), UINT64_C(0x486e494fcff30a62) },
+    { UINT64_C(0xf3e2f893dec3f126), UINT64_C(0x5a89dba3c3efccfa) },
+    { UINT64_C(0x986ddb5c6b3a76b7), UINT64_C(0xf89629465a75e01c) },
+    { UINT64_C(0xbe89523386091465), UINT64_C(0xf6bbb397f1135823) },
+    { UINT64_C(0xee2ba6c0678b597f), UINT64_C(0x746aa07ded582e2c) },
+    { UINT64_C(0x94db483840b717ef), UINT64_C(0xa8c2a44eb4571cdc) },
+    { UINT64_C(0xba121a4650e4ddeb), UINT64_C(0x92f34d62616ce413) },
+    { UINT64_C(0xe896a0d7e51e1566), UINT64_C(0x77b020baf9c81d17) },
+    { UINT64_C(0x915e2486ef32cd60), UINT64_C(0x0ace1474dc1d122e) },
+    { UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x0d819992132456ba) },
+    { UINT64_C(0xe3231912d5bf60e6), UINT64_C(0x10e1fff697ed6c69) },
+    { UINT64_C(0x8df5efabc5979c8f), UINT64_C(0xca8d3ffa1ef463c1) },
+    { UINT64_C(0xb1736b96b6fd83b3), UINT64_C(0xbd308ff8a6b17cb2) },
+    { UINT64_C(0xddd0467c64bce4a0), UINT64_C(0xac7cb3f6d05ddbde) },
+    { UINT64_C(0x8aa22c0dbef60ee4), UINT64_C(0x6bcdf07a423aa96b) },
+    { UINT64_C(0xad4ab7112eb3929d), UINT64_C(0x86c16c98d2c953c6) },
+    { UINT64_C(0xd89d64d57a607744), UINT64_C(0xe871c7bf077ba8b7) },
+    { UINT64_C(0x87625f056c7c4a8b), UINT64_C(0x11471cd764ad4972) },
+    { UINT64_C(0xa93af6c6c79b5d2d), UINT64_C(0xd598e40d3dd89bcf) },
+    { UINT64_C(0xd389b47879823479), UINT64_C(0x4aff1d108d4ec2c3) },
+    { UINT64_C(0x843610cb4bf160cb), UINT64_C(0xcedf722a585139ba) },
+    { UINT64_C(0xa54394fe1eedb8fe), UINT64_C(0xc2974eb4ee658828) },
+    { UINT64_C(0xce947a3da6a9273e), UINT64_C(0x733d226229feea32) },
+    { UINT64_C(0x811ccc668829b887), UINT64_C(0x0806357d5a3f525f) },
+    { UINT64_C(0xa163ff802a3426a8), UINT64_C(0xca07c2dcb0cf26f7) },
+    { UINT64_C(0xc9bcff6034c13052), UINT64_C(0xfc89b393dd02f0b5) },
+    { UINT64_C(0xfc2c3f3841f17c67), UINT64_C(0xbbac2078d443ace2) },
+    { UINT64_C(0x9d9ba7832936edc0), UINT64_C(0xd54b944b84aa4c0d) },
+    { UINT64_C(0xc5029163f384a931), UINT64_C(0x0a9e795e65d4df11) },
+    { UINT64_C(0xf64335bcf065d37d), UINT64_C(0x4d4617b5ff4a16d5) },
+    { UINT64_C(0x99ea0196163fa42e), UINT64_C(0x504bced1bf8e4e45) },
+    { UINT64_C(0xc06481fb9bcf8d39), UINT64_C(0xe45ec2862f71e1d6) },
+    { UINT64_C(0xf07da27a82c37088), UINT64_C(0x5d767327bb4e5a4c) },
+    { UINT64_C(0x964e858c91ba2655), UINT64_C(0x3a6a07f8d510f86f) },
+    { UINT64_C(0xbbe226efb628afea), UINT64_C(0x890489f70a55368b) },
+    { UINT64_C(0xeadab0aba3b2dbe5), UINT64_C(0x2b45ac74ccea842e) },
+    { UINT64_C(0x92c8ae6b464fc96f), UINT64_C(0x3b0b8bc90012929d) },
+    { UINT64_C(0xb77ada0617e3bbcb), UINT64_C(0x09ce6ebb40173744) },
+    { UINT64_C(0xe55990879ddcaabd), UINT64_C(0xcc420a6a101d0515) },
+    { UINT64_C(0x8f57fa54c2a9eab6), UINT64_C(0x9fa946824a12232d) },
+    { UINT64_C(0xb32df8e9f3546564), UINT64_C(0x47939822dc96abf9) },
+    { UINT64_C(0xdff9772470297ebd), UINT64_C(0x59787e2b93bc56f7) },
+    { UINT64_C(0x8bfbea76c619ef36), UINT64_C(0x57eb4edb3c55b65a) },
+    { UINT64_C(0xaefae51477a06b03), UINT64_C(0xede622920b6b23f1) },
+    { UINT64_C(0xdab99e59958885c4), UINT64_C(0xe95fab368e45eced) },
+    { UINT64_C(0x88b402f7fd75539b), UINT64_C(0x11dbcb0218ebb414) },
+    { UINT64_C(0xaae103b5fcd2a881), UINT64_C(0xd652bdc29f26a119) },
+    { UINT64_C(0xd59944a37c0752a2), UINT64_C(0x4be76d3346f0495f) },
+    { UINT64_C(0x857fcae62d8493a5), UINT64_C(0x6f70a4400c562ddb) },
+    { UINT64_C(0xa6dfbd9fb8e5b88e), UINT64_C(0xcb4ccd500f6bb952) },
+    { UINT64_C(0xd097ad07a71f26b2), UINT64_C(0x7e2000a41346a7a7) },
+    { UINT64_C(0x825ecc24c873782f), UINT64_C(0x8ed400668c0c28c8) },
+    { UINT64_C(0xa2f67f2dfa90563b), UINT64_C(0x728900802f0f32fa) },
+    { UINT64_C(0xcbb41ef979346bca), UINT64_C(0x4f2b40a03ad2ffb9) },
+    { UINT64_C(0xfea126b7d78186bc), UINT64_C(0xe2f610c84987bfa8) },
+    { UINT64_C(0x9f24b832e6b0f436), UINT64_C(0x0dd9ca7d2df4d7c9) },
+    { UINT64_C(0xc6ede63fa05d3143), UINT64_C(0x91503d1c79720dbb) },
+    { UINT64_C(0xf8a95fcf88747d94), UINT64_C(0x75a44c6397ce912a) },
+    { UINT64_C(0x9b69dbe1b548ce7c), UINT64_C(0xc986afbe3ee11aba) },
+    { UINT64_C(0xc24452da229b021b), UINT64_C(0xfbe85badce996168) },
+    { UINT64_C(0xf2d56790ab41c2a2), UINT64_C(0xfae27299423fb9c3) },
+    { UINT64_C(0x97c560ba6b0919a5), UINT64_C(0xdccd879fc967d41a) },
+    { UINT64_C(0xbdb6b8e905cb600f), UINT64_C(0x5400e987bbc1c920) },
+    { UINT64_C(0xed246723473e3813), UINT64_C(0x290123e9aab23b68) },
+    { UINT64_C(0x9436c0760c86e30b), UINT64_C(0xf9a0b6720aaf6521) },
+    { UINT64_C(0xb94470938fa89bce), UINT64_C(0xf808e40e8d5b3e69) },
+    { UINT64_C(0xe7958cb87392c2c2), UINT64_C(0xb60b1d1230b20e04) },
+    { UINT64_C(0x90bd77f3483bb9b9), UINT64_C(0xb1c6f22b5e6f48c2) },
+    { UINT64_C(0xb4ecd5f01a4aa828), UINT64_C(0x1e38aeb6360b1af3) },
+    { UINT64_C(0xe2280b6c20dd5232), UINT64_C(0x25c6da63c38de1b0) },
+    { UINT64_C(0x8d590723948a535f), UINT64_C(0x579c487e5a38ad0e) },
+    { UINT64_C(0xb0af48ec79ace837), UINT64_C(0x2d835a9df0c6d851) },
+    { UINT64_C(0xdcdb1b2798182244), UINT64_C(0xf8e431456cf88e65) },
+    { UINT64_C(0x8a08f0f8bf0f156b), UINT64_C(0x1b8e9ecb641b58ff) },
+    { UINT64_C(0xac8b2d36eed2dac5), UINT64_C(0xe272467e3d222f3f) },
+    { UINT64_C(0xd7adf884aa879177), UINT64_C(0x5b0ed81dcc6abb0f) },
+    { UINT64_C(0x86ccbb52ea94baea), UINT64_C(0x98e947129fc2b4e9) },
+    { UINT64_C(0xa87fea27a539e9a5), UINT64_C(0x3f2398d747b36224) },
+    { UINT64_C(0xd29fe4b18e88640e), UINT64_C(0x8eec7f0d19a03aad) },
+    { UINT64_C(0x83a3eeeef9153e89), UINT64_C(0x1953cf68300424ac) },
+    { UINT64_C(0xa48ceaaab75a8e2b), UINT64_C(0x5fa8c3423c052dd7) },
+    { UINT64_C(0xcdb02555653131b6), UINT64_C(0x3792f412cb06794d) },
+    { UINT64_C(0x808e17555f3ebf11), UINT64_C(0xe2bbd88bbee40bd0) },
+    { UINT64_C(0xa0b19d2ab70e6ed6), UINT64_C(0x5b6aceaeae9d0ec4) },
+    { UINT64_C(0xc8de047564d20a8b), UINT64_C(0xf245825a5a445275) },
+    { UINT64_C(0xfb158592be068d2e), UINT64_C(0xeed6e2f0f0d56712) },
+    { UINT64_C(0x9ced737bb6c4183d), UINT64_C(0x55464dd69685606b) },
+    { UINT64_C(0xc428d05aa4751e4c), UINT64_C(0xaa97e14c3c26b886) },
+    { UINT64_C(0xf53304714d9265df), UINT64_C(0xd53dd99f4b3066a8) },
+    { UINT64_C(0x993fe2c6d07b7fab), UINT64_C(0xe546a8038efe4029) },
+    { UINT64_C(0xbf8fdb78849a5f96), UINT64_C(0xde98520472bdd033) },
+    { UINT64_C(0xef73d256a5c0f77c), UINT64_C(0x963e66858f6d4440) },
+    { UINT64_C(0x95a8637627989aad), UINT64_C(0xdde7001379a44aa8) },
+    { UINT64_C(0xbb127c53b17ec159), UINT64_C(0x5560c018580d5d52) },
+    { UINT64_C(0xe9d71b689dde71af), UINT64_C(0xaab8f01e6e10b4a6) },
+    { UINT64_C(0x9226712162ab070d), UINT64_C(0xcab3961304ca70e8) },
+    { UINT64_C(0xb6b00d69bb55c8d1), UINT64_C(0x3d607b97c5fd0d22) },
+    { UINT64_C(0xe45c10c42a2b3b05), UINT64_C(0x8cb89a7db77c506a) },
+    { UINT64_C(0x8eb98a7a9a5b04e3), UINT64_C(0x77f3608e92adb242) },
+    { UINT64_C(0xb267ed1940f1c61c), UINT64_C(0x55f038b237591ed3) },
+    { UINT64_C(0xdf01e85f912e37a3), UINT64_C(0x6b6c46dec52f6688) },
+    { UINT64_C(0x8b61313bbabce2c6), UINT64_C(0x2323ac4b3b3da015) },
+    { UINT64_C(0xae397d8aa96c1b77), UINT64_C(0xabec975e0a0d081a) },
+    { UINT64_C(0xd9c7dced53c72255), UINT64_C(0x96e7bd358c904a21) },
+    { UINT64_C(0x881cea14545c7575), UINT64_C(0x7e50d64177da2e54) },
+    { UINT64_C(0xaa242499697392d2), UINT64_C(0xdde50bd1d5d0b9e9) },
+    { UINT64_C(0xd4ad2dbfc3d07787), UINT64_C(0x955e4ec64b44e864) },
+    { UINT64_C(0x84ec3c97da624ab4), UINT64_C(0xbd5af13bef0b113e) },
+    { UINT64_C(0xa6274bbdd0fadd61), UINT64_C(0xecb1ad8aeacdd58e) },
+    { UINT64_C(0xcfb11ead453994ba), UINT64_C(0x67de18eda5814af2) },
+    { UINT64_C(0x81ceb32c4b43fcf4), UINT64_C(0x80eacf948770ced7) },
+    { UINT64_C(0xa2425ff75e14fc31), UINT64_C(0xa1258379a94d028d) },
+    { UINT64_C(0xcad2f7f5359a3b3e), UINT64_C(0x096ee45813a04330) },
+    { UINT64_C(0xfd87b5f28300ca0d), UINT64_C(0x8bca9d6e188853fc) },
+    { UINT64_C(0x9e74d1b791e07e48), UINT64_C(0x775ea264cf55347e) },
+    { UINT64_C(0xc612062576589dda), UINT64_C(0x95364afe032a819e) },
+    { UINT64_C(0xf79687aed3eec551), UINT64_C(0x3a83ddbd83f52205) },
+    { UINT64_C(0x9abe14cd44753b52), UINT64_C(0xc4926a9672793543) },
+    { UINT64_C(0xc16d9a0095928a27), UINT64_C(0x75b7053c0f178294) },
+    { UINT64_C(0xf1c90080baf72cb1), UINT64_C(0x5324c68b12dd6339) },
+    { UINT64_C(0x971da05074da7bee), UINT64_C(0xd3f6fc16ebca5e04) },
+    { UINT64_C(0xbce5086492111aea), UINT64_C(0x88f4bb1ca6bcf585) },
+    { UINT64_C(0xec1e4a7db69561a5), UINT64_C(0x2b31e9e3d06c32e6) },
+    { UINT64_C(0x9392ee8e921d5d07), UINT64_C(0x3aff322e62439fd0) },
+    { UINT64_C(0xb877aa3236a4b449), UINT64_C(0x09befeb9fad487c3) },
+    { UINT64_C(0xe69594bec44de15b), UINT64_C(0x4c2ebe687989a9b4) },
+    { UINT64_C(0x901d7cf73ab0acd9), UINT64_C(0x0f9d37014bf60a11) },
+    { UINT64_C(0xb424dc35095cd80f), UINT64_C(0x538484c19ef38c95) },
+    { UINT64_C(0xe12e13424bb40e13), UINT64_C(0x2865a5f206b06fba) },
+    { UINT64_C(0x8cbccc096f5088cb), UINT64_C(0xf93f87b7442e45d4) },
+    { UINT64_C(0xafebff0bcb24aafe), UINT64_C(0xf78f69a51539d749) },
+    { UINT64_C(0xdbe6fecebdedd5be), UINT64_C(0xb573440e5a884d1c) },
+    { UINT64_C(0x89705f4136b4a597), UINT64_C(0x31680a88f8953031) },
+    { UINT64_C(0xabcc77118461cefc), UINT64_C(0xfdc20d2b36ba7c3e) },
+    { UINT64_C(0xd6bf94d5e57a42bc), UINT64_C(0x3d32907604691b4d) },
+    { UINT64_C(0x8637bd05af6c69b5), UINT64_C(0xa63f9a49c2c1b110) },
+    { UINT64_C(0xa7c5ac471b478423), UINT64_C(0x0fcf80dc33721d54) },
+    { UINT64_C(0xd1b71758e219652b), UINT64_C(0xd3c36113404ea4a9) },
+    { UINT64_C(0x83126e978d4fdf3b), UINT64_C(0x645a1cac083126ea) },
+    { UINT64_C(0xa3d70a3d70a3d70a), UINT64_C(0x3d70a3d70a3d70a4) },
+    { UINT64_C(0xcccccccccccccccc), UINT64_C(0xcccccccccccccccd) },
+    { UINT64_C(0x8000000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xa000000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xc800000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xfa00000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x9c40000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xc350000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xf424000000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x9896800000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xbebc200000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xee6b280000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x9502f90000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xba43b74000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xe8d4a51000000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x9184e72a00000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xb5e620f480000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xe35fa931a0000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x8e1bc9bf04000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xb1a2bc2ec5000000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xde0b6b3a76400000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x8ac7230489e80000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xad78ebc5ac620000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xd8d726b7177a8000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x878678326eac9000), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xa968163f0a57b400), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xd3c21bcecceda100), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x84595161401484a0), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xa56fa5b99019a5c8), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0xcecb8f27f4200f3a), UINT64_C(0x0000000000000000) },
+    { UINT64_C(0x813f3978f8940984), UINT64_C(0x4000000000000000) },
+    { UINT64_C(0xa18f07d736b90be5), UINT64_C(0x5000000000000000) },
+    { UINT64_C(0xc9f2c9cd04674ede), UINT64_C(0xa400000000000000) },
+    { UINT64_C(0xfc6f7c4045812296), UINT64_C(0x4d00000000000000) },
+    { UINT64_C(0x9dc5ada82b70b59d), UINT64_C(0xf020000000000000) },
+    { UINT64_C(0xc5371912364ce305), UINT64_C(0x6c28000000000000) },
+    { UINT64_C(0xf684df56c3e01bc6), UINT64_C(0xc732000000000000) },
+    { UINT64_C(0x9a130b963a6c115c), UINT64_C(0x3c7f400000000000) },
+    { UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x4b9f100000000000) },
+    { UINT64_C(0xf0bdc21abb48db20), UINT64_C(0x1e86d40000000000) },
+    { UINT64_C(0x96769950b50d88f4), UINT64_C(0x1314448000000000) },
+    { UINT64_C(0xbc143fa4e250eb31), UINT64_C(0x17d955a000000000) },
+    { UINT64_C(0xeb194f8e1ae525fd), UINT64_C(0x5dcfab0800000000) },
+    { UINT64_C(0x92efd1b8d0cf37be), UINT64_C(0x5aa1cae500000000) },
+    { UINT64_C(0xb7abc627050305ad), UINT64_C(0xf14a3d9e40000000) },
+    { UINT64_C(0xe596b7b0c643c719), UINT64_C(0x6d9ccd05d0000000) },
+    { UINT64_C(0x8f7e32ce7bea5c6f), UINT64_C(0xe4820023a2000000) },
+    { UINT64_C(0xb35dbf821ae4f38b), UINT64_C(0xdda2802c8a800000) },
+    { UINT64_C(0xe0352f62a19e306e), UINT64_C(0xd50b2037ad200000) },
+    { UINT64_C(0x8c213d9da502de45), UINT64_C(0x4526f422cc340000) },
+    { UINT64_C(0xaf298d050e4395d6), UINT64_C(0x9670b12b7f410000) },
+    { UINT64_C(0xdaf3f04651d47b4c), UINT64_C(0x3c0cdd765f114000) },
+    { UINT64_C(0x88d8762bf324cd0f), UINT64_C(0xa5880a69fb6ac800) },
+    { UINT64_C(0xab0e93b6efee0053), UINT64_C(0x8eea0d047a457a00) },
+    { UINT64_C(0xd5d238a4abe98068), UINT64_C(0x72a4904598d6d880) },
+    { UINT64_C(0x85a36366eb71f041), UINT64_C(0x47a6da2b7f864750) },
+    { UINT64_C(0xa70c3c40a64e6c51), UINT64_C(0x999090b65f67d924) },
+    { UINT64_C(0xd0cf4b50cfe20765), UINT64_C(0xfff4b4e3f741cf6d) },
+    { UINT64_C(0x82818f1281ed449f), UINT64_C(0xbff8f10e7a8921a4) },
+    { UINT64_C(0xa321f2d7226895c7), UINT64_C(0xaff72d52192b6a0d) },
+    { UINT64_C(0xcbea6f8ceb02bb39), UINT64_C(0x9bf4f8a69f764490) },
+    { UINT64_C(0xfee50b7025c36a08), UINT64_C(0x02f236d04753d5b4) },
+    { UINT64_C(0x9f4f2726179a2245), UINT64_C(0x01d762422c946590) },
+    { UINT64_C(0xc722f0ef9d80aad6), UINT64_C(0x424d3ad2b7b97ef5) },
+    { UINT64_C(0xf8ebad2b84e0d58b), UINT64_C(0xd2e0898765a7deb2) },
+    { UINT64_C(0x9b934c3b330c8577), UINT64_C(0x63cc55f49f88eb2f) },
+    { UINT64_C(0xc2781f49ffcfa6d5), UINT64_C(0x3cbf6b71c76b25fb) },
+    { UINT64_C(0xf316271c7fc3908a), UINT64_C(0x8bef464e3945ef7a) },
+    { UINT64_C(0x97edd871cfda3a56), UINT64_C(0x97758bf0e3cbb5ac) },
+    { UINT64_C(0xbde94e8e43d0c8ec), UINT64_C(0x3d52eeed1cbea317) },
+    { UINT64_C(0xed63a231d4c4fb27), UINT64_C(0x4ca7aaa863ee4bdd) },
+    { UINT64_C(0x945e455f24fb1cf8), UINT64_C(0x8fe8caa93e74ef6a) },
+    { UINT64_C(0xb975d6b6ee39e436), UINT64_C(0xb3e2fd538e122b44) },
+    { UINT64_C(0xe7d34c64a9c85d44), UINT64_C(0x60dbbca87196b616) },
+    { UINT64_C(0x90e40fbeea1d3a4a), UINT64_C(0xbc8955e946fe31cd) },
+    { UINT64_C(0xb51d13aea4a488dd), UINT64_C(0x6babab6398bdbe41) },
+    { UINT64_C(0xe264589a4dcdab14), UINT64_C(0xc696963c7eed2dd1) },
+    { UINT64_C(0x8d7eb76070a08aec), UINT64_C(0xfc1e1de5cf543ca2) },
+    { UINT64_C(0xb0de65388cc8ada8), UINT64_C(0x3b25a55f43294bcb) },
+    { UINT64_C(0xdd15fe86affad912), UINT64_C(0x49ef0eb713f39ebe) },
+    { UINT64_C(0x8a2dbf142dfcc7ab), UINT64_C(0x6e3569326c784337) },
+    { UINT64_C(0xacb92ed9397bf996), UINT64_C(0x49c2c37f07965404) },
+    { UINT64_C(0xd7e77a8f87daf7fb), UINT64_C(0xdc33745ec97be906) },
+    { UINT64_C(0x86f0ac99b4e8dafd), UINT64_C(0x69a028bb3ded71a3) },
+    { UINT64_C(0xa8acd7c0222311bc), UINT64_C(0xc40832ea0d68ce0c) },
+    { UINT64_C(0xd2d80db02aabd62b), UINT64_C(0xf50a3fa490c30190) },
+    { UINT64_C(0x83c7088e1aab65db), UINT64_C(0x792667c6da79e0fa) },
+    { UINT64_C(0xa4b8cab1a1563f52), UINT64_C(0x577001b891185938) },
+    { UINT64_C(0xcde6fd5e09abcf26), UINT64_C(0xed4c0226b55e6f86) },
+    { UINT64_C(0x80b05e5ac60b6178), UINT64_C(0x544f8158315b05b4) },
+    { UINT64_C(0xa0dc75f1778e39d6), UINT64_C(0x696361ae3db1c721) },
+    { UINT64_C(0xc913936dd571c84c), UINT64_C(0x03bc3a19cd1e38e9) },
+    { UINT64_C(0xfb5878494ace3a5f), UINT64_C(0x04ab48a04065c723) },
+    { UINT64_C(0x9d174b2dcec0e47b), UINT64_C(0x62eb0d64283f9c76) },
+    { UINT64_C(0xc45d1df942711d9a), UINT64_C(0x3ba5d0bd324f8394) },
+    { UINT64_C(0xf5746577930d6500), UINT64_C(0xca8f44ec7ee36479) },
+    { UINT64_C(0x9968bf6abbe85f20), UINT64_C(0x7e998b13cf4e1ecb) },
+    { UINT64_C(0xbfc2ef456ae276e8), UINT64_C(0x9e3fedd8c321a67e) },
+    { UINT64_C(0xefb3ab16c59b14a2), UINT64_C(0xc5cfe94ef3ea101e) },
+    { UINT64_C(0x95d04aee3b80ece5), UINT64_C(0xbba1f1d158724a12) },
+    { UINT64_C(0xbb445da9ca61281f), UINT64_C(0x2a8a6e45ae8edc97) },
+    { UINT64_C(0xea1575143cf97226), UINT64_C(0xf52d09d71a3293bd) },
+    { UINT64_C(0x924d692ca61be758), UINT64_C(0x593c2626705f9c56) },
+    { UINT64_C(0xb6e0c377cfa2e12e), UINT64_C(0x6f8b2fb00c77836c) },
+    { UINT64_C(0xe498f455c38b997a), UINT64_C(0x0b6dfb9c0f956447) },
+    { UINT64_C(0x8edf98b59a373fec), UINT64_C(0x4724bd4189bd5eac) },
+    { UINT64_C(0xb2977ee300c50fe7), UINT64_C(0x58edec91ec2cb657) },
+    { UINT64_C(0xdf3d5e9bc0f653e1), UINT64_C(0x2f2967b66737e3ed) },
+    { UINT64_C(0x8b865b215899f46c), UINT64_C(0xbd79e0d20082ee74) },
+    { UINT64_C(0xae67f1e9aec07187), UINT64_C(0xecd8590680a3aa11) },
+    { UINT64_C(0xda01ee641a708de9), UINT64_C(0xe80e6f4820cc9495) },
+    { UINT64_C(0x884134fe908658b2), UINT64_C(0x3109058d147fdcdd) },
+    { UINT64_C(0xaa51823e34a7eede), UINT64_C(0xbd4b46f0599fd415) },
+    { UINT64_C(0xd4e5e2cdc1d1ea96), UINT64_C(0x6c9e18ac7007c91a) },
+    { UINT64_C(0x850fadc09923329e), UINT64_C(0x03e2cf6bc604ddb0) },
+    { UINT64_C(0xa6539930bf6bff45), UINT64_C(0x84db8346b786151c) },
+    { UINT64_C(0xcfe87f7cef46ff16), UINT64_C(0xe612641865679a63) },
+    { UINT64_C(0x81f14fae158c5f6e), UINT64_C(0x4fcb7e8f3f60c07e) },
+    { UINT64_C(0xa26da3999aef7749), UINT64_C(0xe3be5e330f38f09d) },
+    { UINT64_C(0xcb090c8001ab551c), UINT64_C(0x5cadf5bfd3072cc5) },
+    { UINT64_C(0xfdcb4fa002162a63), UINT64_C(0x73d9732fc7c8f7f6) },
+    { UINT64_C(0x9e9f11c4014dda7e), UINT64_C(0x2867e7fddcdd9afa) },
+    { UINT64_C(0xc646d63501a1511d), UINT64_C(0xb281e1fd541501b8) },
+    { UINT64_C(0xf7d88bc24209a565), UINT64_C(0x1f225a7ca91a4226) },
+    { UINT64_C(0x9ae757596946075f), UINT64_C(0x3375788de9b06958) },
+    { UINT64_C(0xc1a12d2fc3978937), UINT64_C(0x0052d6b1641c83ae) },
+    { UINT64_C(0xf209787bb47d6b84), UINT64_C(0xc0678c5dbd23a49a) },
+    { UINT64_C(0x9745eb4d50ce6332), UINT64_C(0xf840b7ba963646e0) },
+    { UINT64_C(0xbd176620a501fbff), UINT64_C(0xb650e5a93bc3d898) },
+    { UINT64_C(0xec5d3fa8ce427aff), UINT64_C(0xa3e51f138ab4cebe) },
+    { UINT64_C(0x93ba47c980e98cdf), UINT64_C(0xc66f336c36b10137) },
+    { UINT64_C(0xb8a8d9bbe123f017), UINT64_C(0xb80b0047445d4184) },
+    { UINT64_C(0xe6d3102ad96cec1d), UINT64_C(0xa60dc059157491e5) },
+    { UINT64_C(0x9043ea1ac7e41392), UINT64_C(0x87c89837ad68db2f) },
+    { UINT64_C(0xb454e4a179dd1877), UINT64_C(0x29babe4598c311fb) },
+    { UINT64_C(0xe16a1dc9d8545e94), UINT64_C(0xf4296dd6fef3d67a) },
+    { UINT64_C(0x8ce2529e2734bb1d), UINT64_C(0x1899e4a65f58660c) },
+    { UINT64_C(0xb01ae745b101e9e4), UINT64_C(0x5ec05dcff72e7f8f) },
+    { UINT64_C(0xdc21a1171d42645d), UINT64_C(0x76707543f4fa1f73) },
+    { UINT64_C(0x899504ae72497eba), UINT64_C(0x6a06494a791c53a8) },
+    { UINT64_C(0xabfa45da0edbde69), UINT64_C(0x0487db9d17636892) },
+    { UINT64_C(0xd6f8d7509292d603), UINT64_C(0x45a9d2845d3c42b6) },
+    { UINT64_C(0x865b86925b9bc5c2), UINT64_C(0x0b8a2392ba45a9b2) },
+    { UINT64_C(0xa7f26836f282b732), UINT64_C(0x8e6cac7768d7141e) },
+    { UINT64_C(0xd1ef0244af2364ff), UINT64_C(0x3207d795430cd926) },
+    { UINT64_C(0x8335616aed761f1f), UINT64_C(0x7f44e6bd49e807b8) },
+    { UINT64_C(0xa402b9c5a8d3a6e7), UINT64_C(0x5f16206c9c6209a6) },
+    { UINT64_C(0xcd036837130890a1), UINT64_C(0x36dba887c37a8c0f) },
+    { UINT64_C(0x802221226be55a64), UINT64_C(0xc2494954da2c9789) },
+    { UINT64_C(0xa02aa96b06deb0fd), UINT64_C(0xf2db9baa10b7bd6c) },
+    { UINT64_C(0xc83553c5c8965d3d), UINT64_C(0x6f92829494e5acc7) },
+    { UINT64_C(0xfa42a8b73abbf48c), UINT64_C(0xcb772339ba1f17f9) },
+    { UINT64_C(0x9c69a97284b578d7), UINT64_C(0xff2a760414536efb) },
+    { UINT64_C(0xc38413cf25e2d70d), UINT64_C(0xfef5138519684aba) },
+    { UINT64_C(0xf46518c2ef5b8cd1), UINT64_C(0x7eb258665fc25d69) },
+    { UINT64_C(0x98bf2f79d5993802), UINT64_C(0xef2f773ffbd97a61) },
+    { UINT64_C(0xbeeefb584aff8603), UINT64_C(0xaafb550ffacfd8fa) },
+    { UINT64_C(0xeeaaba2e5dbf6784), UINT64_C(0x95ba2a53f983cf38) },
+    { UINT64_C(0x952ab45cfa97a0b2), UINT64_C(0xdd945a747bf26183) },
+    { UINT64_C(0xba756174393d88df), UINT64_C(0x94f971119aeef9e4) },
+    { UINT64_C(0xe912b9d1478ceb17), UINT64_C(0x7a37cd5601aab85d) },
+    { UINT64_C(0x91abb422ccb812ee), UINT64_C(0xac62e055c10ab33a) },
+    { UINT64_C(0xb616a12b7fe617aa), UINT64_C(0x577b986b314d6009) },
+    { UINT64_C(0xe39c49765fdf9d94), UINT64_C(0xed5a7e85fda0b80b) },
+    { UINT64_C(0x8e41ade9fbebc27d), UINT64_C(0x14588f13be847307) },
+    { UINT64_C(0xb1d219647ae6b31c), UINT64_C(0x596eb2d8ae258fc8) },
+    { UINT64_C(0xde469fbd99a05fe3), UINT64_C(0x6fca5f8ed9aef3bb) },
+    { UINT64_C(0x8aec23d680043bee), UINT64_C(0x25de7bb9480d5854) },
+    { UINT64_C(0xada72ccc20054ae9), UINT64_C(0xaf561aa79a10ae6a) },
+    { UINT64_C(0xd910f7ff28069da4), UINT64_C(0x1b2ba1518094da04) },
+    { UINT64_C(0x87aa9aff79042286), UINT64_C(0x90fb44d2f05d0842) },
+    { UINT64_C(0xa99541bf57452b28), UINT64_C(0x353a1607ac744a53) },
+    { UINT64_C(0xd3fa922f2d1675f2), UINT64_C(0x42889b8997915ce8) },
+    { UINT64_C(0x847c9b5d7c2e09b7), UINT64_C(0x69956135febada11) },
+    { UINT64_C(0xa59bc234db398c25), UINT64_C(0x43fab9837e699095) },
+    { UINT64_C(0xcf02b2c21207ef2e), UINT64_C(0x94f967e45e03f4bb) },
+    { UINT64_C(0x8161afb94b44f57d), UINT64_C(0x1d1be0eebac278f5) },
+    { UINT64_C(0xa1ba1ba79e1632dc), UINT64_C(0x6462d92a69731732) },
+    { UINT64_C(0xca28a291859bbf93), UINT64_C(0x7d7b8f7503cfdcfe) },
+    { UINT64_C(0xfcb2cb35e702af78), UINT64_C(0x5cda735244c3d43e) },
+    { UINT64_C(0x9defbf01b061adab), UINT64_C(0x3a0888136afa64a7) },
+    { UINT64_C(0xc56baec21c7a1916), UINT64_C(0x088aaa1845b8fdd0) },
+    { UINT64_C(0xf6c69a72a3989f5b), UINT64_C(0x8aad549e57273d45) },
+    { UINT64_C(0x9a3c2087a63f6399), UINT64_C(0x36ac54e2f678864b) },
+    { UINT64_C(0xc0cb28a98fcf3c7f), UINT64_C(0x84576a1bb416a7dd) },
+    { UINT64_C(0xf0fdf2d3f3c30b9f), UINT64_C(0x656d44a2a11c51d5) },
+    { UINT64_C(0x969eb7c47859e743), UINT64_C(0x9f644ae5a4b1b325) },
+    { UINT64_C(0xbc4665b596706114), UINT64_C(0x873d5d9f0dde1fee) },
+    { UINT64_C(0xeb57ff22fc0c7959), UINT64_C(0xa90cb506d155a7ea) },
+    { UINT64_C(0x9316ff75dd87cbd8), UINT64_C(0x09a7f12442d588f2) },
+    { UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x0c11ed6d538aeb2f) },
+    { UINT64_C(0xe5d3ef282a242e81), UINT64_C(0x8f1668c8a86da5fa) },
+    { UINT64_C(0x8fa475791a569d10), UINT64_C(0xf96e017d694487bc) },
+    { UINT64_C(0xb38d92d760ec4455), UINT64_C(0x37c981dcc395a9ac) },
+    { UINT64_C(0xe070f78d3927556a), UINT64_C(0x85bbe253f47b1417) },
+    { UINT64_C(0x8c469ab843b89562), UINT64_C(0x93956d7478ccec8e) },
+    { UINT64_C(0xaf58416654a6babb), UINT64_C(0x387ac8d1970027b2) },
+    { UINT64_C(0xdb2e51bfe9d0696a), UINT64_C(0x06997b05fcc0319e) },
+    { UINT64_C(0x88fcf317f22241e2), UINT64_C(0x441fece3bdf81f03) },
+    { UINT64_C(0xab3c2fddeeaad25a), UINT64_C(0xd527e81cad7626c3) },
+    { UINT64_C(0xd60b3bd56a5586f1), UINT64_C(0x8a71e223d8d3b074) },
+    { UINT64_C(0x85c7056562757456), UINT64_C(0xf6872d5667844e49) },
+    { UINT64_C(0xa738c6bebb12d16c), UINT64_C(0xb428f8ac016561db) },
+    { UINT64_C(0xd106f86e69d785c7), UINT64_C(0xe13336d701beba52) },
+    { UINT64_C(0x82a45b450226b39c), UINT64_C(0xecc0024661173473) },
+    { UINT64_C(0xa34d721642b06084), UINT64_C(0x27f002d7f95d0190) },
+    { UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x31ec038df7b441f4) },
+    { UINT64_C(0xff290242c83396ce), UINT64_C(0x7e67047175a15271) },
+    { UINT64_C(0x9f79a169bd203e41), UINT64_C(0x0f0062c6e984d386) },
+    { UINT64_C(0xc75809c42c684dd1), UINT64_C(0x52c07b78a3e60868) },
+    { UINT64_C(0xf92e0c3537826145), UINT64_C(0xa7709a56ccdf8a82) },
+    { UINT64_C(0x9bbcc7a142b17ccb), UINT64_C(0x88a66076400bb691) },
+    { UINT64_C(0xc2abf989935ddbfe), UINT64_C(0x6acff893d00ea435) },
+    { UINT64_C(0xf356f7ebf83552fe), UINT64_C(0x0583f6b8c4124d43) },
+    { UINT64_C(0x98165af37b2153de), UINT64_C(0xc3727a337a8b704a) },
+    { UINT64_C(0xbe1bf1b059e9a8d6), UINT64_C(0x744f18c0592e4c5c) },
+    { UINT64_C(0xeda2ee1c7064130c), UINT64_C(0x1162def06f79df73) },
+    { UINT64_C(0x9485d4d1c63e8be7), UINT64_C(0x8addcb5645ac2ba8) },
+    { UINT64_C(0xb9a74a0637ce2ee1), UINT64_C(0x6d953e2bd7173692) },
+    { UINT64_C(0xe8111c87c5c1ba99), UINT64_C(0xc8fa8db6ccdd0437) },
+    { UINT64_C(0x910ab1d4db9914a0), UINT64_C(0x1d9c9892400a22a2) },
+    { UINT64_C(0xb54d5e4a127f59c8), UINT64_C(0x2503beb6d00cab4b) },
+    { UINT64_C(0xe2a0b5dc971f303a), UINT64_C(0x2e44ae64840fd61d) },
+    { UINT64_C(0x8da471a9de737e24), UINT64_C(0x5ceaecfed289e5d2) },
+    { UINT64_C(0xb10d8e1456105dad), UINT64_C(0x7425a83e872c5f47) },
+    { UINT64_C(0xdd50f1996b947518), UINT64_C(0xd12f124e28f77719) },
+    { UINT64_C(0x8a5296ffe33cc92f), UINT64_C(0x82bd6b70d99aaa6f) },
+    { UINT64_C(0xace73cbfdc0bfb7b), UINT64_C(0x636cc64d1001550b) },
+    { UINT64_C(0xd8210befd30efa5a), UINT64_C(0x3c47f7e05401aa4e) },
+    { UINT64_C(0x8714a775e3e95c78), UINT64_C(0x65acfaec34810a71) },
+    { UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0x7f1839a741a14d0d) },
+    { UINT64_C(0xd31045a8341ca07c), UINT64_C(0x1ede48111209a050) },
+    { UINT64_C(0x83ea2b892091e44d), UINT64_C(0x934aed0aab460432) },
+    { UINT64_C(0xa4e4b66b68b65d60), UINT64_C(0xf81da84d5617853f) },
+    { UINT64_C(0xce1de40642e3f4b9), UINT64_C(0x36251260ab9d668e) },
+    { UINT64_C(0x80d2ae83e9ce78f3), UINT64_C(0xc1d72b7c6b426019) },
+    { UINT64_C(0xa1075a24e4421730), UINT64_C(0xb24cf65b8612f81f) },
+    { UINT64_C(0xc94930ae1d529cfc), UINT64_C(0xdee033f26797b627) },
+    { UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0x169840ef017da3b1) },
+    { UINT64_C(0x9d412e0806e88aa5), UINT64_C(0x8e1f289560ee864e) },
+    { UINT64_C(0xc491798a08a2ad4e), UINT64_C(0xf1a6f2bab92a27e2) },
+    { UINT64_C(0xf5b5d7ec8acb58a2), UINT64_C(0xae10af696774b1db) },
+    { UINT64_C(0x9991a6f3d6bf1765), UINT64_C(0xacca6da1e0a8ef29) },
+    { UINT64_C(0xbff610b0cc6edd3f), UINT64_C(0x17fd090a58d32af3) },
+    { UINT64_C(0xeff394dcff8a948e), UINT64_C(0xddfc4b4cef07f5b0) },
+    { UINT64_C(0x95f83d0a1fb69cd9), UINT64_C(0x4abdaf101564f98e) },
+    { UINT64_C(0xbb764c4ca7a4440f), UINT64_C(0x9d6d1ad41abe37f1) },
+    { UINT64_C(0xea53df5fd18d5513), UINT64_C(0x84c86189216dc5ed) },
+    { UINT64_C(0x92746b9be2f8552c), UINT64_C(0x32fd3cf5b4e49bb4) },
+    { UINT64_C(0xb7118682dbb66a77), UINT64_C(0x3fbc8c33221dc2a1) },
+    { UINT64_C(0xe4d5e82392a40515), UINT64_C(0x0fabaf3feaa5334a) },
+    { UINT64_C(0x8f05b1163ba6832d), UINT64_C(0x29cb4d87f2a7400e) },
+    { UINT64_C(0xb2c71d5bca9023f8), UINT64_C(0x743e20e9ef511012) },
+    { UINT64_C(0xdf78e4b2bd342cf6), UINT64_C(0x914da9246b255416) },
+    { UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0x1ad089b6c2f7548e) },
+    { UINT64_C(0xae9672aba3d0c320), UINT64_C(0xa184ac2473b529b1) },
+    { UINT64_C(0xda3c0f568cc4f3e8), UINT64_C(0xc9e5d72d90a2741e) },
+    { UINT64_C(0x8865899617fb1871), UINT64_C(0x7e2fa67c7a658892) },
+    { UINT64_C(0xaa7eebfb9df9de8d), UINT64_C(0xddbb901b98feeab7) },
+    { UINT64_C(0xd51ea6fa85785631), UINT64_C(0x552a74227f3ea565) },
+    { UINT64_C(0x8533285c936b35de), UINT64_C(0xd53a88958f87275f) },
+    { UINT64_C(0xa67ff273b8460356), UINT64_C(0x8a892abaf368f137) },
+    { UINT64_C(0xd01fef10a657842c), UINT64_C(0x2d2b7569b0432d85) },
+    { UINT64_C(0x8213f56a67f6b29b), UINT64_C(0x9c3b29620e29fc73) },
+    { UINT64_C(0xa298f2c501f45f42), UINT64_C(0x8349f3ba91b47b8f) },
+    { UINT64_C(0xcb3f2f7642717713), UINT64_C(0x241c70a936219a73) },
+    { UINT64_C(0xfe0efb53d30dd4d7), UINT64_C(0xed238cd383aa0110) },
+    { UINT64_C(0x9ec95d1463e8a506), UINT64_C(0xf4363804324a40aa) },
+    { UINT64_C(0xc67bb4597ce2ce48), UINT64_C(0xb143c6053edcd0d5) },
+    { UINT64_C(0xf81aa16fdc1b81da), UINT64_C(0xdd94b7868e94050a) },
+    { UINT64_C(0x9b10a4e5e9913128), UINT64_C(0xca7cf2b4191c8326) },
+    { UINT64_C(0xc1d4ce1f63f57d72), UINT64_C(0xfd1c2f611f63a3f0) },
+    { UINT64_C(0xf24a01a73cf2dccf), UINT64_C(0xbc633b39673c8cec) },
+    { UINT64_C(0x976e41088617ca01), UINT64_C(0xd5be0503e085d813) },
+    { UINT64_C(0xbd49d14aa79dbc82), UINT64_C(0x4b2d8644d8a74e18) },
+    { UINT64_C(0xec9c459d51852ba2), UINT64_C(0xddf8e7d60ed1219e) },
+    { UINT64_C(0x93e1ab8252f33b45), UINT64_C(0xcabb90e5c942b503) },
+    { UINT64_C(0xb8da1662e7b00a17), UINT64_C(0x3d6a751f3b936243) },
+    { UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0x0cc512670a783ad4) },
+    { UINT64_C(0x906a617d450187e2), UINT64_C(0x27fb2b80668b24c5) },
+    { UINT64_C(0xb484f9dc9641e9da), UINT64_C(0xb1f9f660802dedf6) },
+    { UINT64_C(0xe1a63853bbd26451), UINT64_C(0x5e7873f8a0396973) },
+    { UINT64_C(0x8d07e33455637eb2), UINT64_C(0xdb0b487b6423e1e8) },
+    { UINT64_C(0xb049dc016abc5e5f), UINT64_C(0x91ce1a9a3d2cda62) },
+    { UINT64_C(0xdc5c5301c56b75f7), UINT64_C(0x7641a140cc7810fb) },
+    { UINT64_C(0x89b9b3e11b6329ba), UINT64_C(0xa9e904c87fcb0a9d) },
+    { UINT64_C(0xac2820d9623bf429), UINT64_C(0x546345fa9fbdcd44) },
+    { UINT64_C(0xd732290fbacaf133), UINT64_C(0xa97c177947ad4095) },
+    { UINT64_C(0x867f59a9d4bed6c0), UINT64_C(0x49ed8eabcccc485d) },
+    { UINT64_C(0xa81f301449ee8c70), UINT64_C(0x5c68f256bfff5a74) },
+    { UINT64_C(0xd226fc195c6a2f8c), UINT64_C(0x73832eec6fff3111) },
+    { UINT64_C(0x83585d8fd9c25db7), UINT64_C(0xc831fd53c5ff7eab) },
+    { UINT64_C(0xa42e74f3d032f525), UINT64_C(0xba3e7ca8b77f5e55) },
+    { UINT64_C(0xcd3a1230c43fb26f), UINT64_C(0x28ce1bd2e55f35eb) },
+    { UINT64_C(0x80444b5e7aa7cf85), UINT64_C(0x7980d163cf5b81b3) },
+    { UINT64_C(0xa0555e361951c366), UINT64_C(0xd7e105bcc332621f) },
+    { UINT64_C(0xc86ab5c39fa63440), UINT64_C(0x8dd9472bf3fefaa7) },
+    { UINT64_C(0xfa856334878fc150), UINT64_C(0xb14f98f6f0feb951) },
+    { UINT64_C(0x9c935e00d4b9d8d2), UINT64_C(0x6ed1bf9a569f33d3) },
+    { UINT64_C(0xc3b8358109e84f07), UINT64_C(0x0a862f80ec4700c8) },
+    { UINT64_C(0xf4a642e14c6262c8), UINT64_C(0xcd27bb612758c0fa) },
+    { UINT64_C(0x98e7e9cccfbd7dbd), UINT64_C(0x8038d51cb897789c) },
+    { UINT64_C(0xbf21e44003acdd2c), UINT64_C(0xe0470a63e6bd56c3) },
+    { UINT64_C(0xeeea5d5004981478), UINT64_C(0x1858ccfce06cac74) },
+    { UINT64_C(0x95527a5202df0ccb), UINT64_C(0x0f37801e0c43ebc8) },
+    { UINT64_C(0xbaa718e68396cffd), UINT64_C(0xd30560258f54e6ba) },
+    { UINT64_C(0xe950df20247c83fd), UINT64_C(0x47c6b82ef32a2069) },
+    { UINT64_C(0x91d28b7416cdd27e), UINT64_C(0x4cdc331d57fa5441) },
+    { UINT64_C(0xb6472e511c81471d), UINT64_C(0xe0133fe4adf8e952) },
+    { UINT64_C(0xe3d8f9e563a198e5), UINT64_C(0x58180fddd97723a6) },
+    { UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0x570f09eaa7ea7648) }
+};
+
+/* Returns the high 64 bits of a * b and stores the low 64 bits in *lo */
+static uint64_t lept_mul128(uint64_t a, uint64_t b, uint64_t *lo) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+    *lo = (uint64_t)r;
+    return (uint64_t)(r >> 64);
+#else
+    uint64_t a0 = a & 0xFFFFFFFFu, a1 = a >> 32, b0 = b & 0xFFFFFFFFu, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFFu) + (p10 & 0xFFFFFFFFu);
+    *lo = (mid << 32) | (p00 & 0xFFFFFFFFu);
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+static int lept_clz64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (UINT64_C(1) << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static double lept_double_from_bits(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* Eisel-Lemire: the IEEE bits of w * 10^q rounded to nearest even, w != 0, the result may be infinity */
+static uint64_t lept_eisel_lemire(uint64_t w, long q) {
+    const uint64_t *pow5;
+    uint64_t hi, lo, mantissa;
+    int lz, upperbit, shift;
+    long power2;
+    if (q < LEPT_POW5_MIN_EXP)
+        return 0;
+    if (q > LEPT_POW5_MAX_EXP)
+        return UINT64_C(0x7FF) << 52;
+    lz = lept_clz64(w);
+    w <<= lz;
+    pow5 = lept_pow5_128[q - LEPT_POW5_MIN_EXP];
+    hi = lept_mul128(w, pow5[0], &lo);
+    if ((hi & 0x1FF) == 0x1FF) {
+        /* the truncated product may be off in the bits below the mantissa, refine it */
+        uint64_t lo2, hi2 = lept_mul128(w, pow5[1], &lo2);
+        lo += hi2;
+        if (hi2 > lo)
+            hi++;
+    }
+    upperbit = (int)(hi >> 63);
+    shift = upperbit + 64 - 52 - 3;
+    mantissa = hi >> shift;
+    power2 = ((152170L + 65536L) * q >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0) {
+        /* subnormal, which may round up to the smallest normal number */
+        if (-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        return mantissa;    /* a carry into bit 52 gives the right exponent bit */
+    }
+    /* exactly halfway between two doubles: round to even */
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+        mantissa &= ~(uint64_t)1;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (UINT64_C(2) << 52)) {
+        mantissa = UINT64_C(1) << 52;
+        power2++;
+    }
+    if (power2 >= 0x7FF)
+        return UINT64_C(0x7FF) << 52;
+    return (mantissa & ~(UINT64_C(1) << 52)) | ((uint64_t)power2 << 52);
+}
+
+/* Converts the validated number in [p, end) with strtod() independent of the current locale */
+static double lept_strtod_fallback(lept_context *c, const char *p, const char *end) {
+    size_t i, len = end - p;
+    char *num = (char *)lept_context_push(c, len + 1);
+    char point = localeconv()->decimal_point[0];
+    double d;
+    for (i = 0; i < len; i++)
+        num[i] = p[i] == '.' ? point : p[i];
+    num[len] = '\0';
+    d = strtod(num, NULL);
+    lept_context_pop(c, len + 1);
+    return d;
+}
+
 static int lept_parse_number(lept_context *c, lept_value *v) {
-    const char *p = c->json;
-    if (*p == '-')
+    const char *p = c->json, *end = c->end;
+    uint64_t w = 0, bits;
+    long q = 0, e = 0;
+    int neg = 0, digits = 0, truncated = 0;
+    double d;
+    /* at most 19 significant digits are kept in w, dropped digits only adjust q */
+#define LEPT_ACCUMULATE_DIGIT(fraction) \
+    do {\
+        if (digits < 19) {\
+            w = w * 10 + (*p - '0');\
+            if (w != 0)\
+                digits++;\
+            q -= (fraction);\
+        }\
+        else {\
+            q += !(fraction);\
+            truncated |= *p != '0';\
+        }\
+        ++p;\
+    } while(0)
+    if (PEEK_AT(p, end) == '-') {
+        neg = 1;
         ++p;
-    if (*p == '0')
+    }
+    if (PEEK_AT(p, end) == '0')
         ++p;
     else {
-        if (!ISDIGIT1TO9(*p))
+        if (!ISDIGIT1TO9(PEEK_AT(p, end)))
             return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p))
-            ++p;
+        while (ISDIGIT(PEEK_AT(p, end)))
+            LEPT_ACCUMULATE_DIGIT(0);
     }
-    if (*p == '.') {
+    if (PEEK_AT(p, end) == '.') {
         ++p;
-        if (!ISDIGIT(*p))
+        if (!ISDIGIT(PEEK_AT(p, end)))
             return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p))
-            ++p;
+        while (ISDIGIT(PEEK_AT(p, end)))
+            LEPT_ACCUMULATE_DIGIT(1);
     }
-    if (*p == 'e' || *p == 'E') {
+#undef LEPT_ACCUMULATE_DIGIT
+    if (PEEK_AT(p, end) == 'e' || PEEK_AT(p, end) == 'E') {
+        int eneg = 0;
         ++p;
-        if (*p == '+' || *p == '-')
-            ++p;
-        if (!ISDIGIT(*p))
+        if (PEEK_AT(p, end) == '+' || PEEK_AT(p, end) == '-')
+            eneg = *p++ == '-';
+        if (!ISDIGIT(PEEK_AT(p, end)))
             return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p))
+        while (ISDIGIT(PEEK_AT(p, end))) {
+            if (e < 100000)     /* far beyond the range of double */
+                e = e * 10 + (*p - '0');
             ++p;
+        }
+        q += eneg ? -e : e;
+    }
+    if (w == 0)
+        d = 0.0;
+#if !defined(__FLT_EVAL_METHOD__) || __FLT_EVAL_METHOD__ == 0
+    else if (!truncated && w <= (UINT64_C(1) << 53) && q >= -22 && q <= 22)
+        d = q < 0 ? (double)w / lept_pow10_exact[-q] : (double)w * lept_pow10_exact[q];
+#endif
+    else {
+        bits = lept_eisel_lemire(w, q);
+        /* the exact value lies in [w, w + 1) * 10^q, which must round to a single double */
+        if (truncated && bits != lept_eisel_lemire(w + 1, q))
+            d = lept_strtod_fallback(c, c->json + neg, p);
+        else
+            d = lept_double_from_bits(bits);
     }
-    errno = 0;
-    v->u.n = strtod(c->json, NULL);
-    if (errno = ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))      /* number overflow for double type */
+    v->u.n = neg ? -d : d;
+    if (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL)      /* number overflow for double type */
         return LEPT_PARSE_NUMBER_TOO_BIG;
     c->json = p;          /* update the JSON parsing context */
+    if (c->handler != NULL)
+        return LEPT_SAX(c, number, (c->sax_ctx, v->u.n));
     v->type = LEPT_NUMBER;
     return LEPT_PARSE_OK;
 }
 
-static const char* lept_parse_hex4(const char *p, unsigned *u) {
+static const char* lept_parse_hex4(const char *p, const char *end, unsigned *u) {
     int i;
     *u = 0;
+    if (end - p < 4)
+        return NULL;
     for (i = 0; i < 4; ++i) {
         char ch = *p++;
         *u <<= 4;
@@ -124,83 +1605,116 @@ static const char* lept_parse_hex4(const char *p, unsigned *u) {
     return p;
 }
 
-static void lept_encode_utf8(lept_context *c, unsigned u) {
+/* Writes the UTF-8 encoding of u to buf and returns its length, which is at most 4 */
+static size_t lept_encode_utf8(char *buf, unsigned u) {
     assert(u >= 0x0000 && u <= 0x10FFFF);
     if (u >= 0x0000 && u < 0x0080) {
-        PUT(c, u & 0x7F);
+        buf[0] = u & 0x7F;
+        return 1;
     }
     else if (u >= 0x0080 && u < 0x0800) {
-        PUT(c, 0xC0 | ((u >> 6) & 0x1F));
-        PUT(c, 0x80 | ( u       & 0x3F));
+        buf[0] = 0xC0 | ((u >> 6) & 0x1F);
+        buf[1] = 0x80 | ( u       & 0x3F);
+        return 2;
     }
     else if (u >= 0x0800 && u < 0x10000) {
-        PUT(c, 0xE0 | ((u >> 12) & 0x0F));
-        PUT(c, 0x80 | ((u >>  6) & 0x3F));
-        PUT(c, 0x80 | ((u      ) & 0x3F));
+        buf[0] = 0xE0 | ((u >> 12) & 0x0F);
+        buf[1] = 0x80 | ((u >>  6) & 0x3F);
+        buf[2] = 0x80 | ((u      ) & 0x3F);
+        return 3;
     }
     else {
-        PUT(c, 0xF0 | ((u >> 18) & 0x07));
-        PUT(c, 0x80 | ((u >> 12) & 0x3F));
-        PUT(c, 0x80 | ((u >>  6) & 0x3F));
-        PUT(c, 0x80 | ((u      ) & 0x3F));
+        buf[0] = 0xF0 | ((u >> 18) & 0x07);
+        buf[1] = 0x80 | ((u >> 12) & 0x3F);
+        buf[2] = 0x80 | ((u >>  6) & 0x3F);
+        buf[3] = 0x80 | ((u      ) & 0x3F);
+        return 4;
     }
-    return;
 }
 
 #define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
+/* In situ, the unescaped string never outgrows its escaped form, so w cannot overtake p */
+#define STRING_PUT(ch)    do { if (w != NULL) *w++ = (ch); else PUT(c, ch); } while(0)
 
 static int lept_parse_string_raw(lept_context *c, char **str, size_t *len) {
     size_t head = c->top;
     unsigned u, u_low;
     const char *p;
+    char *w = NULL, *start = NULL;
     EXPECT(c, '\"');
     p = c->json;
+    if (c->insitu)
+        w = start = (char *)c->json;
     for (;;) {
-        char ch = *p++;
-        switch(ch) {
+        /* copy the run up to the next quotation mark, backslash or control character at once */
+        const char *run = p;
+        p = lept_simd_impl.scan_string(p, c->end);
+        if (w == NULL && c->top == head && p != c->end && *p == '\"') {
+            /* nothing to unescape, the string is the run itself and is not copied */
+            *str = (char *)run;
+            *len = p - run;
+            c->json = p + 1;
+            return LEPT_PARSE_OK;
+        }
+        if (p != run) {
+            if (w == NULL)
+                PUTS(c, run, p - run);
+            else {
+                if (w != run)
+                    memmove(w, run, p - run);
+                w += p - run;
+            }
+        }
+        if (p == c->end)
+            STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
+        switch(*p++) {
             case '\"':
-                *len = c->top - head;
-                *str = lept_context_pop(c, *len);
+                if (w != NULL) {
+                    *w = '\0';     /* overwrites at most the closing quotation mark */
+                    *len = w - start;
+                    *str = start;
+                }
+                else {
+                    *len = c->top - head;
+                    *str = lept_context_pop(c, *len);
+                }
                 c->json = p;
                 return LEPT_PARSE_OK;
-            case '\0':
-                STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
             case '\\':
-                switch(*p++) {
-                    case '\"': PUT(c, '\"'); break;
-                    case '\\': PUT(c, '\\'); break;
-                    case '/': PUT(c, '/'); break;
-                    case 'b': PUT(c, '\b'); break;
-                    case 'f': PUT(c, '\f'); break;
-                    case 'n': PUT(c, '\n'); break;
-                    case 'r': PUT(c, '\r'); break;
-                    case 't': PUT(c, '\t'); break;
+                switch(p != c->end ? *p++ : '\0') {
+                    case '\"': STRING_PUT('\"'); break;
+                    case '\\': STRING_PUT('\\'); break;
+                    case '/': STRING_PUT('/'); break;
+                    case 'b': STRING_PUT('\b'); break;
+                    case 'f': STRING_PUT('\f'); break;
+                    case 'n': STRING_PUT('\n'); break;
+                    case 'r': STRING_PUT('\r'); break;
+                    case 't': STRING_PUT('\t'); break;
                     case 'u': 
-                        if (!(p = lept_parse_hex4(p, &u)))
+                        if (!(p = lept_parse_hex4(p, c->end, &u)))
                             STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                         if (u >= 0xD800 && u <= 0xDFFF) {
-                            if (*p++ != '\\')
+                            if (c->end - p < 2 || *p++ != '\\')
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
                             if (*p++ != 'u')
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                            if (!(p = lept_parse_hex4(p, &u_low)))
+                            if (!(p = lept_parse_hex4(p, c->end, &u_low)))
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                             if (!(u_low >= 0xDC00 && u_low <= 0xDFFF))
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
                             u = 0x10000 + (u - 0xD800) * 0x400 + (u_low - 0xDC00);
                         }
-                        lept_encode_utf8(c, u);
+                        if (w != NULL)
+                            w += lept_encode_utf8(w, u);
+                        else
+                            c->top -= 4 - lept_encode_utf8(lept_context_push(c, 4), u);
                         break;
                     default:
                        STRING_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE);
                 }
                 break;
             default:
-                if (ch < 0x20) {
-                    STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
-                }
-                PUT(c, ch);
-                break;
+                STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
         }
     }               
 }
@@ -210,620 +1724,4113 @@ static int lept_parse_string(lept_context *c, lept_value *v) {
     size_t len;
     int ret;
     if ((ret = lept_parse_string_raw(c, &str, &len)) == LEPT_PARSE_OK) {
-        lept_set_string(v, str, len);
-    }
-    return ret;
-}
-
-static int lept_parse_value(lept_context *c, lept_value *v);
-
-static int lept_parse_array(lept_context *c, lept_value *v) {
-    size_t size = 0;
-    int ret;
-    EXPECT(c, '[');
-    lept_parse_whitespace(c);
-    if (*c->json == ']') {
-        c->json++;
-        v->type = LEPT_ARRAY;
-        v->u.a.size = 0;
-        v->u.a.e = NULL;
-        return LEPT_PARSE_OK;
-    }
-    for (;;) {
-        lept_value e;
-        lept_init(&e);
-        lept_parse_whitespace(c);
-        if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK) {
-            int i;
-            for (i = 0; i < size; ++i) {
-                lept_context_pop(c, sizeof(lept_value));
-                lept_free((lept_value*)c->stack + c->top);
-            }
-            return ret;
-        }
-        memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
-        size++;
-        lept_parse_whitespace(c);
-        if (*c->json == ',')
-            c->json++;
-        else if (*c->json == ']') {
-            c->json++;
-            lept_set_array(v, size);
-            v->u.a.size = size;
-            size *= sizeof(lept_value);
-            memcpy(v->u.a.e, lept_context_pop(c, size), size);
+        if (c->handler != NULL)
+            return LEPT_SAX(c, string, (c->sax_ctx, str, len));
+        if (len > LEPT_SIZE_MAX)
+            return LEPT_PARSE_SIZE_TOO_BIG;
+        if (c->insitu)
+            v->u.s.s = str;     /* already null-terminated in the JSON text */
+        else if (len <= LEPT_STRING_INLINE_MAX) {
+            lept_set_inline_string(v, str, len);
             return LEPT_PARSE_OK;
         }
         else {
-            int i;
-            for (i = 0; i < size; ++i) {
-                lept_context_pop(c, sizeof(lept_value));
-                lept_free((lept_value*)c->stack + c->top);
-            }
-            return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            v->u.s.s = (char *)lept_context_alloc(c, len + 1);
+            memcpy(v->u.s.s, str, len);
+            v->u.s.s[len] = '\0';
         }
+        LEPT_SPAN_LEN(v) = len;
+        v->type = LEPT_STRING;
+        v->flags = LEPT_CONTEXT_BORROWS_STRINGS(c) ? LEPT_VALUE_BORROWED : 0;
     }
+    return ret;
 }
 
-static int lept_parse_object(lept_context *c, lept_value *v) {
-    size_t size;
-    lept_member m;
-    int ret, i;
-    EXPECT(c, '{');
-    lept_parse_whitespace(c);
-    if (*c->json == '}') {
-        c->json++;
-        v->type = LEPT_OBJECT;
-        v->u.o.m = 0;
-        v->u.o.size = 0;
-        return LEPT_PARSE_OK;
-    }
-    m.k = NULL;
-    size = 0;
-    for (;;) {
-        char *str = NULL;
-        lept_init(&m.v);
-        /* parse member key */
-        lept_parse_whitespace(c);
-        if (*c->json != '"') {
-            ret = LEPT_PARSE_MISS_KEY;
-            break;
-        }
-        if (lept_parse_string_raw(c, &str, &m.klen) != LEPT_PARSE_OK) {
-            ret = LEPT_PARSE_MISS_KEY;
-            break;
+/*
+ * Finds the end of the value at p by matching brackets and quotation marks without validating it,
+ * returns NULL if the text ends within it. Used for lazy values and to split arrays between threads.
+ */
+static const char* lept_skip_value(const char *p, const char *end) {
+    size_t depth = 0;
+    while (p != end) {
+        switch (*p) {
+            case '"':
+                for (p++; ; p++) {
+                    p = lept_simd_impl.scan_string(p, end);
+                    if (p == end)
+                        return NULL;
+                    if (*p == '"')
+                        break;
+                    if (*p == '\\' && ++p == end)     /* the escaped character is skipped */
+                        return NULL;
+                }
+                if (depth == 0)
+                    return p + 1;
+                break;
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ']':
+            case '}':
+                if (depth == 0)
+                    return p;
+                if (--depth == 0)
+                    return p + 1;
+                break;
+            case ',':
+                if (depth == 0)
+                    return p;
+                break;
+            default:
+                if (depth == 0 && ISWHITESPACE(*p))
+                    return p;
         }
-        m.k = (char *)malloc(m.klen + 1);
-        m.k[m.klen] = '\0';
-        memcpy(m.k, str, m.klen);
-        /* parse ws [colon] ws */
-        lept_parse_whitespace(c);
-        if (*c->json != ':') {
-            free(m.k);
-            ret = LEPT_PARSE_MISS_COLON;
-            break;
+        p++;
+    }
+    return depth == 0 ? p : NULL;
+}
+
+/* A lazy array or object records its span in u.s, it is parsed by lept_expand() on first access */
+static int lept_parse_lazy(lept_context *c, lept_value *v) {
+    const char *end = lept_skip_value(c->json, c->end);
+    if (end == NULL)
+        return *c->json == '[' ? LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    if ((size_t)(end - c->json) > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    v->type = *c->json == '[' ? LEPT_ARRAY : LEPT_OBJECT;
+    v->flags = LEPT_VALUE_LAZY;
+    v->u.s.s = (char *)c->json;
+    LEPT_SPAN_LEN(v) = end - c->json;
+    c->json = end;
+    return LEPT_PARSE_OK;
+}
+
+/*
+ * Objects with a capacity of at least LEPT_OBJECT_INDEX_THRESHOLD carry an open addressing hash index
+ * in the same allocation, right after the members. A bucket holds a member index + 1, or 0 when empty.
+ */
+#define LEPT_OBJECT_INDEXED(capacity)   ((capacity) >= LEPT_OBJECT_INDEX_THRESHOLD)
+#define LEPT_OBJECT_INDEX(v)            ((size_t *)((v)->u.o.m + LEPT_OBJECT_CAPACITY(v)))
+
+static size_t lept_object_index_buckets(size_t capacity) {
+    size_t n = LEPT_OBJECT_INDEX_THRESHOLD;
+    while (n < capacity * 2)
+        n *= 2;
+    return n;
+}
+
+/* Bytes of storage for the members and the index of an object */
+static size_t lept_object_storage_size(size_t capacity) {
+    size_t size = LEPT_STORAGE_HEADER_SIZE + capacity * sizeof(lept_member);
+    if (LEPT_OBJECT_INDEXED(capacity))
+        size += lept_object_index_buckets(capacity) * sizeof(size_t);
+    return size;
+}
+
+/* FNV-1a */
+static size_t lept_hash_key(const char *key, size_t klen) {
+    size_t i;
+    unsigned long h = 2166136261UL;
+    for (i = 0; i < klen; ++i)
+        h = ((h ^ (unsigned char)key[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    return (size_t)h;
+}
+
+static void lept_object_index_insert(lept_value *v, size_t index) {
+    size_t *b = LEPT_OBJECT_INDEX(v), mask = lept_object_index_buckets(LEPT_OBJECT_CAPACITY(v)) - 1;
+    size_t i = lept_hash_key(LEPT_KEY(&v->u.o.m[index]), v->u.o.m[index].klen) & mask;
+    while (b[i] != 0)
+        i = (i + 1) & mask;
+    b[i] = index + 1;
+}
+
+static void lept_object_index_rebuild(lept_value *v) {
+    size_t i;
+    if (!LEPT_OBJECT_INDEXED(LEPT_OBJECT_CAPACITY(v)))
+        return;
+    memset(LEPT_OBJECT_INDEX(v), 0, lept_object_index_buckets(LEPT_OBJECT_CAPACITY(v)) * sizeof(size_t));
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i)
+        lept_object_index_insert(v, i);
+}
+
+/* hash is lept_hash_key() of key */
+static size_t lept_object_index_find(const lept_value *v, const char *key, size_t klen, size_t hash) {
+    const size_t *b = LEPT_OBJECT_INDEX(v), mask = lept_object_index_buckets(LEPT_OBJECT_CAPACITY(v)) - 1;
+    size_t i;
+    for (i = hash & mask; b[i] != 0; i = (i + 1) & mask) {
+        const lept_member *m = &v->u.o.m[b[i] - 1];
+        if (m->klen == klen && (LEPT_KEY(m) == key || memcmp(LEPT_KEY(m), key, klen) == 0))
+            return b[i] - 1;
+    }
+    return LEPT_KEY_NOT_EXIST;
+}
+
+/* The bucket holding member index */
+static size_t lept_object_index_slot(const lept_value *v, size_t index) {
+    const size_t *b = LEPT_OBJECT_INDEX(v), mask = lept_object_index_buckets(LEPT_OBJECT_CAPACITY(v)) - 1;
+    size_t i = lept_hash_key(LEPT_KEY(&v->u.o.m[index]), v->u.o.m[index].klen) & mask;
+    while (b[i] != index + 1) {
+        assert(b[i] != 0);
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/* Empties a bucket, shifting back the entries of its probe run so that no lookup stops early */
+static void lept_object_index_erase(lept_value *v, size_t slot) {
+    size_t *b = LEPT_OBJECT_INDEX(v), mask = lept_object_index_buckets(LEPT_OBJECT_CAPACITY(v)) - 1;
+    size_t i = slot, home;
+    for (;;) {
+        i = (i + 1) & mask;
+        if (b[i] == 0)
+            break;
+        home = lept_hash_key(LEPT_KEY(&v->u.o.m[b[i] - 1]), v->u.o.m[b[i] - 1].klen) & mask;
+        if (((i - home) & mask) >= ((i - slot) & mask)) {
+            b[slot] = b[i];
+            slot = i;
         }
-        c->json++;
-        lept_parse_whitespace(c);
-        /* parse value */
-        if ((ret = lept_parse_value(c, &m.v)) != LEPT_PARSE_OK) {
-            free(m.k);
+    }
+    b[slot] = 0;
+}
+
+/*
+ * Interned keys: each distinct key is stored once in the arena of the table, an open addressing hash
+ * set of its entries. The lock makes a table usable by several parsing threads.
+ */
+typedef struct {
+    const char *k;          /* NULL if the slot is empty */
+    size_t klen;
+    size_t hash;
+} lept_symtab_entry;
+
+struct lept_symtab {
+    lept_symtab_entry *entries;
+    size_t count, capacity;     /* capacity is a power of 2 */
+    lept_arena keys;
+#if defined(LEPT_THREADS)
+    pthread_mutex_t lock;
+#endif
+};
+
+lept_symtab* lept_symtab_new(void) {
+    lept_symtab *st = (lept_symtab *)malloc(sizeof(lept_symtab));
+    st->count = 0;
+    st->capacity = 64;
+    st->entries = (lept_symtab_entry *)calloc(st->capacity, sizeof(lept_symtab_entry));
+    lept_arena_init(&st->keys, 0);
+#if defined(LEPT_THREADS)
+    pthread_mutex_init(&st->lock, NULL);
+#endif
+    return st;
+}
+
+void lept_symtab_free(lept_symtab *st) {
+    if (st == NULL)
+        return;
+    lept_arena_free(&st->keys);
+    free(st->entries);
+#if defined(LEPT_THREADS)
+    pthread_mutex_destroy(&st->lock);
+#endif
+    free(st);
+}
+
+static lept_symtab_entry* lept_symtab_slot(lept_symtab_entry *entries, size_t capacity, const char *key, size_t klen, size_t hash) {
+    size_t i, mask = capacity - 1;
+    for (i = hash & mask; entries[i].k != NULL; i = (i + 1) & mask)
+        if (entries[i].hash == hash && entries[i].klen == klen && memcmp(entries[i].k, key, klen) == 0)
             break;
+    return &entries[i];
+}
+
+const char* lept_symtab_intern(lept_symtab *st, const char *key, size_t klen) {
+    size_t hash = lept_hash_key(key, klen), i;
+    lept_symtab_entry *e;
+    char *k;
+    assert(st != NULL && (key != NULL || klen == 0));
+#if defined(LEPT_THREADS)
+    pthread_mutex_lock(&st->lock);
+#endif
+    if ((e = lept_symtab_slot(st->entries, st->capacity, key, klen, hash))->k == NULL) {
+        if ((st->count + 1) * 2 > st->capacity) {
+            lept_symtab_entry *entries = (lept_symtab_entry *)calloc(st->capacity * 2, sizeof(lept_symtab_entry));
+            for (i = 0; i < st->capacity; i++)
+                if (st->entries[i].k != NULL)
+                    *lept_symtab_slot(entries, st->capacity * 2, st->entries[i].k, st->entries[i].klen, st->entries[i].hash) = st->entries[i];
+            free(st->entries);
+            st->entries = entries;
+            st->capacity *= 2;
+            e = lept_symtab_slot(st->entries, st->capacity, key, klen, hash);
+        }
+        k = (char *)lept_arena_alloc(&st->keys, klen + 1);
+        if (klen > 0)
+            memcpy(k, key, klen);
+        k[klen] = '\0';
+        e->k = k;
+        e->klen = klen;
+        e->hash = hash;
+        st->count++;
+    }
+    k = (char *)e->k;
+#if defined(LEPT_THREADS)
+    pthread_mutex_unlock(&st->lock);
+#endif
+    return k;
+}
+
+size_t lept_symtab_size(lept_symtab *st) {
+    size_t count;
+    assert(st != NULL);
+#if defined(LEPT_THREADS)
+    pthread_mutex_lock(&st->lock);
+#endif
+    count = st->count;
+#if defined(LEPT_THREADS)
+    pthread_mutex_unlock(&st->lock);
+#endif
+    return count;
+}
+
+/*
+ * An open array or object on the stack of a context, followed by its children. lept_parse_container() keeps
+ * the innermost one in a local lept_frame: its frame is written when a nested one is opened, and read back
+ * when that one is closed.
+ */
+typedef struct {
+    size_t parent;      /* offset of the enclosing frame */
+    size_t count;       /* children on the stack */
+    size_t type;        /* LEPT_ARRAY or LEPT_OBJECT */
+} lept_frame;
+
+#define LEPT_NO_FRAME           ((size_t)-1)
+#define LEPT_FRAME(stack, frame)    ((lept_frame *)((stack) + (frame)))
+
+/* Frees the children of frame and its enclosing frames */
+static void lept_frame_unwind(char *stack, size_t frame, int keys_borrowed) {
+    size_t i;
+    while (frame != LEPT_NO_FRAME) {
+        lept_frame f = *LEPT_FRAME(stack, frame);
+        char *child = stack + frame + sizeof(lept_frame);
+        for (i = 0; i < f.count; ++i) {
+            if (f.type == LEPT_ARRAY)
+                lept_free((lept_value *)child + i);
+            else {
+                if (!keys_borrowed)
+                    lept_member_free_key((lept_member *)child + i);
+                lept_free(&((lept_member *)child)[i].v);
+            }
+        }
+        frame = f.parent;
+    }
+}
+
+static int lept_parse_value(lept_context *c, lept_value *v);
+
+/* Opens the array or object at c, the parse fails if it is nested deeper than c->max_depth */
+static int lept_parse_open(lept_context *c, size_t *frame, lept_frame *f) {
+    lept_type type = *c->json == '[' ? LEPT_ARRAY : LEPT_OBJECT;
+    int ret;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->json++;
+    if (c->handler != NULL) {
+        ret = type == LEPT_ARRAY ? LEPT_SAX(c, start_array, (c->sax_ctx)) : LEPT_SAX(c, start_object, (c->sax_ctx));
+        if (ret != LEPT_PARSE_OK)
+            return ret;
+    }
+    if (*frame != LEPT_NO_FRAME)
+        *LEPT_FRAME(c->stack, *frame) = *f;
+    f->parent = *frame;
+    f->count = 0;
+    f->type = type;
+    *frame = (char *)lept_context_push(c, sizeof(lept_frame)) - c->stack;
+    c->depth++;
+    return LEPT_PARSE_OK;
+}
+
+/* Moves the children of the innermost container into v, pops it and restores the enclosing one */
+static int lept_parse_close(lept_context *c, size_t *frame, lept_frame *f, lept_value *v) {
+    const char *child = c->stack + *frame + sizeof(lept_frame);
+    size_t count = f->count;
+    lept_type type = (lept_type)f->type;
+    if (count > LEPT_SIZE_MAX && c->handler == NULL)
+        return LEPT_PARSE_SIZE_TOO_BIG;     /* the frame is still there to be unwound */
+    c->top = *frame;
+    if ((*frame = f->parent) != LEPT_NO_FRAME)
+        *f = *LEPT_FRAME(c->stack, *frame);
+    c->depth--;
+    lept_init(v);
+    if (c->handler != NULL)
+        return type == LEPT_ARRAY ?
+            LEPT_SAX(c, end_array, (c->sax_ctx, count)) : LEPT_SAX(c, end_object, (c->sax_ctx, count));
+    v->type = type;
+    if (type == LEPT_ARRAY) {
+        LEPT_ARRAY_SIZE(v) = count;
+        if (count == 0) {
+            lept_set_array_storage(v, NULL, 0);
+            return LEPT_PARSE_OK;
+        }
+        v->flags = c->arena != NULL ? LEPT_VALUE_BORROWED : 0;
+        lept_set_array_storage(v, lept_context_alloc(c, LEPT_ARRAY_STORAGE_SIZE(count)), count);
+        memcpy(v->u.a.e, child, count * sizeof(lept_value));
+    }
+    else {
+        LEPT_OBJECT_SIZE(v) = count;
+        if (count == 0) {
+            lept_set_object_storage(v, NULL, 0);
+            return LEPT_PARSE_OK;
+        }
+        v->flags = (c->arena != NULL ? LEPT_VALUE_BORROWED : 0) |
+                   (LEPT_CONTEXT_BORROWS_KEYS(c) ? LEPT_VALUE_KEYS_BORROWED : 0);
+        lept_set_object_storage(v, lept_context_alloc(c, lept_object_storage_size(count)), count);
+        memcpy(v->u.o.m, child, count * sizeof(lept_member));
+        lept_object_index_rebuild(v);
+    }
+    return LEPT_PARSE_OK;
+}
+
+/* Parses the key of a member of the innermost object and pushes the member */
+static int lept_parse_member(lept_context *c, lept_frame *f) {
+    lept_member m;
+    char *str = NULL;
+    int ret;
+    if (PEEK(c) != '"' || lept_parse_string_raw(c, &str, &m.klen) != LEPT_PARSE_OK)
+        return LEPT_PARSE_MISS_KEY;
+    if (c->handler != NULL) {
+        if ((ret = LEPT_SAX(c, key, (c->sax_ctx, str, m.klen))) != LEPT_PARSE_OK)
+            return ret;
+    }
+    else {
+        if (LEPT_KEY_INLINE(m.klen))
+            lept_member_copy_key(&m, str, m.klen);
+        else if (c->insitu)
+            m.k.p = str;
+        else if (c->symtab != NULL)
+            m.k.p = (char *)lept_symtab_intern(c->symtab, str, m.klen);
+        else {
+            m.k.p = (char *)lept_context_alloc(c, m.klen + 1);
+            m.k.p[m.klen] = '\0';
+            memcpy(m.k.p, str, m.klen);
         }
+        lept_init(&m.v);
         memcpy(lept_context_push(c, sizeof(lept_member)), &m, sizeof(lept_member));
-        size++;
-        m.k = NULL;     /* ownership is transferred to member on stack */
-        /* parse ws [comma | right curly brace] ws */
+    }
+    f->count++;     /* the member is freed with the frame from now on */
+    return LEPT_PARSE_OK;
+}
+
+/* Parses the key and colon of a member of the innermost object and pushes the member */
+static int lept_parse_key(lept_context *c, lept_frame *f) {
+    int ret;
+    if ((ret = lept_parse_member(c, f)) != LEPT_PARSE_OK)
+        return ret;
+    lept_parse_whitespace(c);
+    if (PEEK(c) != ':')
+        return LEPT_PARSE_MISS_COLON;
+    c->json++;
+    lept_parse_whitespace(c);
+    return LEPT_PARSE_OK;
+}
+
+#define LEPT_FRAME_END(f)   ((f).type == LEPT_ARRAY ? ']' : '}')
+
+/*
+ * Parses the array or object at c. Nested ones are parsed in the same loop, their frames and children
+ * are interleaved on c->stack, so the nesting is only bounded by c->max_depth and not the C stack.
+ */
+static int lept_parse_container(lept_context *c, lept_value *v) {
+    size_t frame = LEPT_NO_FRAME, top = c->top, depth = c->depth;
+    lept_frame f;
+    lept_value e;
+    int ret, open = 1, end = 0;
+    for (;;) {
+        if (open) {
+            /* c->json is at a nested array or object */
+            if ((ret = lept_parse_open(c, &frame, &f)) != LEPT_PARSE_OK)
+                break;
+            open = 0;
+            lept_parse_whitespace(c);
+            if ((end = PEEK(c) == LEPT_FRAME_END(f)) != 0)
+                c->json++;
+        }
+        if (end) {
+            /* the innermost container is complete, it becomes e in the enclosing one */
+            if ((ret = lept_parse_close(c, &frame, &f, &e)) != LEPT_PARSE_OK)
+                break;
+            if (frame == LEPT_NO_FRAME) {
+                *v = e;
+                return LEPT_PARSE_OK;
+            }
+        }
+        else {
+            if (f.type == LEPT_OBJECT && (ret = lept_parse_key(c, &f)) != LEPT_PARSE_OK)
+                break;
+            if ((PEEK(c) == '[' || PEEK(c) == '{') && !c->lazy && c->split_depth == 0) {
+                open = 1;
+                continue;
+            }
+            lept_init(&e);
+            if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK)
+                break;
+        }
+        if (f.type == LEPT_ARRAY) {
+            if (c->handler == NULL)
+                memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
+            f.count++;
+        }
+        else if (c->handler == NULL)
+            ((lept_member *)(c->stack + c->top) - 1)->v = e;
         lept_parse_whitespace(c);
-        if (*c->json == '}') {
+        if (PEEK(c) == ',') {
             c->json++;
-            lept_set_object(v, size);
-            v->u.o.size = size;
-            size *= sizeof(lept_member);
-            memcpy(v->u.o.m, lept_context_pop(c, size), size);
-            return LEPT_PARSE_OK;
+            lept_parse_whitespace(c);
+            end = 0;
         }
-        else if (*c->json == ',') {
+        else if (PEEK(c) == LEPT_FRAME_END(f)) {
             c->json++;
+            end = 1;
+        }
+        else {
+            ret = f.type == LEPT_ARRAY ?
+                LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            break;
+        }
+    }
+    if (frame != LEPT_NO_FRAME && c->handler == NULL) {
+        *LEPT_FRAME(c->stack, frame) = f;
+        lept_frame_unwind(c->stack, frame, LEPT_CONTEXT_BORROWS_KEYS(c));
+    }
+    c->top = top;
+    c->depth = depth;
+    return ret;
+}
+
+enum {
+    LEPT_INDEXED_VALUE,     /* t is a value */
+    LEPT_INDEXED_KEY,       /* t is a key */
+    LEPT_INDEXED_CLOSE,     /* the innermost container is complete, t follows it */
+    LEPT_INDEXED_APPEND     /* e is complete, t follows it */
+};
+
+/*
+ * The token after a string, number or literal that ends at c->json: the next position of the index, unless
+ * something else than whitespace comes first. That character is never a valid token, it fails the parse
+ * like it does without an index.
+ */
+static const char* lept_indexed_follow(const lept_context *c, const char *next) {
+    assert(c->json <= next);
+    return c->json == next || ISWHITESPACE(*c->json) ? next : c->json;
+}
+
+/*
+ * Stage 2 of the two-stage parser: the tokens are the positions of c->index in order, so brackets, commas,
+ * colons and the starts of values are found without looking at the whitespace between them. Strings,
+ * numbers and literals are parsed by the functions above. Containers are kept on c->stack like in
+ * lept_parse_container(), whose error codes are the same.
+ */
+static int lept_parse_indexed(lept_context *c, lept_value *v) {
+    const uint64_t *index = c->index;
+    uint64_t bits = index[0];
+    size_t w = 0, frame = LEPT_NO_FRAME, top = c->top, depth = c->depth;
+    const char *t = c->base + lept_structural_pop(index, &w, &bits);
+    lept_frame f;
+    lept_value e;
+    int ret = LEPT_PARSE_OK, state = LEPT_INDEXED_VALUE;
+    for (;;) {
+        if (state == LEPT_INDEXED_VALUE) {
+            c->json = t;
+            if (t != c->end && (*t == '[' || *t == '{')) {
+                if ((ret = lept_parse_open(c, &frame, &f)) != LEPT_PARSE_OK)
+                    break;
+                t = c->base + lept_structural_pop(index, &w, &bits);
+                if (t != c->end && *t == LEPT_FRAME_END(f)) {
+                    t = c->base + lept_structural_pop(index, &w, &bits);
+                    state = LEPT_INDEXED_CLOSE;
+                }
+                else if (f.type == LEPT_OBJECT)
+                    state = LEPT_INDEXED_KEY;
+                continue;
+            }
+            lept_init(&e);
+            if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK)
+                break;
+            t = lept_indexed_follow(c, c->base + lept_structural_pop(index, &w, &bits));
+        }
+        else if (state == LEPT_INDEXED_KEY) {
+            c->json = t;
+            if ((ret = lept_parse_member(c, &f)) != LEPT_PARSE_OK)
+                break;
+            t = lept_indexed_follow(c, c->base + lept_structural_pop(index, &w, &bits));
+            if (t == c->end || *t != ':') {
+                ret = LEPT_PARSE_MISS_COLON;
+                break;
+            }
+            t = c->base + lept_structural_pop(index, &w, &bits);
+            state = LEPT_INDEXED_VALUE;
             continue;
         }
+        else if (state == LEPT_INDEXED_CLOSE) {
+            if ((ret = lept_parse_close(c, &frame, &f, &e)) != LEPT_PARSE_OK)
+                break;
+        }
+        if (frame == LEPT_NO_FRAME) {
+            /* the root is complete, the caller checks that nothing follows it */
+            c->json = t;
+            *v = e;
+            return LEPT_PARSE_OK;
+        }
+        if (f.type == LEPT_ARRAY) {
+            if (c->handler == NULL)
+                memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
+            f.count++;
+        }
+        else if (c->handler == NULL)
+            ((lept_member *)(c->stack + c->top) - 1)->v = e;
+        if (t != c->end && *t == ',') {
+            t = c->base + lept_structural_pop(index, &w, &bits);
+            state = f.type == LEPT_ARRAY ? LEPT_INDEXED_VALUE : LEPT_INDEXED_KEY;
+        }
+        else if (t != c->end && *t == LEPT_FRAME_END(f)) {
+            t = c->base + lept_structural_pop(index, &w, &bits);
+            state = LEPT_INDEXED_CLOSE;
+        }
         else {
-            free(m.k);
-            ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            ret = f.type == LEPT_ARRAY ?
+                LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
             break;
         }
     }
-    /* pop and free members on the stack */
-    for (i = 0; i < size; ++i) {
-        lept_member *m = lept_context_pop(c, sizeof(lept_member));
-        free(m->k);
-        lept_free(&m->v);
+    if (frame != LEPT_NO_FRAME && c->handler == NULL) {
+        *LEPT_FRAME(c->stack, frame) = f;
+        lept_frame_unwind(c->stack, frame, LEPT_CONTEXT_BORROWS_KEYS(c));
     }
+    c->top = top;
+    c->depth = depth;
     return ret;
 }
 
+static int lept_parse_split(lept_context *c, lept_value *v);
+
 static int lept_parse_value(lept_context *c, lept_value *v) {
+    if (c->json == c->end)
+        return LEPT_PARSE_EXPECT_VALUE;
     switch (*c->json) {
         case 'n':  return lept_parse_literal(c, v, "null", LEPT_NULL);
         case 't':  return lept_parse_literal(c, v, "true", LEPT_TRUE);
         case 'f':  return lept_parse_literal(c, v, "false", LEPT_FALSE);
-        case '\0': return LEPT_PARSE_EXPECT_VALUE;
         case '"': return lept_parse_string(c, v);
-        case '[': return lept_parse_array(c, v);
-        case '{': return lept_parse_object(c, v);
+        case '[':
+        case '{':
+            if (c->lazy)
+                return lept_parse_lazy(c, v);
+            return c->split_depth > 0 ? lept_parse_split(c, v) : lept_parse_container(c, v);
         default:   return lept_parse_number(c, v);
     }
 }
 
+static int lept_parse_context(lept_context *c, lept_value *v);
+
+static unsigned lept_parse_flags = 0;
+
+void lept_set_parse_flags(unsigned flags) {
+    lept_parse_flags = flags;
+}
+
+unsigned lept_get_parse_flags(void) {
+    return lept_parse_flags;
+}
+
+static size_t lept_parse_max_depth = LEPT_PARSE_MAX_DEPTH;
+
+void lept_set_parse_max_depth(size_t depth) {
+    lept_parse_max_depth = depth;
+}
+
+size_t lept_get_parse_max_depth(void) {
+    return lept_parse_max_depth;
+}
+
+/* A context for parsing len bytes of json into a tree on the heap */
+static void lept_context_init(lept_context *c, const char *json, size_t len) {
+    c->json = json;
+    c->end = json + len;
+    c->arena = NULL;
+    c->insitu = 0;
+    c->handler = NULL;
+    c->sax_ctx = NULL;
+    c->flags = lept_parse_flags;
+    c->base = json;
+    c->index = NULL;
+    c->lazy = 0;
+    c->split_depth = 0;
+    c->split = NULL;
+    c->projection = NULL;
+    c->symtab = NULL;
+    c->depth = 0;
+    c->max_depth = lept_parse_max_depth;
+    lept_simd_resolve();    /* the scanners are used without checking */
+}
+
 int lept_parse(lept_value* v, const char* json) {
+    assert(json != NULL);
+    return lept_parse_n(v, json, strlen(json));
+}
+
+/* A null character within len is not the end of the text, it is rejected like any other invalid character */
+int lept_parse_n(lept_value *v, const char *json, size_t len) {
+    lept_context c;
+    assert(json != NULL);
+    lept_context_init(&c, json, len);
+    return lept_parse_context(&c, v);
+}
+
+/* Strings and keys are unescaped in json and point into it, so json must outlive v */
+int lept_parse_insitu(lept_value *v, char *json, size_t len) {
+    lept_context c;
+    assert(json != NULL);
+    lept_context_init(&c, json, len);
+    c.insitu = 1;
+    return lept_parse_context(&c, v);
+}
+
+int lept_parse_arena(lept_value *v, const char *json, lept_arena *arena) {
+    lept_context c;
+    assert(json != NULL && arena != NULL);
+    lept_context_init(&c, json, strlen(json));
+    c.arena = arena;
+    return lept_parse_context(&c, v);
+}
+
+/* Member keys are interned into st, which must outlive v */
+int lept_parse_symtab(lept_value *v, const char *json, size_t len, lept_symtab *st) {
+    lept_context c;
+    assert(json != NULL && st != NULL);
+    lept_context_init(&c, json, len);
+    c.symtab = st;
+    return lept_parse_context(&c, v);
+}
+
+int lept_parse_ex(lept_value *v, const char *json, size_t len, const lept_parse_options *options) {
+    lept_context c;
+    assert(json != NULL);
+    lept_context_init(&c, json, len);
+    if (options != NULL) {
+        c.flags = options->flags;
+        if (options->max_depth != 0)
+            c.max_depth = options->max_depth;
+    }
+    return lept_parse_context(&c, v);
+}
+
+/* Events are reported in document order, no tree is built and unescaped strings are not copied */
+int lept_parse_sax(const char *json, size_t len, const lept_handler *handler, void *ctx) {
     lept_context c;
+    lept_value v;
+    assert(json != NULL && handler != NULL);
+    lept_context_init(&c, json, len);
+    c.handler = handler;
+    c.sax_ctx = ctx;
+    return lept_parse_context(&c, &v);
+}
+
+static int lept_parse_projection(lept_context *c, lept_value *v, const lept_projection *node);
+
+/* Parses a whole JSON text, c must be set up with lept_context_init() */
+static int lept_parse_context(lept_context *c, lept_value *v) {
     int lept_parse_result = LEPT_PARSE_OK;
     assert(v != NULL);
-    c.json = json;
-    c.stack = NULL;
-    c.size = c.top = 0;
+    c->stack = NULL;
+    c->size = c->top = 0;
+    /* lazy values refer to the text, which is not kept for an arena, in situ or event based parse */
+    c->lazy = (c->flags & LEPT_PARSE_LAZY) && c->arena == NULL && !c->insitu && c->handler == NULL;
     lept_init(v);
-    lept_parse_whitespace(&c);
-    if ((lept_parse_result = lept_parse_value(&c, v)) != LEPT_PARSE_OK) {
-        assert(c.top == 0);
-        free(c.stack);
-        return lept_parse_result;
+    if ((c->flags & LEPT_PARSE_STRUCTURAL_INDEX) && !c->lazy && c->split == NULL && c->projection == NULL) {
+        c->index = lept_build_structural_index(c->base, c->end - c->base);
+        lept_parse_result = lept_parse_indexed(c, v);
     }
-    lept_parse_whitespace(&c);
-    if (*(c.json) != '\0') {
-        assert(c.top == 0);
-        free(c.stack);
-        v->type = LEPT_NULL;
-        return LEPT_PARSE_ROOT_NOT_SINGULAR;
+    else {
+        lept_parse_whitespace(c);
+        lept_parse_result = c->projection != NULL ? lept_parse_projection(c, v, c->projection) : lept_parse_value(c, v);
+    }
+    if (lept_parse_result == LEPT_PARSE_OK) {
+        lept_parse_whitespace(c);
+        if (c->json != c->end) {
+            lept_free(v);
+            lept_parse_result = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
     }
+    assert(c->top == 0);
+    free(c->stack);
+    free(c->index);
+    return lept_parse_result;
+}
+
+/* Parses one level of a lazy array or object, an invalid one becomes empty */
+int lept_expand(lept_value *v) {
+    lept_context c;
+    lept_value e;
+    int ret;
+    assert(v != NULL);
+    if (!(v->flags & LEPT_VALUE_LAZY))
+        return LEPT_PARSE_OK;
+    lept_context_init(&c, v->u.s.s, LEPT_SPAN_LEN(v));
+    c.lazy = 1;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    lept_init(&e);
+    ret = lept_parse_container(&c, &e);
     assert(c.top == 0);
     free(c.stack);
-    return LEPT_PARSE_OK;
+    if (ret == LEPT_PARSE_OK)
+        *v = e;
+    else if (v->type == LEPT_ARRAY)
+        lept_set_array(v, 0);
+    else
+        lept_set_object(v, 0);
+    return ret;
 }
 
-#define IS_ESCAPE_CHAR(ch) (ch) == '\"' || (ch) == '\\' || \
-                           (ch) == '\b' || \
-                           (ch) == '\f' || (ch) == '\n' || \
-                           (ch) == '\r' || (ch) == '\t'
+/*
+ * Incremental parsing. Open containers live on the stack of the parser as a frame followed by the
+ * children parsed so far, like lept_parse_container() keeps them. A string, number or literal that
+ * ends within a chunk is parsed in place by the functions above; only a token split by a chunk
+ * boundary is buffered at the top of the stack until its end arrives.
+ */
+enum {
+    LEPT_STREAM_VALUE,          /* expects a value */
+    LEPT_STREAM_ARRAY_FIRST,    /* expects a value or ']' */
+    LEPT_STREAM_OBJECT_FIRST,   /* expects a key or '}' */
+    LEPT_STREAM_KEY,            /* expects a key */
+    LEPT_STREAM_COLON,
+    LEPT_STREAM_AFTER_VALUE,    /* expects ',' or the end of the container */
+    LEPT_STREAM_DONE,           /* the root value is complete */
+    LEPT_STREAM_STRING,         /* within a buffered string */
+    LEPT_STREAM_KEY_STRING,     /* within a buffered key */
+    LEPT_STREAM_SCALAR          /* within a buffered number or literal */
+};
 
-static void lept_stringify_string(lept_context *c, const char *s, size_t len) {
-    int i;
-    PUT(c, '\"');
-    for (i = 0; i < len; ++i) {
-        char ch = s[i];
-        if (IS_ESCAPE_CHAR(ch)) {
-            PUT(c, '\\');
-            switch(ch) {
-                case '\"': PUT(c, '\"'); break;
-                case '\\': PUT(c, '\\'); break;
-                case '\b': PUT(c, 'b'); break;
-                case '\f': PUT(c, 'f'); break;
-                case '\n': PUT(c, 'n'); break;
-                case '\r': PUT(c, 'r'); break;
-                case '\t': PUT(c, 't'); break;
-                default:
-                    assert(0 && "invalid character");
-            }
+#define LEPT_STREAM_FRAME(s)    LEPT_FRAME((s)->stack, (s)->frame)
+#define ISSCALAR(ch)    (ISDIGIT(ch) || ((ch) >= 'a' && (ch) <= 'z') || (ch) == '-' || (ch) == '+' || (ch) == '.' || (ch) == 'E')
+
+static void* lept_stream_push(lept_stream_parser *s, size_t size) {
+    lept_context c;
+    void *ret;
+    c.stack = s->stack;
+    c.size = s->size;
+    c.top = s->top;
+    ret = lept_context_push(&c, size);
+    s->stack = c.stack;
+    s->size = c.size;
+    s->top = c.top;
+    return ret;
+}
+
+/* Frees the open containers and the root */
+static void lept_stream_unwind(lept_stream_parser *s) {
+    if (s->frame != LEPT_NO_FRAME)
+        lept_frame_unwind(s->stack, s->frame, 0);
+    s->frame = LEPT_NO_FRAME;
+    lept_free(&s->root);
+    s->top = 0;
+}
+
+static void lept_stream_error(lept_stream_parser *s, int error) {
+    s->error = error;
+    lept_stream_unwind(s);
+}
+
+/* Places a complete value into the innermost container, or makes it the root */
+static void lept_stream_emit(lept_stream_parser *s, const lept_value *v) {
+    s->state = LEPT_STREAM_AFTER_VALUE;
+    if (s->frame == LEPT_NO_FRAME) {
+        s->root = *v;
+        s->state = LEPT_STREAM_DONE;
+    }
+    else if (LEPT_STREAM_FRAME(s)->type == LEPT_ARRAY) {
+        memcpy(lept_stream_push(s, sizeof(lept_value)), v, sizeof(lept_value));
+        LEPT_STREAM_FRAME(s)->count++;
+    }
+    else
+        ((lept_member *)(s->stack + s->top) - 1)->v = *v;
+}
+
+static void lept_stream_open(lept_stream_parser *s, lept_type type) {
+    lept_frame *f;
+    if (s->depth >= s->max_depth) {
+        lept_stream_error(s, LEPT_PARSE_DEPTH_EXCEEDED);
+        return;
+    }
+    s->depth++;
+    f = (lept_frame *)lept_stream_push(s, sizeof(lept_frame));
+    f->parent = s->frame;
+    f->count = 0;
+    f->type = type;
+    s->frame = (char *)f - s->stack;
+    s->state = type == LEPT_ARRAY ? LEPT_STREAM_ARRAY_FIRST : LEPT_STREAM_OBJECT_FIRST;
+}
+
+/* Moves the children of the innermost container into a value, the same way lept_parse_close() does */
+static void lept_stream_close(lept_stream_parser *s) {
+    lept_frame f = *LEPT_STREAM_FRAME(s);
+    const char *child = s->stack + s->frame + sizeof(lept_frame);
+    lept_value v;
+    if (f.count > LEPT_SIZE_MAX) {
+        lept_stream_error(s, LEPT_PARSE_SIZE_TOO_BIG);
+        return;
+    }
+    v.type = (lept_type)f.type;
+    v.flags = 0;
+    if (f.type == LEPT_ARRAY) {
+        LEPT_ARRAY_SIZE(&v) = f.count;
+        lept_set_array_storage(&v, f.count > 0 ? malloc(LEPT_ARRAY_STORAGE_SIZE(f.count)) : NULL, f.count);
+        if (f.count > 0)
+            memcpy(v.u.a.e, child, f.count * sizeof(lept_value));
+    }
+    else {
+        LEPT_OBJECT_SIZE(&v) = f.count;
+        lept_set_object_storage(&v, f.count > 0 ? malloc(lept_object_storage_size(f.count)) : NULL, f.count);
+        if (f.count > 0)
+            memcpy(v.u.o.m, child, f.count * sizeof(lept_member));
+        lept_object_index_rebuild(&v);
+    }
+    s->top = s->frame;
+    s->frame = f.parent;
+    s->depth--;
+    lept_stream_emit(s, &v);
+}
+
+static void lept_stream_process(lept_stream_parser *s, const char *p, const char *end);
+
+/*
+ * Parses a complete token with lept_parse_value() and emits it. The token is [json, json + len),
+ * or the buffered token at the top of the stack if json is NULL.
+ */
+static void lept_stream_token(lept_stream_parser *s, const char *json, size_t len, int key) {
+    lept_context c;
+    lept_value v;
+    lept_member m;
+    int ret, trailing = 0, buffered = json == NULL;
+    char next = '\0';
+    c.stack = s->stack;
+    c.size = s->size;
+    c.top = s->top;
+    if (buffered) {
+        /* reserve room for the unescaped copy first, so that the token does not move while it is read */
+        lept_context_push(&c, len + 1);
+        c.top -= len + 1;
+        json = c.stack + s->token;
+    }
+    lept_context_init(&c, json, len);
+    if (key) {
+        char *str;
+        if (lept_parse_string_raw(&c, &str, &m.klen) != LEPT_PARSE_OK)
+            ret = LEPT_PARSE_MISS_KEY;
+        else {
+            ret = LEPT_PARSE_OK;
+            lept_member_copy_key(&m, str, m.klen);
+            lept_init(&m.v);
         }
-        else if (ch < 0x20) {
-            PUTS(c, "\\u00", 4);
-            sprintf(lept_context_push(c, 2), "%.2x", ch);
+    }
+    else {
+        lept_init(&v);
+        if ((ret = lept_parse_value(&c, &v)) == LEPT_PARSE_OK && c.json != c.end) {
+            trailing = 1;   /* e.g. "01" or "nullx", the rest is not a part of the value */
+            next = *c.json;
         }
-        else {
-            PUT(c, ch);
+    }
+    s->stack = c.stack;
+    s->size = c.size;
+    if (buffered)
+        s->top = s->token;
+    if (ret != LEPT_PARSE_OK)
+        lept_stream_error(s, ret);
+    else if (key) {
+        memcpy(lept_stream_push(s, sizeof(lept_member)), &m, sizeof(lept_member));
+        LEPT_STREAM_FRAME(s)->count++;
+        s->state = LEPT_STREAM_COLON;
+    }
+    else {
+        lept_stream_emit(s, &v);
+        /* no scalar character may follow a value, so the first one reports the error */
+        if (trailing)
+            lept_stream_process(s, &next, &next + 1);
+    }
+}
+
+static void lept_stream_buffer(lept_stream_parser *s, const char *p, const char *end) {
+    if (p != end)
+        memcpy(lept_stream_push(s, end - p), p, end - p);
+}
+
+/* Scans a string from p, after the opening quotation mark, returns the position after the closing one or NULL */
+static const char* lept_stream_scan_string(const char *p, const char *end, int *escape) {
+    for (;;) {
+        if (*escape) {
+            if (p == end)
+                return NULL;
+            p++;
+            *escape = 0;
         }
+        p = lept_simd_impl.scan_string(p, end);
+        if (p == end)
+            return NULL;
+        if (*p == '\"')
+            return p + 1;
+        *escape = *p++ == '\\';     /* a control character is left for the string parser to reject */
     }
-    PUT(c, '\"');
-    return;
 }
 
-static void lept_stringify_value(lept_context *c, const lept_value *v) {
-    int i;
-    switch(v->type) {
-        case LEPT_NULL:
-            PUTS(c, "null", 4);
-            break;
-        case LEPT_FALSE:
-            PUTS(c, "false", 5);
-            break;
-        case LEPT_TRUE:
-            PUTS(c, "true", 4);
-            break;
-        case LEPT_NUMBER:
-            c->top -= 32 - sprintf(lept_context_push(c, 32), "%.17g", v->u.n);
-            break;
-        case LEPT_STRING:
-            lept_stringify_string(c, v->u.s.s, v->u.s.len);
+/* Starts a string, key or scalar token at p and returns the position after it */
+static const char* lept_stream_start_token(lept_stream_parser *s, const char *p, const char *end, int state) {
+    const char *q;
+    if (state == LEPT_STREAM_SCALAR) {
+        for (q = p + 1; q != end && ISSCALAR(*q); q++)
+            ;
+        if (q != end) {
+            lept_stream_token(s, p, q - p, 0);
+            return q;
+        }
+    }
+    else if ((q = lept_stream_scan_string(p + 1, end, &s->escape)) != NULL) {
+        lept_stream_token(s, p, q - p, state == LEPT_STREAM_KEY_STRING);
+        return q;
+    }
+    /* the token goes on in the next chunk */
+    s->token = s->top;
+    s->state = state;
+    lept_stream_buffer(s, p, end);
+    return end;
+}
+
+static void lept_stream_process(lept_stream_parser *s, const char *p, const char *end) {
+    const char *q;
+    lept_simd_resolve();
+    while (p != end && s->error == LEPT_PARSE_OK) {
+        if (s->state == LEPT_STREAM_STRING || s->state == LEPT_STREAM_KEY_STRING) {
+            q = lept_stream_scan_string(p, end, &s->escape);
+            lept_stream_buffer(s, p, q != NULL ? q : end);
+            if (q == NULL)
+                return;
+            p = q;
+            lept_stream_token(s, NULL, s->top - s->token, s->state == LEPT_STREAM_KEY_STRING);
+            continue;
+        }
+        if (s->state == LEPT_STREAM_SCALAR) {
+            for (q = p; q != end && ISSCALAR(*q); q++)
+                ;
+            lept_stream_buffer(s, p, q);
+            if (q == end)
+                return;
+            p = q;
+            lept_stream_token(s, NULL, s->top - s->token, 0);
+            continue;
+        }
+        if (ISWHITESPACE(*p)) {
+            p = lept_simd_impl.skip_whitespace(p, end);
+            continue;
+        }
+        switch (s->state) {
+            case LEPT_STREAM_ARRAY_FIRST:
+                if (*p == ']') {
+                    lept_stream_close(s);
+                    p++;
+                    break;
+                }
+                /* fall through */
+            case LEPT_STREAM_VALUE:
+                switch (*p) {
+                    case '[': lept_stream_open(s, LEPT_ARRAY); p++; break;
+                    case '{': lept_stream_open(s, LEPT_OBJECT); p++; break;
+                    case '\"': p = lept_stream_start_token(s, p, end, LEPT_STREAM_STRING); break;
+                    default:
+                        if (ISSCALAR(*p))
+                            p = lept_stream_start_token(s, p, end, LEPT_STREAM_SCALAR);
+                        else
+                            lept_stream_error(s, LEPT_PARSE_INVALID_VALUE);
+                }
+                break;
+            case LEPT_STREAM_OBJECT_FIRST:
+            case LEPT_STREAM_KEY:
+                if (*p == '}' && s->state == LEPT_STREAM_OBJECT_FIRST) {
+                    lept_stream_close(s);
+                    p++;
+                }
+                else if (*p == '\"')
+                    p = lept_stream_start_token(s, p, end, LEPT_STREAM_KEY_STRING);
+                else
+                    lept_stream_error(s, LEPT_PARSE_MISS_KEY);
+                break;
+            case LEPT_STREAM_COLON:
+                if (*p++ == ':')
+                    s->state = LEPT_STREAM_VALUE;
+                else
+                    lept_stream_error(s, LEPT_PARSE_MISS_COLON);
+                break;
+            case LEPT_STREAM_AFTER_VALUE:
+                if (LEPT_STREAM_FRAME(s)->type == LEPT_ARRAY) {
+                    if (*p == ',')
+                        s->state = LEPT_STREAM_VALUE;
+                    else if (*p == ']')
+                        lept_stream_close(s);
+                    else
+                        lept_stream_error(s, LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+                }
+                else {
+                    if (*p == ',')
+                        s->state = LEPT_STREAM_KEY;
+                    else if (*p == '}')
+                        lept_stream_close(s);
+                    else
+                        lept_stream_error(s, LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+                }
+                p++;
+                break;
+            default:
+                lept_stream_error(s, LEPT_PARSE_ROOT_NOT_SINGULAR);
+        }
+    }
+}
+
+void lept_stream_init(lept_stream_parser *s) {
+    assert(s != NULL);
+    s->stack = NULL;
+    s->size = s->top = 0;
+    s->frame = LEPT_NO_FRAME;
+    s->depth = 0;
+    s->max_depth = lept_parse_max_depth;
+    s->token = 0;
+    s->state = LEPT_STREAM_VALUE;
+    s->error = LEPT_PARSE_OK;
+    s->escape = 0;
+    lept_init(&s->root);
+}
+
+/* Returns the first error found so far, the rest of the text is ignored after an error */
+int lept_stream_feed(lept_stream_parser *s, const char *buf, size_t len) {
+    assert(s != NULL && (buf != NULL || len == 0));
+    lept_stream_process(s, buf, buf + len);
+    return s->error;
+}
+
+/* Ends the text and releases the parser, v receives the value on success */
+int lept_stream_finish(lept_stream_parser *s, lept_value *v) {
+    int ret;
+    assert(s != NULL && v != NULL);
+    if (s->error == LEPT_PARSE_OK && s->state >= LEPT_STREAM_STRING)
+        lept_stream_token(s, NULL, s->top - s->token, s->state == LEPT_STREAM_KEY_STRING);
+    if (s->error == LEPT_PARSE_OK) {
+        /* the errors the parser reports at the end of the text */
+        switch (s->state) {
+            case LEPT_STREAM_DONE: break;
+            case LEPT_STREAM_VALUE:
+            case LEPT_STREAM_ARRAY_FIRST: lept_stream_error(s, LEPT_PARSE_EXPECT_VALUE); break;
+            case LEPT_STREAM_OBJECT_FIRST:
+            case LEPT_STREAM_KEY: lept_stream_error(s, LEPT_PARSE_MISS_KEY); break;
+            case LEPT_STREAM_COLON: lept_stream_error(s, LEPT_PARSE_MISS_COLON); break;
+            default:
+                lept_stream_error(s, LEPT_STREAM_FRAME(s)->type == LEPT_ARRAY ?
+                    LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+        }
+    }
+    ret = s->error;
+    lept_init(v);
+    if (ret == LEPT_PARSE_OK) {
+        *v = s->root;
+        lept_init(&s->root);
+    }
+    lept_stream_free(s);
+    return ret;
+}
+
+/* Releases a parser without finishing it */
+void lept_stream_free(lept_stream_parser *s) {
+    assert(s != NULL);
+    lept_stream_unwind(s);
+    free(s->stack);
+    lept_stream_init(s);
+}
+
+/*
+ * NDJSON: the buffer is cut into chunks at line boundaries, which worker threads claim one at a time.
+ * In order mode each chunk keeps its records and the chunks are concatenated at the end.
+ */
+typedef struct {
+    const char *begin, *end;
+    lept_value *values;     /* parsed records in order mode */
+    size_t count, capacity;
+    int ret;                /* the first error in the chunk */
+} lept_ndjson_chunk;
+
+typedef struct {
+    const char *json;
+    lept_ndjson_chunk *chunks;
+    size_t chunk_count, next;   /* next chunk to claim */
+    int stop;                   /* no more chunks are claimed after an error */
+    lept_ndjson_func func;      /* unordered mode if not NULL */
+    void *ctx;
+#if defined(LEPT_THREADS)
+    pthread_mutex_t lock;
+#endif
+} lept_ndjson_job;
+
+static void lept_ndjson_parse_chunk(lept_ndjson_job *job, lept_ndjson_chunk *chunk) {
+    const char *p = chunk->begin, *eol;
+    lept_value v;
+    while (p != chunk->end && chunk->ret == LEPT_PARSE_OK) {
+        if ((eol = (const char *)memchr(p, '\n', chunk->end - p)) == NULL)
+            eol = chunk->end;
+        if (lept_simd_impl.skip_whitespace(p, eol) != eol) {   /* blank lines are skipped */
+            int ret = lept_parse_n(&v, p, eol - p);
+            if (job->func != NULL) {
+                if (!job->func(job->ctx, p - job->json, ret, &v))
+                    chunk->ret = LEPT_PARSE_CANCELED;
+                lept_free(&v);
+            }
+            else if ((chunk->ret = ret) == LEPT_PARSE_OK) {
+                if (chunk->count == chunk->capacity) {
+                    chunk->capacity = chunk->capacity == 0 ? 16 : chunk->capacity * 2;
+                    chunk->values = (lept_value *)realloc(chunk->values, chunk->capacity * sizeof(lept_value));
+                }
+                chunk->values[chunk->count++] = v;
+            }
+        }
+        p = eol != chunk->end ? eol + 1 : eol;
+    }
+}
+
+static void* lept_ndjson_worker(void *arg) {
+    lept_ndjson_job *job = (lept_ndjson_job *)arg;
+    lept_ndjson_chunk *chunk;
+    for (;;) {
+#if defined(LEPT_THREADS)
+        pthread_mutex_lock(&job->lock);
+#endif
+        chunk = !job->stop && job->next < job->chunk_count ? &job->chunks[job->next++] : NULL;
+#if defined(LEPT_THREADS)
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (chunk == NULL)
+            return NULL;
+        lept_ndjson_parse_chunk(job, chunk);
+        if (chunk->ret != LEPT_PARSE_OK) {
+#if defined(LEPT_THREADS)
+            pthread_mutex_lock(&job->lock);
+#endif
+            job->stop = 1;
+#if defined(LEPT_THREADS)
+            pthread_mutex_unlock(&job->lock);
+#endif
+        }
+    }
+}
+
+/* The number of worker threads, one per processor if threads <= 0 */
+static int lept_thread_count(int threads) {
+    if (threads <= 0) {
+#if defined(LEPT_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (threads <= 0)
+            threads = 1;
+    }
+    return threads;
+}
+
+/* Bytes of input per unit of work: several units per thread balance uneven records */
+static size_t lept_chunk_size(size_t len, int threads) {
+    size_t chunk_size = len / ((size_t)threads * 4);
+    if (chunk_size > LEPT_NDJSON_CHUNK_SIZE)
+        chunk_size = LEPT_NDJSON_CHUNK_SIZE;
+    if (chunk_size < 4096)
+        chunk_size = 4096;
+    return chunk_size;
+}
+
+/* Runs worker in threads - 1 new threads and in the calling one, until all of them return */
+static void lept_run_workers(void* (*worker)(void *), void *job, int threads) {
+#if defined(LEPT_THREADS)
+    pthread_t *workers = threads > 1 ? (pthread_t *)malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    int i, started = 0;
+    while (started < threads - 1 && pthread_create(&workers[started], NULL, worker, job) == 0)
+        started++;
+    worker(job);
+    for (i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    free(workers);
+#else
+    worker(job);
+#endif
+}
+
+/* Returns the first error in input order, as chunks are claimed in order and each is finished once claimed */
+static int lept_ndjson_run(lept_ndjson_job *job, const char *json, size_t len, int threads) {
+    const char *p = json, *end = json + len, *q;
+    size_t i, chunk_size;
+    int ret = LEPT_PARSE_OK;
+    assert(json != NULL || len == 0);
+    threads = lept_thread_count(threads);
+    chunk_size = lept_chunk_size(len, threads);
+
+    job->json = json;
+    job->chunks = (lept_ndjson_chunk *)malloc((len / chunk_size + 1) * sizeof(lept_ndjson_chunk));
+    job->chunk_count = job->next = 0;
+    job->stop = 0;
+    while (p != end) {
+        lept_ndjson_chunk *chunk = &job->chunks[job->chunk_count++];
+        if ((size_t)(end - p) <= chunk_size || (q = (const char *)memchr(p + chunk_size, '\n', end - p - chunk_size)) == NULL)
+            q = end;
+        else
+            q++;
+        chunk->begin = p;
+        chunk->end = q;
+        chunk->values = NULL;
+        chunk->count = chunk->capacity = 0;
+        chunk->ret = LEPT_PARSE_OK;
+        p = q;
+    }
+
+    lept_simd_resolve();
+    if ((size_t)threads > job->chunk_count)
+        threads = (int)job->chunk_count;
+#if defined(LEPT_THREADS)
+    pthread_mutex_init(&job->lock, NULL);
+#endif
+    lept_run_workers(lept_ndjson_worker, job, threads);
+#if defined(LEPT_THREADS)
+    pthread_mutex_destroy(&job->lock);
+#endif
+
+    for (i = 0; i < job->chunk_count && ret == LEPT_PARSE_OK; ++i)
+        ret = job->chunks[i].ret;
+    return ret;
+}
+
+/* Parses one JSON text per line into an array in input order, blank lines are skipped */
+int lept_parse_ndjson(lept_value *v, const char *json, size_t len, int threads) {
+    lept_ndjson_job job;
+    size_t i, j, total = 0;
+    int ret;
+    assert(v != NULL);
+    job.func = NULL;
+    job.ctx = NULL;
+    ret = lept_ndjson_run(&job, json, len, threads);
+    lept_init(v);
+    if (ret == LEPT_PARSE_OK) {
+        for (i = 0; i < job.chunk_count; ++i)
+            total += job.chunks[i].count;
+        lept_set_array(v, total);
+        for (i = 0; i < job.chunk_count; ++i) {
+            if (job.chunks[i].count > 0)
+                memcpy(v->u.a.e + LEPT_ARRAY_SIZE(v), job.chunks[i].values, job.chunks[i].count * sizeof(lept_value));
+            LEPT_ARRAY_SIZE(v) += job.chunks[i].count;
+        }
+    }
+    else {
+        for (i = 0; i < job.chunk_count; ++i)
+            for (j = 0; j < job.chunks[i].count; ++j)
+                lept_free(&job.chunks[i].values[j]);
+    }
+    for (i = 0; i < job.chunk_count; ++i)
+        free(job.chunks[i].values);
+    free(job.chunks);
+    return ret;
+}
+
+/* Reports each record to func as soon as it is parsed, from any of the threads and in no particular order */
+int lept_parse_ndjson_each(const char *json, size_t len, int threads, lept_ndjson_func func, void *ctx) {
+    lept_ndjson_job job;
+    int ret;
+    assert(func != NULL);
+    job.func = func;
+    job.ctx = ctx;
+    ret = lept_ndjson_run(&job, json, len, threads);
+    free(job.chunks);
+    return ret;
+}
+
+/*
+ * Parallel parsing of large arrays. The text is parsed serially, except for the elements of arrays
+ * at the split depth: their ends are found by lept_skip_value() and they become tasks, which worker
+ * threads claim in batches and parse straight into their slots of the array. On any error the text
+ * is parsed again serially without building a tree, which reports the first error in document order.
+ */
+typedef struct {
+    const char *begin, *end;
+    lept_value *v;          /* the slot of the element */
+} lept_parallel_task;
+
+struct lept_parallel_job {
+    lept_parallel_task *tasks;
+    size_t count, capacity;
+    size_t *batches;        /* the first task of each batch, then count */
+    size_t batch_count, next;   /* next batch to claim */
+    lept_arena *arena;      /* if not NULL, each thread parses into an arena of its own merged into this one */
+    size_t depth;           /* the nesting of the elements */
+    int ret;                /* the first error found by any thread */
+#if defined(LEPT_THREADS)
+    pthread_mutex_t lock;
+#endif
+};
+
+/* An array or object, at the split depth an array whose elements are left to the worker threads */
+static int lept_parse_split(lept_context *c, lept_value *v) {
+    lept_parallel_job *job = c->split;
+    size_t first = job->count, size, i;
+    int ret;
+    if (--c->split_depth > 0 || *c->json != '[') {
+        ret = lept_parse_container(c, v);
+        c->split_depth++;
+        return ret;
+    }
+    c->split_depth++;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->json++;
+    lept_parse_whitespace(c);
+    if (PEEK(c) == ']') {
+        c->json++;
+        v->type = LEPT_ARRAY;
+        LEPT_ARRAY_SIZE(v) = 0;
+        lept_set_array_storage(v, NULL, 0);
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        const char *end;
+        lept_parallel_task *task;
+        lept_parse_whitespace(c);
+        if ((end = lept_skip_value(c->json, c->end)) == NULL || end == c->json) {
+            ret = LEPT_PARSE_INVALID_VALUE;     /* the exact error is found by the serial parse */
+            break;
+        }
+        if (job->count == job->capacity) {
+            job->capacity = job->capacity == 0 ? 1024 : job->capacity * 2;
+            job->tasks = (lept_parallel_task *)realloc(job->tasks, job->capacity * sizeof(lept_parallel_task));
+        }
+        task = &job->tasks[job->count++];
+        task->begin = c->json;
+        task->end = c->json = end;
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',')
+            c->json++;
+        else if (PEEK(c) == ']') {
+            c->json++;
+            if ((size = job->count - first) > LEPT_SIZE_MAX) {
+                ret = LEPT_PARSE_SIZE_TOO_BIG;
+                break;
+            }
+            v->type = LEPT_ARRAY;
+            v->flags = c->arena != NULL ? LEPT_VALUE_BORROWED : 0;
+            LEPT_ARRAY_SIZE(v) = size;
+            lept_set_array_storage(v, lept_context_alloc(c, LEPT_ARRAY_STORAGE_SIZE(size)), size);
+            for (i = 0; i < LEPT_ARRAY_SIZE(v); ++i) {
+                lept_init(&v->u.a.e[i]);
+                job->tasks[first + i].v = &v->u.a.e[i];
+            }
+            return LEPT_PARSE_OK;
+        }
+        else {
+            ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+    job->count = first;
+    return ret;
+}
+
+static void lept_parallel_fail(lept_parallel_job *job, int ret) {
+#if defined(LEPT_THREADS)
+    pthread_mutex_lock(&job->lock);
+#endif
+    if (job->ret == LEPT_PARSE_OK)
+        job->ret = ret;
+#if defined(LEPT_THREADS)
+    pthread_mutex_unlock(&job->lock);
+#endif
+}
+
+static void* lept_parallel_worker(void *arg) {
+    lept_parallel_job *job = (lept_parallel_job *)arg;
+    lept_arena arena;
+    size_t batch, i;
+    if (job->arena != NULL)
+        lept_arena_init(&arena, job->arena->block_size);
+    for (;;) {
+#if defined(LEPT_THREADS)
+        pthread_mutex_lock(&job->lock);
+#endif
+        batch = job->ret == LEPT_PARSE_OK && job->next < job->batch_count ? job->next++ : job->batch_count;
+#if defined(LEPT_THREADS)
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (batch == job->batch_count)
+            break;
+        for (i = job->batches[batch]; i < job->batches[batch + 1]; ++i) {
+            lept_parallel_task *task = &job->tasks[i];
+            lept_context c;
+            int ret;
+            lept_context_init(&c, task->begin, task->end - task->begin);
+            c.depth = job->depth;
+            if (job->arena != NULL)
+                c.arena = &arena;
+            if ((ret = lept_parse_context(&c, task->v)) != LEPT_PARSE_OK) {
+                lept_parallel_fail(job, ret);
+                break;
+            }
+        }
+    }
+    if (job->arena != NULL) {
+#if defined(LEPT_THREADS)
+        pthread_mutex_lock(&job->lock);
+#endif
+        lept_arena_merge(job->arena, &arena);
+#if defined(LEPT_THREADS)
+        pthread_mutex_unlock(&job->lock);
+#endif
+    }
+    return NULL;
+}
+
+/* Elements of arrays at depth, 1 being the root, are parsed by threads threads, into arena if not NULL */
+int lept_parse_parallel(lept_value *v, const char *json, size_t len, int threads, int depth, lept_arena *arena) {
+    static const lept_handler validate = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    lept_parallel_job job;
+    lept_context c;
+    size_t i, bytes, chunk_size;
+    int ret;
+    assert(v != NULL && (json != NULL || len == 0) && depth > 0);
+    job.tasks = NULL;
+    job.count = job.capacity = 0;
+    job.batches = NULL;
+    job.batch_count = job.next = 0;
+    job.arena = arena;
+    job.depth = (size_t)depth;
+    job.ret = LEPT_PARSE_OK;
+    lept_context_init(&c, json, len);
+    c.arena = arena;
+    c.split_depth = depth;
+    c.split = &job;
+    if ((ret = lept_parse_context(&c, v)) == LEPT_PARSE_OK && job.count > 0) {
+        /* consecutive tasks are batched up to the chunk size, a batch boundary is a task boundary */
+        threads = lept_thread_count(threads);
+        chunk_size = lept_chunk_size(len, threads);
+        job.batches = (size_t *)malloc((job.count + 1) * sizeof(size_t));
+        for (i = 0, bytes = chunk_size; i < job.count; ++i) {
+            if (bytes >= chunk_size) {
+                job.batches[job.batch_count++] = i;
+                bytes = 0;
+            }
+            bytes += job.tasks[i].end - job.tasks[i].begin;
+        }
+        job.batches[job.batch_count] = job.count;
+        if ((size_t)threads > job.batch_count)
+            threads = (int)job.batch_count;
+#if defined(LEPT_THREADS)
+        pthread_mutex_init(&job.lock, NULL);
+#endif
+        lept_run_workers(lept_parallel_worker, &job, threads);
+#if defined(LEPT_THREADS)
+        pthread_mutex_destroy(&job.lock);
+#endif
+        if ((ret = job.ret) != LEPT_PARSE_OK)
+            lept_free(v);
+    }
+    if (ret != LEPT_PARSE_OK) {
+        int first = lept_parse_sax(json, len, &validate, NULL);
+        if (first != LEPT_PARSE_OK)
+            ret = first;
+    }
+    free(job.tasks);
+    free(job.batches);
+    return ret;
+}
+
+/* Grisu2: shortest digits that round-trip, a diy_fp is f * 2^e */
+typedef struct {
+    uint64_t f;
+    int e;
+} lept_diy_fp;
+
+#define LEPT_DP_SIGNIFICAND_MASK    UINT64_C(0x000FFFFFFFFFFFFF)
+#define LEPT_DP_HIDDEN_BIT          UINT64_C(0x0010000000000000)
+#define LEPT_DP_EXPONENT_BIAS       1075    /* 1023 + 52 */
+
+/* 10^k for k = -348, -340, ..., 340, normalized and rounded to nearest */
+static const lept_diy_fp lept_cached_pow10[] = {
+    { UINT64_C(0xFA8FD5A0081C0288), -1220 },
+    { UINT64_C(0xBAAEE17FA23EBF76), -1193 },
+    { UINT64_C(0x8B16FB203055AC76), -1166 },
+    { UINT64_C(0xCF42894A5DCE35EA), -1140 },
+    { UINT64_C(0x9A6BB0AA55653B2D), -1113 },
+    { UINT64_C(0xE61ACF033D1A45DF), -1087 },
+    { UINT64_C(0xAB70FE17C79AC6CA), -1060 },
+    { UINT64_C(0xFF77B1FCBEBCDC4F), -1034 },
+    { UINT64_C(0xBE5691EF416BD60C), -1007 },
+    { UINT64_C(0x8DD01FAD907FFC3C),  -980 },
+    { UINT64_C(0xD3515C2831559A83),  -954 },
+    { UINT64_C(0x9D71AC8FADA6C9B5),  -927 },
+    { UINT64_C(0xEA9C227723EE8BCB),  -901 },
+    { UINT64_C(0xAECC49914078536D),  -874 },
+    { UINT64_C(0x823C12795DB6CE57),  -847 },
+    { UINT64_C(0xC21094364DFB5637),  -821 },
+    { UINT64_C(0x9096EA6F3848984F),  -794 },
+    { UINT64_C(0xD77485CB25823AC7),  -768 },
+    { UINT64_C(0xA086CFCD97BF97F4),  -741 },
+    { UINT64_C(0xEF340A98172AACE5),  -715 },
+    { UINT64_C(0xB23867FB2A35B28E),  -688 },
+    { UINT64_C(0x84C8D4DFD2C63F3B),  -661 },
+    { UINT64_C(0xC5DD44271AD3CDBA),  -635 },
+    { UINT64_C(0x936B9FCEBB25C996),  -608 },
+    { UINT64_C(0xDBAC6C247D62A584),  -582 },
+    { UINT64_C(0xA3AB66580D5FDAF6),  -555 },
+    { UINT64_C(0xF3E2F893DEC3F126),  -529 },
+    { UINT64_C(0xB5B5ADA8AAFF80B8),  -502 },
+    { UINT64_C(0x87625F056C7C4A8B),  -475 },
+    { UINT64_C(0xC9BCFF6034C13053),  -449 },
+    { UINT64_C(0x964E858C91BA2655),  -422 },
+    { UINT64_C(0xDFF9772470297EBD),  -396 },
+    { UINT64_C(0xA6DFBD9FB8E5B88F),  -369 },
+    { UINT64_C(0xF8A95FCF88747D94),  -343 },
+    { UINT64_C(0xB94470938FA89BCF),  -316 },
+    { UINT64_C(0x8A08F0F8BF0F156B),  -289 },
+    { UINT64_C(0xCDB02555653131B6),  -263 },
+    { UINT64_C(0x993FE2C6D07B7FAC),  -236 },
+    { UINT64_C(0xE45C10C42A2B3B06),  -210 },
+    { UINT64_C(0xAA242499697392D3),  -183 },
+    { UINT64_C(0xFD87B5F28300CA0E),  -157 },
+    { UINT64_C(0xBCE5086492111AEB),  -130 },
+    { UINT64_C(0x8CBCCC096F5088CC),  -103 },
+    { UINT64_C(0xD1B71758E219652C),   -77 },
+    { UINT64_C(0x9C40000000000000),   -50 },
+    { UINT64_C(0xE8D4A51000000000),   -24 },
+    { UINT64_C(0xAD78EBC5AC620000),     3 },
+    { UINT64_C(0x813F3978F8940984),    30 },
+    { UINT64_C(0xC097CE7BC90715B3),    56 },
+    { UINT64_C(0x8F7E32CE7BEA5C70),    83 },
+    { UINT64_C(0xD5D238A4ABE98068),   109 },
+    { UINT64_C(0x9F4F2726179A2245),   136 },
+    { UINT64_C(0xED63A231D4C4FB27),   162 },
+    { UINT64_C(0xB0DE65388CC8ADA8),   189 },
+    { UINT64_C(0x83C7088E1AAB65DB),   216 },
+    { UINT64_C(0xC45D1DF942711D9A),   242 },
+    { UINT64_C(0x924D692CA61BE758),   269 },
+    { UINT64_C(0xDA01EE641A708DEA),   295 },
+    { UINT64_C(0xA26DA3999AEF774A),   322 },
+    { UINT64_C(0xF209787BB47D6B85),   348 },
+    { UINT64_C(0xB454E4A179DD1877),   375 },
+    { UINT64_C(0x865B86925B9BC5C2),   402 },
+    { UINT64_C(0xC83553C5C8965D3D),   428 },
+    { UINT64_C(0x952AB45CFA97A0B3),   455 },
+    { UINT64_C(0xDE469FBD99A05FE3),   481 },
+    { UINT64_C(0xA59BC234DB398C25),   508 },
+    { UINT64_C(0xF6C69A72A3989F5C),   534 },
+    { UINT64_C(0xB7DCBF5354E9BECE),   561 },
+    { UINT64_C(0x88FCF317F22241E2),   588 },
+    { UINT64_C(0xCC20CE9BD35C78A5),   614 },
+    { UINT64_C(0x98165AF37B2153DF),   641 },
+    { UINT64_C(0xE2A0B5DC971F303A),   667 },
+    { UINT64_C(0xA8D9D1535CE3B396),   694 },
+    { UINT64_C(0xFB9B7CD9A4A7443C),   720 },
+    { UINT64_C(0xBB764C4CA7A44410),   747 },
+    { UINT64_C(0x8BAB8EEFB6409C1A),   774 },
+    { UINT64_C(0xD01FEF10A657842C),   800 },
+    { UINT64_C(0x9B10A4E5E9913129),   827 },
+    { UINT64_C(0xE7109BFBA19C0C9D),   853 },
+    { UINT64_C(0xAC2820D9623BF429),   880 },
+    { UINT64_C(0x80444B5E7AA7CF85),   907 },
+    { UINT64_C(0xBF21E44003ACDD2D),   933 },
+    { UINT64_C(0x8E679C2F5E44FF8F),   960 },
+    { UINT64_C(0xD433179D9C8CB841),   986 },
+    { UINT64_C(0x9E19DB92B4E31BA9),  1013 },
+    { UINT64_C(0xEB96BF6EBADF77D9),  1039 },
+    { UINT64_C(0xAF87023B9BF0EE6B),  1066 }
+};
+
+static const uint64_t lept_pow10_u64[] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+    UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+    UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000)
+};
+
+static lept_diy_fp lept_diy_fp_make(uint64_t f, int e) {
+    lept_diy_fp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+/* the product rounded to 64 bits */
+static lept_diy_fp lept_diy_fp_mul(lept_diy_fp a, lept_diy_fp b) {
+    uint64_t lo, hi = lept_mul128(a.f, b.f, &lo);
+    return lept_diy_fp_make(hi + (lo >> 63), a.e + b.e + 64);
+}
+
+static lept_diy_fp lept_diy_fp_normalize(lept_diy_fp a) {
+    int s = lept_clz64(a.f);
+    return lept_diy_fp_make(a.f << s, a.e - s);
+}
+
+static int lept_count_digits32(uint32_t n) {
+    int k = 1;
+    while (k < 10 && n >= lept_pow10_u64[k])
+        k++;
+    return k;
+}
+
+static void lept_grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int lept_grisu_digits(lept_diy_fp w, lept_diy_fp mp, uint64_t delta, char *buf, int *k) {
+    const lept_diy_fp one = lept_diy_fp_make(UINT64_C(1) << -mp.e, mp.e);
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = lept_count_digits32(p1), len = 0;
+    while (kappa > 0) {
+        uint32_t d = (uint32_t)(p1 / lept_pow10_u64[kappa - 1]);
+        p1 = (uint32_t)(p1 % lept_pow10_u64[kappa - 1]);
+        if (d || len)
+            buf[len++] = (char)('0' + d);
+        kappa--;
+        if ((((uint64_t)p1 << -one.e) + p2) <= delta) {
+            *k += kappa;
+            lept_grisu_round(buf, len, delta, ((uint64_t)p1 << -one.e) + p2, lept_pow10_u64[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+    for (;;) {
+        char d;
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> -one.e);
+        if (d || len)
+            buf[len++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            lept_grisu_round(buf, len, delta, p2, one.f, -kappa < 20 ? wp_w * lept_pow10_u64[-kappa] : 0);
+            return len;
+        }
+    }
+}
+
+/* d > 0, writes the digits to buf and returns their count, the value is buf * 10^k */
+static int lept_grisu2(double d, char *buf, int *k) {
+    uint64_t bits, sig;
+    int be, ck, index;
+    lept_diy_fp v, mp, mm, c_mk;
+    double dk;
+
+    memcpy(&bits, &d, sizeof(d));
+    sig = bits & LEPT_DP_SIGNIFICAND_MASK;
+    be = (int)((bits >> 52) & 0x7FF);
+    v = be ? lept_diy_fp_make(sig + LEPT_DP_HIDDEN_BIT, be - LEPT_DP_EXPONENT_BIAS)
+           : lept_diy_fp_make(sig, 1 - LEPT_DP_EXPONENT_BIAS);
+
+    /* boundaries halfway to the neighbours, m+ normalized and m- on the same exponent */
+    mp = lept_diy_fp_normalize(lept_diy_fp_make((v.f << 1) + 1, v.e - 1));
+    mm = v.f == LEPT_DP_HIDDEN_BIT ? lept_diy_fp_make((v.f << 2) - 1, v.e - 2)
+                                   : lept_diy_fp_make((v.f << 1) - 1, v.e - 1);
+    mm.f <<= mm.e - mp.e;
+    mm.e = mp.e;
+
+    /* a cached power bringing the exponent of m+ into [-60, -32] */
+    dk = (-61 - mp.e) * 0.30102999566398114 + 347;
+    ck = (int)dk;
+    if (dk - ck > 0.0)
+        ck++;
+    index = (ck >> 3) + 1;
+    *k = -(-348 + index * 8);
+    c_mk = lept_cached_pow10[index];
+
+    v = lept_diy_fp_mul(lept_diy_fp_normalize(v), c_mk);
+    mp = lept_diy_fp_mul(mp, c_mk);
+    mm = lept_diy_fp_mul(mm, c_mk);
+    mp.f--;
+    mm.f++;
+    return lept_grisu_digits(v, mp, mp.f - mm.f, buf, k);
+}
+
+/* Formats d like "%.17g" but with the shortest digits that parse back to d, returns the length */
+static int lept_format_double(char *buf, double d) {
+    char digits[24], *p = buf;
+    int len, k, x, i;
+    uint64_t bits;
+
+    memcpy(&bits, &d, sizeof(d));
+    if (bits >> 63)
+        *p++ = '-';
+    if ((bits << 1) == 0) {
+        *p++ = '0';
+        return (int)(p - buf);
+    }
+    len = lept_grisu2(d < 0 ? -d : d, digits, &k);
+    while (len > 1 && digits[len - 1] == '0') {
+        len--;
+        k++;
+    }
+
+    x = len + k - 1;    /* decimal exponent of the first digit */
+    if (x < -4 || x >= 17) {
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        if (x < 0)
+            x = -x;
+        if (x >= 100)
+            *p++ = (char)('0' + x / 100);
+        *p++ = (char)('0' + x / 10 % 10);
+        *p++ = (char)('0' + x % 10);
+    }
+    else if (x < 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (i = -1; i > x; i--)
+            *p++ = '0';
+        memcpy(p, digits, len);
+        p += len;
+    }
+    else if (len <= x + 1) {
+        memcpy(p, digits, len);
+        p += len;
+        for (i = len; i <= x; i++)
+            *p++ = '0';
+    }
+    else {
+        memcpy(p, digits, x + 1);
+        p += x + 1;
+        *p++ = '.';
+        memcpy(p, digits + x + 1, len - x - 1);
+        p += len - x - 1;
+    }
+    return (int)(p - buf);
+}
+
+/* Writer: output is gathered in a fixed-size buffer, which is handed to the sink whenever it fills up */
+
+static void lept_writer_flush_buffer(lept_writer *w) {
+    if (w->len > 0 && !w->error && !w->sink(w->ctx, w->buf, w->len))
+        w->error = 1;
+    w->len = 0;
+}
+
+static void lept_writer_put(lept_writer *w, const char *s, size_t len) {
+    if (w->len + len > LEPT_WRITER_BUFFER_SIZE) {
+        lept_writer_flush_buffer(w);
+        if (len >= LEPT_WRITER_BUFFER_SIZE) {
+            /* a long run goes to the sink without a copy */
+            if (!w->error && !w->sink(w->ctx, s, len))
+                w->error = 1;
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, s, len);
+    w->len += len;
+}
+
+#define LEPT_WRITER_PUTC(w, ch) \
+    do {\
+        if ((w)->len == LEPT_WRITER_BUFFER_SIZE)\
+            lept_writer_flush_buffer(w);\
+        (w)->buf[(w)->len++] = (ch);\
+    } while(0)
+
+/* Writes the ',' that is due before a value or a key */
+static void lept_writer_separate(lept_writer *w) {
+    if (w->comma)
+        LEPT_WRITER_PUTC(w, ',');
+    w->comma = 1;
+}
+
+/* Runs that need no escaping are found with the string scanner of the parser and copied at once */
+static void lept_writer_escape(lept_writer *w, const char *s, size_t len) {
+    static const char hex_digits[] = "0123456789abcdef";
+    const char *p = s, *end = s + len;
+    char u[6];
+    LEPT_WRITER_PUTC(w, '\"');
+    for (;;) {
+        const char *run = p;
+        p = lept_simd_impl.scan_string(p, end);
+        if (p != run)
+            lept_writer_put(w, run, p - run);
+        if (p == end)
+            break;
+        switch (*p) {
+            case '\"': lept_writer_put(w, "\\\"", 2); break;
+            case '\\': lept_writer_put(w, "\\\\", 2); break;
+            case '\b': lept_writer_put(w, "\\b", 2); break;
+            case '\f': lept_writer_put(w, "\\f", 2); break;
+            case '\n': lept_writer_put(w, "\\n", 2); break;
+            case '\r': lept_writer_put(w, "\\r", 2); break;
+            case '\t': lept_writer_put(w, "\\t", 2); break;
+            default:
+                u[0] = '\\';
+                u[1] = 'u';
+                u[2] = u[3] = '0';
+                u[4] = hex_digits[(unsigned char)*p >> 4];
+                u[5] = hex_digits[(unsigned char)*p & 0xF];
+                lept_writer_put(w, u, 6);
+        }
+        p++;
+    }
+    LEPT_WRITER_PUTC(w, '\"');
+}
+
+static int lept_writer_write_file(void *ctx, const char *buf, size_t len) {
+    return fwrite(buf, 1, len, ((lept_writer *)ctx)->fp) == len;
+}
+
+static int lept_writer_write_fd(void *ctx, const char *buf, size_t len) {
+    while (len > 0) {
+        long n = (long)LEPT_WRITE_FD(((lept_writer *)ctx)->fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+void lept_writer_init(lept_writer *w, lept_write_func sink, void *ctx) {
+    assert(w != NULL && sink != NULL);
+    w->sink = sink;
+    w->ctx = ctx;
+    w->fp = NULL;
+    w->fd = -1;
+    w->len = 0;
+    w->comma = 0;
+    w->error = 0;
+    lept_simd_resolve();
+}
+
+void lept_writer_init_file(lept_writer *w, FILE *fp) {
+    assert(fp != NULL);
+    lept_writer_init(w, lept_writer_write_file, w);
+    w->fp = fp;
+}
+
+void lept_writer_init_fd(lept_writer *w, int fd) {
+    assert(fd >= 0);
+    lept_writer_init(w, lept_writer_write_fd, w);
+    w->fd = fd;
+}
+
+/* Hands the buffered output to the sink, returns 0 if the sink has failed at any point */
+int lept_writer_flush(lept_writer *w) {
+    assert(w != NULL);
+    lept_writer_flush_buffer(w);
+    if (w->fp != NULL && fflush(w->fp) != 0)
+        w->error = 1;
+    return !w->error;
+}
+
+void lept_writer_null(lept_writer *w) {
+    lept_writer_separate(w);
+    lept_writer_put(w, "null", 4);
+}
+
+void lept_writer_boolean(lept_writer *w, int b) {
+    lept_writer_separate(w);
+    if (b)
+        lept_writer_put(w, "true", 4);
+    else
+        lept_writer_put(w, "false", 5);
+}
+
+void lept_writer_number(lept_writer *w, double n) {
+    lept_writer_separate(w);
+    if (w->len + 32 > LEPT_WRITER_BUFFER_SIZE)
+        lept_writer_flush_buffer(w);
+    w->len += lept_format_double(w->buf + w->len, n);
+}
+
+void lept_writer_string(lept_writer *w, const char *s, size_t len) {
+    assert(s != NULL || len == 0);
+    lept_writer_separate(w);
+    lept_writer_escape(w, s, len);
+}
+
+void lept_writer_key(lept_writer *w, const char *s, size_t len) {
+    assert(s != NULL || len == 0);
+    lept_writer_separate(w);
+    lept_writer_escape(w, s, len);
+    LEPT_WRITER_PUTC(w, ':');
+    w->comma = 0;
+}
+
+void lept_writer_begin_array(lept_writer *w) {
+    lept_writer_separate(w);
+    LEPT_WRITER_PUTC(w, '[');
+    w->comma = 0;
+}
+
+void lept_writer_end_array(lept_writer *w) {
+    LEPT_WRITER_PUTC(w, ']');
+    w->comma = 1;
+}
+
+void lept_writer_begin_object(lept_writer *w) {
+    lept_writer_separate(w);
+    LEPT_WRITER_PUTC(w, '{');
+    w->comma = 0;
+}
+
+void lept_writer_end_object(lept_writer *w) {
+    LEPT_WRITER_PUTC(w, '}');
+    w->comma = 1;
+}
+
+/* Writes v, or opens it and returns 1 if it is a container with children to write */
+static int lept_writer_node(lept_writer *w, const lept_value *v) {
+    LEPT_EXPAND(v);
+    switch(v->type) {
+        case LEPT_NULL:
+            lept_writer_null(w);
+            return 0;
+        case LEPT_FALSE:
+        case LEPT_TRUE:
+            lept_writer_boolean(w, v->type == LEPT_TRUE);
+            return 0;
+        case LEPT_NUMBER:
+            lept_writer_number(w, v->u.n);
+            return 0;
+        case LEPT_STRING:
+            lept_writer_string(w, LEPT_STRING(v), LEPT_STRING_LEN(v));
+            return 0;
+        case LEPT_ARRAY:
+            lept_writer_begin_array(w);
+            if (LEPT_ARRAY_SIZE(v) > 0)
+                return 1;
+            lept_writer_end_array(w);
+            return 0;
+        case LEPT_OBJECT:
+            lept_writer_begin_object(w);
+            if (LEPT_OBJECT_SIZE(v) > 0)
+                return 1;
+            lept_writer_end_object(w);
+            return 0;
+        default:
+            assert(0 && "invalid type");
+            return 0;
+    }
+}
+
+void lept_writer_value(lept_writer *w, const lept_value *v) {
+    lept_context s;
+    lept_visit *f;
+    size_t i = 0;
+    assert(w != NULL && v != NULL);
+    if (!lept_writer_node(w, v))
+        return;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    for (;;) {
+        if (i < (v->type == LEPT_ARRAY ? LEPT_ARRAY_SIZE(v) : LEPT_OBJECT_SIZE(v))) {
+            const lept_value *child;
+            if (v->type == LEPT_ARRAY)
+                child = &v->u.a.e[i];
+            else {
+                lept_writer_key(w, LEPT_KEY(&v->u.o.m[i]), v->u.o.m[i].klen);
+                child = &v->u.o.m[i].v;
+            }
+            i++;
+            if (lept_writer_node(w, child)) {
+                lept_visit_push(&s, (lept_value *)v, NULL, i);
+                v = child;
+                i = 0;
+            }
+        }
+        else {
+            if (v->type == LEPT_ARRAY)
+                lept_writer_end_array(w);
+            else
+                lept_writer_end_object(w);
+            if (s.top == 0)
+                break;
+            f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+            v = f->v;
+            i = f->i;
+        }
+    }
+    free(s.stack);
+}
+
+static int lept_stringify_write(void *ctx, const char *buf, size_t len) {
+    PUTS((lept_context *)ctx, buf, len);
+    return 1;
+}
+
+char* lept_stringify(const lept_value *v, size_t* length) {
+    lept_context c;
+    lept_writer w;
+    assert(v != NULL);
+    c.stack = (char *)malloc(c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    c.top = 0;
+    lept_writer_init(&w, lept_stringify_write, &c);
+    lept_writer_value(&w, v);
+    lept_writer_flush(&w);
+    if (length)
+        *length = c.top;
+    PUT(&c, '\0');
+    return c.stack;
+}
+
+/*
+ * MessagePack and CBOR share their number handling: a number is written as an integer if it is one
+ * within [-2^63, 2^64), else as a 64-bit float whose bits are written in big-endian order.
+ */
+static void lept_put_uint(lept_context *c, uint64_t u, int bytes) {
+    char *p = (char *)lept_context_push(c, bytes);
+    while (bytes-- > 0) {
+        p[bytes] = (char)(u & 0xff);
+        u >>= 8;
+    }
+}
+
+static uint64_t lept_double_bits(double n) {
+    uint64_t u;
+    memcpy(&u, &n, sizeof(u));
+    return u;
+}
+
+/* -0.0 is kept as a float */
+static int lept_number_is_integer(double n) {
+    if (n >= 0.0 && n < 18446744073709551616.0)
+        return (double)(uint64_t)n == n && (n != 0.0 || !(lept_double_bits(n) >> 63));
+    return n < 0.0 && n >= -9223372036854775808.0 && (double)(int64_t)n == n;
+}
+
+/* The 2, 4 or 8 byte integer of first + 1, 2 or 3 */
+static void lept_put_sized_uint(lept_context *c, int first, uint64_t u) {
+    if (u <= 0xffff) {
+        PUT(c, (char)first);
+        lept_put_uint(c, u, 2);
+    }
+    else if (u <= 0xffffffffUL) {
+        PUT(c, (char)(first + 1));
+        lept_put_uint(c, u, 4);
+    }
+    else {
+        PUT(c, (char)(first + 2));
+        lept_put_uint(c, u, 8);
+    }
+}
+
+static void lept_msgpack_number(lept_context *c, double n) {
+    if (!lept_number_is_integer(n)) {
+        PUT(c, (char)0xcb);
+        lept_put_uint(c, lept_double_bits(n), 8);
+    }
+    else if (n >= 0) {
+        uint64_t u = (uint64_t)n;
+        if (u <= 0x7f)
+            PUT(c, (char)u);
+        else if (u <= 0xff) {
+            PUT(c, (char)0xcc);
+            lept_put_uint(c, u, 1);
+        }
+        else
+            lept_put_sized_uint(c, 0xcd, u);
+    }
+    else {
+        int64_t i = (int64_t)n;
+        if (i >= -32)
+            PUT(c, (char)i);
+        else if (i >= -128) {
+            PUT(c, (char)0xd0);
+            lept_put_uint(c, (uint64_t)i, 1);
+        }
+        else if (i >= -32768) {
+            PUT(c, (char)0xd1);
+            lept_put_uint(c, (uint64_t)i, 2);
+        }
+        else if (i >= -2147483647L - 1) {
+            PUT(c, (char)0xd2);
+            lept_put_uint(c, (uint64_t)i, 4);
+        }
+        else {
+            PUT(c, (char)0xd3);
+            lept_put_uint(c, (uint64_t)i, 8);
+        }
+    }
+}
+
+/*
+ * The header of a string, array or map: its fix form if n < limit, else its 8-bit form if any, or first.
+ * MessagePack has no 64-bit lengths, returns 0 if n does not fit in 32 bits.
+ */
+static int lept_msgpack_length(lept_context *c, int fix, size_t limit, int first8, int first, size_t n) {
+    if (n < limit)
+        PUT(c, (char)(fix | n));
+    else if (first8 != 0 && n <= 0xff) {
+        PUT(c, (char)first8);
+        lept_put_uint(c, n, 1);
+    }
+    else if ((uint64_t)n <= 0xffffffffUL)
+        lept_put_sized_uint(c, first, n);
+    else
+        return 0;
+    return 1;
+}
+
+#define LEPT_ENCODE_CHILDREN 2
+
+/* Writes v, or the head of a container: 0 if it cannot be encoded, LEPT_ENCODE_CHILDREN if children follow */
+typedef int (*lept_encode_node_func)(lept_context *c, const lept_value *v);
+/* Writes the head of a key of len bytes, returns 0 if it cannot be encoded */
+typedef int (*lept_encode_key_func)(lept_context *c, size_t len);
+
+static int lept_msgpack_key(lept_context *c, size_t len) {
+    return lept_msgpack_length(c, 0xa0, 32, 0xd9, 0xda, len);
+}
+
+static int lept_encode_msgpack_node(lept_context *c, const lept_value *v) {
+    LEPT_EXPAND(v);
+    switch (v->type) {
+        case LEPT_NULL:   PUT(c, (char)0xc0); return 1;
+        case LEPT_FALSE:  PUT(c, (char)0xc2); return 1;
+        case LEPT_TRUE:   PUT(c, (char)0xc3); return 1;
+        case LEPT_NUMBER: lept_msgpack_number(c, v->u.n); return 1;
+        case LEPT_STRING:
+            if (!lept_msgpack_key(c, LEPT_STRING_LEN(v)))
+                return 0;
+            if (LEPT_STRING_LEN(v) > 0)
+                PUTS(c, LEPT_STRING(v), LEPT_STRING_LEN(v));
+            return 1;
+        case LEPT_ARRAY:
+            if (!lept_msgpack_length(c, 0x90, 16, 0, 0xdc, LEPT_ARRAY_SIZE(v)))
+                return 0;
+            return LEPT_ARRAY_SIZE(v) > 0 ? LEPT_ENCODE_CHILDREN : 1;
+        case LEPT_OBJECT:
+            if (!lept_msgpack_length(c, 0x80, 16, 0, 0xde, LEPT_OBJECT_SIZE(v)))
+                return 0;
+            return LEPT_OBJECT_SIZE(v) > 0 ? LEPT_ENCODE_CHILDREN : 1;
+        default:
+            assert(0 && "invalid type");
+            return 0;
+    }
+}
+
+/* The initial byte of a data item and the argument following it */
+static void lept_cbor_head(lept_context *c, int major, uint64_t u) {
+    major <<= 5;
+    if (u < 24)
+        PUT(c, (char)(major | u));
+    else if (u <= 0xff) {
+        PUT(c, (char)(major | 24));
+        lept_put_uint(c, u, 1);
+    }
+    else
+        lept_put_sized_uint(c, major | 25, u);
+}
+
+static int lept_cbor_key(lept_context *c, size_t len) {
+    lept_cbor_head(c, 3, len);
+    return 1;
+}
+
+static int lept_encode_cbor_node(lept_context *c, const lept_value *v) {
+    LEPT_EXPAND(v);
+    switch (v->type) {
+        case LEPT_NULL:   PUT(c, (char)0xf6); return 1;
+        case LEPT_FALSE:  PUT(c, (char)0xf4); return 1;
+        case LEPT_TRUE:   PUT(c, (char)0xf5); return 1;
+        case LEPT_NUMBER:
+            if (!lept_number_is_integer(v->u.n)) {
+                PUT(c, (char)0xfb);
+                lept_put_uint(c, lept_double_bits(v->u.n), 8);
+            }
+            else if (v->u.n >= 0)
+                lept_cbor_head(c, 0, (uint64_t)v->u.n);
+            else
+                lept_cbor_head(c, 1, (uint64_t)-v->u.n - 1);
+            return 1;
+        case LEPT_STRING:
+            lept_cbor_head(c, 3, LEPT_STRING_LEN(v));
+            if (LEPT_STRING_LEN(v) > 0)
+                PUTS(c, LEPT_STRING(v), LEPT_STRING_LEN(v));
+            return 1;
+        case LEPT_ARRAY:
+            lept_cbor_head(c, 4, LEPT_ARRAY_SIZE(v));
+            return LEPT_ARRAY_SIZE(v) > 0 ? LEPT_ENCODE_CHILDREN : 1;
+        case LEPT_OBJECT:
+            lept_cbor_head(c, 5, LEPT_OBJECT_SIZE(v));
+            return LEPT_OBJECT_SIZE(v) > 0 ? LEPT_ENCODE_CHILDREN : 1;
+        default:
+            assert(0 && "invalid type");
+            return 0;
+    }
+}
+
+/* Walks the tree in the order of the encoding, returns NULL if a node cannot be encoded */
+static char* lept_encode(const lept_value *v, size_t *length, lept_encode_node_func node, lept_encode_key_func key) {
+    lept_context c, s;
+    size_t i = 0;
+    int ret;
+    assert(v != NULL && length != NULL);
+    c.stack = (char *)malloc(c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    c.top = 0;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    if ((ret = node(&c, v)) == LEPT_ENCODE_CHILDREN) {
+        for (;;) {
+            if (i < (v->type == LEPT_ARRAY ? LEPT_ARRAY_SIZE(v) : LEPT_OBJECT_SIZE(v))) {
+                const lept_value *child;
+                if (v->type == LEPT_ARRAY)
+                    child = &v->u.a.e[i];
+                else {
+                    const lept_member *m = &v->u.o.m[i];
+                    if ((ret = key(&c, m->klen)) == 0)
+                        break;
+                    if (m->klen > 0)
+                        PUTS(&c, LEPT_KEY(m), m->klen);
+                    child = &m->v;
+                }
+                i++;
+                if ((ret = node(&c, child)) == 0)
+                    break;
+                if (ret == LEPT_ENCODE_CHILDREN) {
+                    lept_visit_push(&s, (lept_value *)v, NULL, i);
+                    v = child;
+                    i = 0;
+                }
+            }
+            else if (s.top > 0) {
+                lept_visit *f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+                v = f->v;
+                i = f->i;
+            }
+            else
+                break;
+        }
+    }
+    free(s.stack);
+    if (ret == 0) {
+        free(c.stack);
+        *length = 0;
+        return NULL;
+    }
+    *length = c.top;
+    return c.stack;
+}
+
+char* lept_encode_msgpack(const lept_value *v, size_t *length) {
+    return lept_encode(v, length, lept_encode_msgpack_node, lept_msgpack_key);
+}
+
+char* lept_encode_cbor(const lept_value *v, size_t *length) {
+    return lept_encode(v, length, lept_encode_cbor_node, lept_cbor_key);
+}
+
+/* Reads a big-endian unsigned integer, returns 0 if the input ends first */
+static int lept_get_uint(lept_context *c, int bytes, uint64_t *u) {
+    if (c->end - c->json < bytes)
+        return 0;
+    for (*u = 0; bytes > 0; bytes--)
+        *u = (*u << 8) | (unsigned char)*c->json++;
+    return 1;
+}
+
+/* Sets a decoded number, which must be finite as in JSON */
+static int lept_decode_number(lept_value *v, double n) {
+    if (n != n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n == HUGE_VAL || n == -HUGE_VAL)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    v->type = LEPT_NUMBER;
+    v->u.n = n;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_decode_float(lept_context *c, lept_value *v, int bytes) {
+    uint64_t u;
+    if (!lept_get_uint(c, bytes, &u))
+        return LEPT_PARSE_INVALID_VALUE;
+    if (bytes == 4) {
+        float f;
+        uint32_t u32 = (uint32_t)u;
+        memcpy(&f, &u32, sizeof(f));
+        return lept_decode_number(v, f);
+    }
+    else {
+        double d;
+        memcpy(&d, &u, sizeof(d));
+        return lept_decode_number(v, d);
+    }
+}
+
+/* Takes a string of n bytes, it cannot be longer than the rest of the input */
+static int lept_decode_string(lept_context *c, lept_value *v, uint64_t n) {
+    if ((uint64_t)(c->end - c->json) < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    lept_set_string(v, c->json, (size_t)n);
+    c->json += n;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_decode_msgpack_value(lept_context *c, lept_value *v);
+
+/*
+ * The decoders recurse into arrays, maps and CBOR tags, c->depth bounds the recursion like the nesting
+ * of a JSON text. Every element or member takes at least a byte, which bounds n before anything is allocated.
+ */
+static int lept_decode_msgpack_array(lept_context *c, lept_value *v, uint64_t n) {
+    int ret = LEPT_PARSE_OK;
+    if ((uint64_t)(c->end - c->json) < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->depth++;
+    lept_set_array(v, (size_t)n);
+    while (n-- > 0 && ret == LEPT_PARSE_OK)
+        ret = lept_decode_msgpack_value(c, lept_pushback_array_element(v));
+    c->depth--;
+    return ret;
+}
+
+static int lept_decode_msgpack_map(lept_context *c, lept_value *v, uint64_t n) {
+    lept_value k;
+    int ret = LEPT_PARSE_OK;
+    if ((uint64_t)(c->end - c->json) / 2 < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->depth++;
+    lept_set_object(v, (size_t)n);
+    lept_init(&k);
+    while (n-- > 0 && ret == LEPT_PARSE_OK) {
+        if ((ret = lept_decode_msgpack_value(c, &k)) != LEPT_PARSE_OK)
+            break;
+        if (k.type != LEPT_STRING)
+            ret = LEPT_PARSE_MISS_KEY;
+        else
+            ret = lept_decode_msgpack_value(c, lept_set_object_value(v, LEPT_STRING(&k), LEPT_STRING_LEN(&k)));
+        lept_free(&k);
+    }
+    lept_free(&k);
+    c->depth--;
+    return ret;
+}
+
+static int lept_decode_msgpack_value(lept_context *c, lept_value *v) {
+    static const int bytes[] = { 1, 2, 4, 8 };
+    unsigned char b;
+    uint64_t u;
+    if (c->json == c->end)
+        return LEPT_PARSE_INVALID_VALUE;
+    b = (unsigned char)*c->json++;
+    if (b <= 0x7f)
+        return lept_decode_number(v, b);
+    if (b >= 0xe0)
+        return lept_decode_number(v, (double)b - 256);
+    if (b <= 0x8f)
+        return lept_decode_msgpack_map(c, v, b & 0x0f);
+    if (b <= 0x9f)
+        return lept_decode_msgpack_array(c, v, b & 0x0f);
+    if (b <= 0xbf)
+        return lept_decode_string(c, v, b & 0x1f);
+    switch (b) {
+        case 0xc0: lept_set_null(v); return LEPT_PARSE_OK;
+        case 0xc2: lept_set_boolean(v, 0); return LEPT_PARSE_OK;
+        case 0xc3: lept_set_boolean(v, 1); return LEPT_PARSE_OK;
+        case 0xca: return lept_decode_float(c, v, 4);
+        case 0xcb: return lept_decode_float(c, v, 8);
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            if (!lept_get_uint(c, bytes[b - 0xcc], &u))
+                return LEPT_PARSE_INVALID_VALUE;
+            return lept_decode_number(v, (double)u);
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+            uint64_t sign = (uint64_t)1 << (bytes[b - 0xd0] * 8 - 1);
+            if (!lept_get_uint(c, bytes[b - 0xd0], &u))
+                return LEPT_PARSE_INVALID_VALUE;
+            /* two's complement of the width, the mask wraps around to all ones for 64 bits */
+            return lept_decode_number(v, u & sign ? -(double)((~u & (sign * 2 - 1)) + 1) : (double)u);
+        }
+        case 0xd9: case 0xda: case 0xdb:
+            if (!lept_get_uint(c, bytes[b - 0xd9], &u))
+                return LEPT_PARSE_INVALID_VALUE;
+            return lept_decode_string(c, v, u);
+        case 0xdc: case 0xdd:
+            if (!lept_get_uint(c, bytes[b - 0xdb], &u))
+                return LEPT_PARSE_INVALID_VALUE;
+            return lept_decode_msgpack_array(c, v, u);
+        case 0xde: case 0xdf:
+            if (!lept_get_uint(c, bytes[b - 0xdd], &u))
+                return LEPT_PARSE_INVALID_VALUE;
+            return lept_decode_msgpack_map(c, v, u);
+        default:
+            return LEPT_PARSE_INVALID_VALUE;    /* binary, extension types and the unused 0xc1 */
+    }
+}
+
+#define LEPT_CBOR_INDEFINITE    2
+#define LEPT_CBOR_BREAK         ((char)0xff)
+
+/* Reads the argument of a head with additional information info, returns LEPT_CBOR_INDEFINITE for 31 or 0 */
+static int lept_cbor_argument(lept_context *c, int info, uint64_t *u) {
+    *u = 0;
+    if (info < 24)
+        *u = info;
+    else if (info <= 27)
+        return lept_get_uint(c, 1 << (info - 24), u);
+    else
+        return info == 31 ? LEPT_CBOR_INDEFINITE : 0;
+    return 1;
+}
+
+/* A half-precision float, infinities and NaNs are rejected before */
+static double lept_cbor_half(unsigned h) {
+    int e = (h >> 10) & 0x1f;
+    unsigned m = h & 0x3ff;
+    double d = e == 0 ? m / 16777216.0 : (double)(m + 1024) * (1UL << e) / 33554432.0;
+    return h & 0x8000 ? -d : d;
+}
+
+static int lept_decode_cbor_value(lept_context *c, lept_value *v);
+
+/* The chunks of an indefinite-length text string are definite text strings, gathered on the stack */
+static int lept_decode_cbor_chunks(lept_context *c, lept_value *v) {
+    size_t head = c->top;
+    uint64_t n;
+    int ret = LEPT_PARSE_OK;
+    for (;;) {
+        if (c->json == c->end)
+            ret = LEPT_PARSE_INVALID_VALUE;
+        else if (*c->json == LEPT_CBOR_BREAK) {
+            c->json++;
+            if (c->top - head > LEPT_SIZE_MAX)
+                ret = LEPT_PARSE_SIZE_TOO_BIG;
+            else
+                lept_set_string(v, c->stack + head, c->top - head);
+        }
+        else if ((*c->json & 0xe0) != 0x60 || lept_cbor_argument(c, *c->json++ & 0x1f, &n) != 1 ||
+                 (uint64_t)(c->end - c->json) < n)
+            ret = LEPT_PARSE_INVALID_VALUE;
+        else {
+            if (n > 0)
+                PUTS(c, c->json, (size_t)n);
+            c->json += n;
+            continue;
+        }
+        break;
+    }
+    c->top = head;
+    return ret;
+}
+
+static int lept_decode_cbor_array(lept_context *c, lept_value *v, uint64_t n, int indefinite) {
+    int ret = LEPT_PARSE_OK;
+    if (!indefinite && (uint64_t)(c->end - c->json) < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->depth++;
+    if (indefinite) {
+        lept_set_array(v, 0);
+        while (ret == LEPT_PARSE_OK && c->json != c->end && *c->json != LEPT_CBOR_BREAK)
+            ret = LEPT_ARRAY_SIZE(v) == LEPT_SIZE_MAX ?
+                LEPT_PARSE_SIZE_TOO_BIG : lept_decode_cbor_value(c, lept_pushback_array_element(v));
+        if (ret == LEPT_PARSE_OK && c->json == c->end)
+            ret = LEPT_PARSE_INVALID_VALUE;
+        else if (ret == LEPT_PARSE_OK)
+            c->json++;
+    }
+    else {
+        lept_set_array(v, (size_t)n);
+        while (n-- > 0 && ret == LEPT_PARSE_OK)
+            ret = lept_decode_cbor_value(c, lept_pushback_array_element(v));
+    }
+    c->depth--;
+    return ret;
+}
+
+static int lept_decode_cbor_map(lept_context *c, lept_value *v, uint64_t n, int indefinite) {
+    lept_value k;
+    int ret = LEPT_PARSE_OK;
+    if ((uint64_t)(c->end - c->json) / 2 < n)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (n > LEPT_SIZE_MAX)
+        return LEPT_PARSE_SIZE_TOO_BIG;
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->depth++;
+    lept_set_object(v, (size_t)n);
+    lept_init(&k);
+    while (indefinite || n-- > 0) {
+        if (indefinite && c->json != c->end && *c->json == LEPT_CBOR_BREAK) {
+            c->json++;
+            break;
+        }
+        if (LEPT_OBJECT_SIZE(v) == LEPT_SIZE_MAX) {
+            ret = LEPT_PARSE_SIZE_TOO_BIG;
+            break;
+        }
+        if ((ret = lept_decode_cbor_value(c, &k)) != LEPT_PARSE_OK)
+            break;
+        if (k.type != LEPT_STRING) {
+            ret = LEPT_PARSE_MISS_KEY;
+            break;
+        }
+        ret = lept_decode_cbor_value(c, lept_set_object_value(v, LEPT_STRING(&k), LEPT_STRING_LEN(&k)));
+        lept_free(&k);
+        if (ret != LEPT_PARSE_OK)
+            break;
+    }
+    lept_free(&k);
+    c->depth--;
+    return ret;
+}
+
+static int lept_decode_cbor_value(lept_context *c, lept_value *v) {
+    int major, info, arg;
+    uint64_t u;
+    if (c->json == c->end)
+        return LEPT_PARSE_INVALID_VALUE;
+    major = (unsigned char)*c->json >> 5;
+    info = *c->json++ & 0x1f;
+    if (major == 7) {
+        switch (info) {
+            case 20: lept_set_boolean(v, 0); return LEPT_PARSE_OK;
+            case 21: lept_set_boolean(v, 1); return LEPT_PARSE_OK;
+            case 22:
+            case 23: lept_set_null(v); return LEPT_PARSE_OK;   /* undefined has no JSON counterpart */
+            case 25:
+                if (!lept_get_uint(c, 2, &u) || (u & 0x7fff) > 0x7c00)
+                    return LEPT_PARSE_INVALID_VALUE;
+                if ((u & 0x7c00) == 0x7c00)
+                    return LEPT_PARSE_NUMBER_TOO_BIG;
+                return lept_decode_number(v, lept_cbor_half((unsigned)u));
+            case 26: return lept_decode_float(c, v, 4);
+            case 27: return lept_decode_float(c, v, 8);
+            default: return LEPT_PARSE_INVALID_VALUE;   /* other simple values and a stray break */
+        }
+    }
+    if ((arg = lept_cbor_argument(c, info, &u)) == 0)
+        return LEPT_PARSE_INVALID_VALUE;
+    switch (major) {
+        case 0:
+            return arg == LEPT_CBOR_INDEFINITE ? LEPT_PARSE_INVALID_VALUE : lept_decode_number(v, (double)u);
+        case 1:
+            return arg == LEPT_CBOR_INDEFINITE ? LEPT_PARSE_INVALID_VALUE : lept_decode_number(v, -(double)u - 1.0);
+        case 3:
+            return arg == LEPT_CBOR_INDEFINITE ? lept_decode_cbor_chunks(c, v) : lept_decode_string(c, v, u);
+        case 4:
+            return lept_decode_cbor_array(c, v, u, arg == LEPT_CBOR_INDEFINITE);
+        case 5:
+            return lept_decode_cbor_map(c, v, u, arg == LEPT_CBOR_INDEFINITE);
+        case 6: {   /* the tagged item stands for itself */
+            int ret;
+            if (arg == LEPT_CBOR_INDEFINITE)
+                return LEPT_PARSE_INVALID_VALUE;
+            if (c->depth >= c->max_depth)
+                return LEPT_PARSE_DEPTH_EXCEEDED;
+            c->depth++;
+            ret = lept_decode_cbor_value(c, v);
+            c->depth--;
+            return ret;
+        }
+        default:    /* byte strings */
+            return LEPT_PARSE_INVALID_VALUE;
+    }
+}
+
+static int lept_decode(lept_value *v, const char *buf, size_t len, int (*decode)(lept_context *, lept_value *)) {
+    lept_context c;
+    int ret;
+    assert(v != NULL && (buf != NULL || len == 0));
+    lept_context_init(&c, buf, len);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    lept_init(v);
+    if (len == 0)
+        ret = LEPT_PARSE_EXPECT_VALUE;
+    else if ((ret = decode(&c, v)) == LEPT_PARSE_OK && c.json != c.end)
+        ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    if (ret != LEPT_PARSE_OK)
+        lept_free(v);
+    free(c.stack);
+    return ret;
+}
+
+int lept_decode_msgpack(lept_value *v, const char *buf, size_t len) {
+    return lept_decode(v, buf, len, lept_decode_msgpack_value);
+}
+
+int lept_decode_cbor(lept_value *v, const char *buf, size_t len) {
+    return lept_decode(v, buf, len, lept_decode_cbor_value);
+}
+
+/* Copies src into dst, a null, without its children, returns whether src has children to copy */
+static int lept_copy_node(lept_value *dst, const lept_value *src) {
+    switch(src->flags & LEPT_VALUE_LAZY ? LEPT_NULL : src->type) {   /* a lazy value shares the text */
+        case LEPT_STRING:
+            lept_set_string(dst, LEPT_STRING(src), LEPT_STRING_LEN(src));
+            return 0;
+        case LEPT_ARRAY:
+            lept_set_array(dst, LEPT_ARRAY_CAPACITY(src));
+            return LEPT_ARRAY_SIZE(src) > 0;
+        case LEPT_OBJECT:
+            lept_set_object(dst, LEPT_OBJECT_CAPACITY(src));
+            return LEPT_OBJECT_SIZE(src) > 0;
+        default:
+            memcpy(dst, src, sizeof(lept_value));
+            return 0;
+    }
+}
+
+/* dst has the capacity of src, so the children of a container being copied never move */
+void lept_copy(lept_value *dst, const lept_value *src) {
+    lept_context s;
+    size_t i = 0;
+    assert(dst != NULL && src != NULL && src != dst);
+    lept_free(dst);
+    if (!lept_copy_node(dst, src))
+        return;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    for (;;) {
+        if (i < (src->type == LEPT_ARRAY ? LEPT_ARRAY_SIZE(src) : LEPT_OBJECT_SIZE(src))) {
+            const lept_value *child;
+            lept_value *copy;
+            if (src->type == LEPT_ARRAY) {
+                child = &src->u.a.e[i];
+                copy = &dst->u.a.e[i];
+                lept_init(copy);
+                LEPT_ARRAY_SIZE(dst) = i + 1;
+            }
+            else {
+                child = &src->u.o.m[i].v;
+                copy = lept_set_object_value(dst, LEPT_KEY(&src->u.o.m[i]), src->u.o.m[i].klen);
+            }
+            i++;
+            if (lept_copy_node(copy, child)) {
+                lept_visit_push(&s, dst, src, i);
+                dst = copy;
+                src = child;
+                i = 0;
+            }
+        }
+        else if (s.top > 0) {
+            lept_visit *f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+            dst = f->v;
+            src = f->other;
+            i = f->i;
+        }
+        else
+            break;
+    }
+    free(s.stack);
+}
+
+void lept_move(lept_value *dst, lept_value *src) {
+    assert(dst != NULL && src != NULL && src != dst);
+    lept_free(dst);
+    memcpy(dst, src, sizeof(lept_value));
+    lept_init(src);
+}
+
+void lept_swap(lept_value *lhs, lept_value *rhs) {
+    assert(lhs != NULL && rhs != NULL);
+    if (lhs != rhs) {
+        lept_value temp;
+        memcpy(&temp, lhs, sizeof(lept_value));
+        memcpy(lhs,   rhs, sizeof(lept_value));
+        memcpy(rhs, &temp, sizeof(lept_value));
+    }
+}
+
+/*
+ * Frees the strings and keys of the children of v from *i on, in one pass over its storage. Stops after
+ * the first array or object, which is returned to be freed before the rest.
+ */
+static lept_value* lept_free_children(lept_value *v, size_t *i) {
+    lept_value *child;
+    if (v->type == LEPT_ARRAY) {
+        while (*i < LEPT_ARRAY_SIZE(v)) {
+            child = &v->u.a.e[(*i)++];
+            if (child->flags & LEPT_VALUE_LAZY)
+                continue;
+            if (child->type == LEPT_STRING) {
+                if (!(child->flags & (LEPT_VALUE_BORROWED | LEPT_VALUE_INLINE)))
+                    free(child->u.s.s);
+            }
+            else if (child->type == LEPT_ARRAY || child->type == LEPT_OBJECT)
+                return child;
+        }
+    }
+    else {
+        while (*i < LEPT_OBJECT_SIZE(v)) {
+            lept_member *m = &v->u.o.m[(*i)++];
+            if (!(v->flags & LEPT_VALUE_KEYS_BORROWED))
+                lept_member_free_key(m);
+            child = &m->v;
+            if (child->flags & LEPT_VALUE_LAZY)
+                continue;
+            if (child->type == LEPT_STRING) {
+                if (!(child->flags & (LEPT_VALUE_BORROWED | LEPT_VALUE_INLINE)))
+                    free(child->u.s.s);
+            }
+            else if (child->type == LEPT_ARRAY || child->type == LEPT_OBJECT)
+                return child;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Borrowed storage (e.g. from an arena) is skipped, children are still visited as they may own memory.
+ * A container is released after its children, the ones on the path to the root wait on the stack.
+ */
+void lept_free(lept_value *v) {
+    lept_context s;
+    lept_visit *f;
+    lept_value *child;
+    size_t i = 0;
+    assert(v != NULL);
+    if (v->flags & LEPT_VALUE_LAZY)
+        ;   /* nothing is allocated until it is expanded */
+    else if (v->type == LEPT_STRING) {
+        if (!(v->flags & (LEPT_VALUE_BORROWED | LEPT_VALUE_INLINE)))
+            free(v->u.s.s);
+        v->u.s.s = NULL;
+    }
+    else if (v->type == LEPT_ARRAY || v->type == LEPT_OBJECT) {
+        s.stack = NULL;
+        s.size = s.top = 0;
+        for (;;) {
+            if ((child = lept_free_children(v, &i)) != NULL) {
+                lept_visit_push(&s, v, NULL, i);
+                v = child;
+                i = 0;
+                continue;
+            }
+            if (!(v->flags & LEPT_VALUE_BORROWED))
+                free(lept_storage_block(v->type == LEPT_ARRAY ? (void *)v->u.a.e : (void *)v->u.o.m));
+            if (v->type == LEPT_ARRAY)
+                v->u.a.e = NULL;
+            else
+                v->u.o.m = NULL;
+            v->type = LEPT_NULL;
+            v->flags = 0;
+            if (s.top == 0)
+                break;
+            f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+            v = f->v;
+            i = f->i;
+        }
+        free(s.stack);
+    }
+    v->type = LEPT_NULL;
+    v->flags = 0;
+    return;
+}
+
+lept_type lept_get_type(const lept_value* v) {
+    assert(v != NULL);              /* caller should ensure the v is valid */
+    return v->type;
+}
+
+#define LEPT_EQUAL_CHILDREN 2
+
+/* Compares lhs and rhs without their children: 0 if they differ, LEPT_EQUAL_CHILDREN if those remain */
+static int lept_equal_node(const lept_value *lhs, const lept_value *rhs) {
+    if (lhs->type != rhs->type)
+        return 0;
+    LEPT_EXPAND(lhs);
+    LEPT_EXPAND(rhs);
+    switch (lhs->type) {
+        case LEPT_STRING:
+            return LEPT_STRING_LEN(lhs) == LEPT_STRING_LEN(rhs) &&
+                   memcmp(LEPT_STRING(lhs), LEPT_STRING(rhs), LEPT_STRING_LEN(lhs)) == 0;
+        case LEPT_NUMBER:
+            return lhs->u.n == rhs->u.n;
+        case LEPT_ARRAY:
+            if (LEPT_ARRAY_SIZE(lhs) != LEPT_ARRAY_SIZE(rhs))
+                return 0;
+            return LEPT_ARRAY_SIZE(lhs) > 0 ? LEPT_EQUAL_CHILDREN : 1;
+        case LEPT_OBJECT:
+            if (LEPT_OBJECT_SIZE(lhs) != LEPT_OBJECT_SIZE(rhs))
+                return 0;
+            return LEPT_OBJECT_SIZE(lhs) > 0 ? LEPT_EQUAL_CHILDREN : 1;
+        default:
+            return 1;
+    }
+}
+
+int lept_is_equal(const lept_value *lhs, const lept_value *rhs) {
+    lept_context s;
+    size_t i = 0;
+    int equal;
+    assert(lhs != NULL && rhs != NULL);
+    if ((equal = lept_equal_node(lhs, rhs)) != LEPT_EQUAL_CHILDREN)
+        return equal;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    for (;;) {
+        if (i < (lhs->type == LEPT_ARRAY ? LEPT_ARRAY_SIZE(lhs) : LEPT_OBJECT_SIZE(lhs))) {
+            const lept_value *l, *r;
+            if (lhs->type == LEPT_ARRAY) {
+                l = &lhs->u.a.e[i];
+                r = &rhs->u.a.e[i];
+            }
+            else {
+                const lept_member *m = &lhs->u.o.m[i], *n = &rhs->u.o.m[i];
+                l = &m->v;
+                /* members are usually in the same order, e.g. in a copy */
+                if (m->klen == n->klen && memcmp(LEPT_KEY(m), LEPT_KEY(n), m->klen) == 0)
+                    r = &n->v;
+                else if ((r = lept_find_object_value((lept_value *)rhs, LEPT_KEY(m), m->klen)) == NULL) {
+                    equal = 0;
+                    break;
+                }
+            }
+            i++;
+            if ((equal = lept_equal_node(l, r)) == 0)
+                break;
+            if (equal == LEPT_EQUAL_CHILDREN) {
+                lept_visit_push(&s, (lept_value *)lhs, rhs, i);
+                lhs = l;
+                rhs = r;
+                i = 0;
+            }
+        }
+        else if (s.top > 0) {
+            lept_visit *f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+            lhs = f->v;
+            rhs = f->other;
+            i = f->i;
+        }
+        else {
+            equal = 1;
+            break;
+        }
+    }
+    free(s.stack);
+    return equal;
+}
+
+int lept_get_boolean(const lept_value *v) {
+    assert(v != NULL && (v->type == LEPT_TRUE || v->type == LEPT_FALSE));
+    return v->type == LEPT_TRUE ? 1 : 0;
+}
+
+void lept_set_boolean(lept_value *v, int b) {
+    assert(v != NULL);
+    lept_free(v);
+    v->type = (b != 0 ? LEPT_TRUE : LEPT_FALSE);
+    return;
+}
+
+double lept_get_number(const lept_value* v) {
+    assert(v != NULL && v->type == LEPT_NUMBER);    /* caller should ensure the type of v is correct */
+    return v->u.n;
+}
+
+void lept_set_number(lept_value *v, double n) {
+    assert(v != NULL);
+    lept_free(v);
+    v->u.n = n;
+    v->type = LEPT_NUMBER;
+    return;
+}
+
+const char *lept_get_string(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_STRING);
+    return LEPT_STRING(v);
+}
+
+size_t lept_get_string_length(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_STRING);
+    return LEPT_STRING_LEN(v);
+}
+
+void lept_set_string(lept_value *v, const char *s, size_t len) {
+    assert(v != NULL && (s != NULL || len == 0) && len <= LEPT_SIZE_MAX);
+    lept_free(v);
+    if (len <= LEPT_STRING_INLINE_MAX) {
+        lept_set_inline_string(v, s, len);
+        return;
+    }
+    v->u.s.s = (char *)malloc(len + 1);
+    memcpy(v->u.s.s, s, len);
+    v->u.s.s[len] = '\0';
+    LEPT_SPAN_LEN(v) = len;
+    v->type = LEPT_STRING;
+}
+
+void lept_set_array(lept_value *v, size_t capacity) {
+    assert(v != NULL);
+    lept_free(v);
+    v->type = LEPT_ARRAY;
+    LEPT_ARRAY_SIZE(v) = 0;
+    lept_set_array_storage(v, capacity > 0 ? malloc(LEPT_ARRAY_STORAGE_SIZE(capacity)) : NULL, capacity);
+}
+
+size_t lept_get_array_size(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    return LEPT_ARRAY_SIZE(v);
+}
+
+size_t lept_get_array_capacity(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    return LEPT_ARRAY_CAPACITY(v);
+}
+
+/* Reallocates the storage block of an array or object, borrowed storage is moved to the heap */
+static void* lept_realloc_storage(lept_value *v, void *p, size_t used, size_t size) {
+    void *ret;
+    p = lept_storage_block(p);
+    if (!(v->flags & LEPT_VALUE_BORROWED))
+        return realloc(p, size);
+    v->flags &= ~LEPT_VALUE_BORROWED;
+    if (size == 0)
+        return NULL;
+    ret = malloc(size);
+    if (used > 0)
+        memcpy(ret, p, LEPT_STORAGE_HEADER_SIZE + used);
+    return ret;
+}
+
+void lept_reserve_array(lept_value *v, size_t capacity) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    if (LEPT_ARRAY_CAPACITY(v) < capacity)
+        lept_set_array_storage(v, lept_realloc_storage(v, v->u.a.e,
+            LEPT_ARRAY_SIZE(v) * sizeof(lept_value), LEPT_ARRAY_STORAGE_SIZE(capacity)), capacity);
+}
+
+void lept_shrink_array(lept_value *v) {
+    size_t size;
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    size = LEPT_ARRAY_SIZE(v);
+    if (LEPT_ARRAY_CAPACITY(v) > size)
+        lept_set_array_storage(v, lept_realloc_storage(v, v->u.a.e,
+            size * sizeof(lept_value), LEPT_ARRAY_STORAGE_SIZE(size)), size);
+}
+
+void lept_clear_array(lept_value *v) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    lept_erase_array_element(v, 0, LEPT_ARRAY_SIZE(v));
+}
+
+lept_value* lept_get_array_element(const lept_value *v, size_t index) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    assert(index < LEPT_ARRAY_SIZE(v));
+    return (v->u.a.e + index);
+}
+
+lept_value* lept_pushback_array_element(lept_value *v) {
+    assert(v != NULL && v->type == LEPT_ARRAY);
+    LEPT_EXPAND(v);
+    assert(LEPT_ARRAY_SIZE(v) < LEPT_SIZE_MAX);
+    if (LEPT_ARRAY_SIZE(v) == LEPT_ARRAY_CAPACITY(v))
+        lept_reserve_array(v, LEPT_ARRAY_CAPACITY(v) == 0 ? 1 : LEPT_ARRAY_CAPACITY(v) * 2);
+    lept_init(&v->u.a.e[LEPT_ARRAY_SIZE(v)]);
+    return &v->u.a.e[LEPT_ARRAY_SIZE(v)++];
+}
+
+void lept_popback_array_element(lept_value *v) {
+    assert(v != NULL);
+    LEPT_EXPAND(v);
+    assert(v != NULL && v->type == LEPT_ARRAY && LEPT_ARRAY_SIZE(v) > 0);
+    lept_free(&v->u.a.e[--LEPT_ARRAY_SIZE(v)]);
+}
+
+lept_value* lept_insert_array_element(lept_value *v, size_t index) {
+    size_t i;
+    assert(v != NULL);
+    LEPT_EXPAND(v);
+    assert(v != NULL && v->type == LEPT_ARRAY && index <= LEPT_ARRAY_SIZE(v));
+    assert(LEPT_ARRAY_SIZE(v) < LEPT_SIZE_MAX);
+    if (index == LEPT_ARRAY_SIZE(v))
+        return lept_pushback_array_element(v);
+    if (LEPT_ARRAY_SIZE(v) == LEPT_ARRAY_CAPACITY(v))
+        lept_reserve_array(v, LEPT_ARRAY_CAPACITY(v) == 0 ? 1 : LEPT_ARRAY_CAPACITY(v) * 2);
+    for (i = LEPT_ARRAY_SIZE(v); i > index; --i) {
+        memcpy(&v->u.a.e[i], &v->u.a.e[i-1], sizeof(lept_value));
+    }
+    LEPT_ARRAY_SIZE(v)++;
+    lept_init(&v->u.a.e[index]);
+    return &v->u.a.e[index];
+}
+
+void lept_erase_array_element(lept_value *v, size_t index, size_t count) {
+    size_t i;
+    assert(v != NULL);
+    LEPT_EXPAND(v);
+    assert(v != NULL && v->type == LEPT_ARRAY && index + count <= LEPT_ARRAY_SIZE(v));
+    for (i = index; i < index + count; ++i)
+        lept_free(&v->u.a.e[i]);
+    if (count != 0 && index + count < LEPT_ARRAY_SIZE(v)) {
+        for (i = index + count; i < LEPT_ARRAY_SIZE(v); ++i) {
+            lept_move(&v->u.a.e[i-count], &v->u.a.e[i]);
+        }
+    }
+    LEPT_ARRAY_SIZE(v) -= count;
+}
+
+void lept_set_object(lept_value *v, size_t capacity) {
+    assert(v != NULL);
+    lept_free(v);
+    v->type = LEPT_OBJECT;
+    LEPT_OBJECT_SIZE(v) = 0;
+    lept_set_object_storage(v, capacity > 0 ? malloc(lept_object_storage_size(capacity)) : NULL, capacity);
+    lept_object_index_rebuild(v);
+}
+
+size_t lept_get_object_size(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    return LEPT_OBJECT_SIZE(v);
+}
+
+size_t lept_get_object_capacity(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    return LEPT_OBJECT_CAPACITY(v);
+}
+
+void lept_reserve_object(lept_value *v, size_t capacity) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    if (LEPT_OBJECT_CAPACITY(v) < capacity) {
+        lept_set_object_storage(v, lept_realloc_storage(v, v->u.o.m,
+            LEPT_OBJECT_SIZE(v) * sizeof(lept_member), lept_object_storage_size(capacity)), capacity);
+        lept_object_index_rebuild(v);
+    }
+}
+
+void lept_shrink_object(lept_value *v) {
+    size_t size;
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    size = LEPT_OBJECT_SIZE(v);
+    if (LEPT_OBJECT_CAPACITY(v) > size) {
+        lept_set_object_storage(v, lept_realloc_storage(v, v->u.o.m,
+            size * sizeof(lept_member), lept_object_storage_size(size)), size);
+        lept_object_index_rebuild(v);
+    }
+}
+
+/* Copies borrowed keys to the heap, so that an owned key can be added to the object */
+static void lept_own_object_keys(lept_value *v) {
+    size_t i;
+    if (!(v->flags & LEPT_VALUE_KEYS_BORROWED))
+        return;
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i) {
+        if (!LEPT_KEY_INLINE(v->u.o.m[i].klen)) {
+            char *k = (char *)malloc(v->u.o.m[i].klen + 1);
+            memcpy(k, v->u.o.m[i].k.p, v->u.o.m[i].klen + 1);
+            v->u.o.m[i].k.p = k;
+        }
+    }
+    v->flags &= ~LEPT_VALUE_KEYS_BORROWED;
+}
+
+void lept_clear_object(lept_value *v) {
+    size_t i;
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i) {
+        if (!(v->flags & LEPT_VALUE_KEYS_BORROWED))
+            lept_member_free_key(&v->u.o.m[i]);
+        lept_free(&v->u.o.m[i].v);
+    }
+    LEPT_OBJECT_SIZE(v) = 0;
+    v->flags &= ~LEPT_VALUE_KEYS_BORROWED;
+    lept_object_index_rebuild(v);
+}
+
+const char* lept_get_object_key(const lept_value *v, size_t index) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    assert(index < LEPT_OBJECT_SIZE(v));
+    return LEPT_KEY(&v->u.o.m[index]);
+}
+
+size_t lept_get_object_key_length(const lept_value *v, size_t index) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    assert(index < LEPT_OBJECT_SIZE(v));
+    return v->u.o.m[index].klen;
+}
+
+lept_value* lept_get_object_value(const lept_value *v, size_t index) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    LEPT_EXPAND(v);
+    assert(index < LEPT_OBJECT_SIZE(v));
+    return &v->u.o.m[index].v;
+}
+
+size_t lept_find_object_index(const lept_value *v, const char *key, size_t klen) {
+    size_t i;
+    assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
+    LEPT_EXPAND(v);
+    if (LEPT_OBJECT_INDEXED(LEPT_OBJECT_CAPACITY(v)))
+        return lept_object_index_find(v, key, klen, lept_hash_key(key, klen));
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i)
+        if (v->u.o.m[i].klen == klen && (LEPT_KEY(&v->u.o.m[i]) == key || memcmp(LEPT_KEY(&v->u.o.m[i]), key, klen) == 0))
+            return i;
+    return LEPT_KEY_NOT_EXIST;
+}
+
+lept_value* lept_find_object_value(lept_value *v, const char *key, size_t klen) {
+    size_t index = lept_find_object_index(v, key, klen);
+    return index != LEPT_KEY_NOT_EXIST ? &v->u.o.m[index].v : NULL;
+}
+
+/* Appends a member, the caller sets its key */
+static lept_value* lept_object_append(lept_value *v, const char *key, size_t klen) {
+    size_t new_member_index;
+    assert(LEPT_OBJECT_SIZE(v) < LEPT_SIZE_MAX);
+    new_member_index = LEPT_OBJECT_SIZE(v)++;
+    if (LEPT_KEY_INLINE(klen))
+        lept_member_copy_key(&v->u.o.m[new_member_index], key, klen);
+    else
+        v->u.o.m[new_member_index].k.p = (char *)key;
+    v->u.o.m[new_member_index].klen = klen;
+    lept_init(&v->u.o.m[new_member_index].v);
+    if (LEPT_OBJECT_INDEXED(LEPT_OBJECT_CAPACITY(v)))
+        lept_object_index_insert(v, new_member_index);
+    return &v->u.o.m[new_member_index].v;
+}
+
+lept_value* lept_set_object_value(lept_value *v, const char *key, size_t klen) {
+    lept_value *member_v;
+    char *k;
+    assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
+    LEPT_EXPAND(v);
+    if ((member_v = lept_find_object_value(v, key, klen)) != NULL) {
+        lept_free(member_v);
+        return member_v;
+    }
+    if (LEPT_OBJECT_SIZE(v) == LEPT_OBJECT_CAPACITY(v))
+        lept_reserve_object(v, LEPT_OBJECT_CAPACITY(v) == 0 ? 1 : LEPT_OBJECT_CAPACITY(v) * 2);
+    lept_own_object_keys(v);
+    if (!LEPT_KEY_INLINE(klen)) {
+        memcpy(k = (char *)malloc(klen+1), key, klen);
+        k[klen] = '\0';
+        key = k;
+    }
+    return lept_object_append(v, key, klen);
+}
+
+/* Interns all keys of an object, so that an interned key can be added to it */
+static void lept_intern_object_keys(lept_value *v, lept_symtab *st) {
+    size_t i;
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i) {
+        if (!LEPT_KEY_INLINE(v->u.o.m[i].klen)) {
+            char *k = (char *)lept_symtab_intern(st, v->u.o.m[i].k.p, v->u.o.m[i].klen);
+            if (!(v->flags & LEPT_VALUE_KEYS_BORROWED))
+                free(v->u.o.m[i].k.p);
+            v->u.o.m[i].k.p = k;
+        }
+    }
+    v->flags |= LEPT_VALUE_KEYS_BORROWED;
+}
+
+lept_value* lept_set_object_value_interned(lept_value *v, const char *key, size_t klen, lept_symtab *st) {
+    lept_value *member_v;
+    assert(v != NULL && v->type == LEPT_OBJECT && key != NULL && st != NULL);
+    LEPT_EXPAND(v);
+    if ((member_v = lept_find_object_value(v, key, klen)) != NULL) {
+        lept_free(member_v);
+        return member_v;
+    }
+    if (LEPT_OBJECT_SIZE(v) == LEPT_OBJECT_CAPACITY(v))
+        lept_reserve_object(v, LEPT_OBJECT_CAPACITY(v) == 0 ? 1 : LEPT_OBJECT_CAPACITY(v) * 2);
+    lept_intern_object_keys(v, st);
+    return lept_object_append(v, LEPT_KEY_INLINE(klen) ? key : lept_symtab_intern(st, key, klen), klen);
+}
+
+void lept_remove_object_value(lept_value *v, size_t index) {
+    size_t last_member_index;
+    assert(v != NULL);
+    LEPT_EXPAND(v);
+    assert(v != NULL && v->type == LEPT_OBJECT && index < LEPT_OBJECT_SIZE(v));
+    if (LEPT_OBJECT_INDEXED(LEPT_OBJECT_CAPACITY(v))) {
+        /* the last member moves into the hole */
+        lept_object_index_erase(v, lept_object_index_slot(v, index));
+        if (index != LEPT_OBJECT_SIZE(v) - 1)
+            LEPT_OBJECT_INDEX(v)[lept_object_index_slot(v, LEPT_OBJECT_SIZE(v) - 1)] = index + 1;
+    }
+    if (!(v->flags & LEPT_VALUE_KEYS_BORROWED))
+        lept_member_free_key(&v->u.o.m[index]);
+    lept_free(&v->u.o.m[index].v);
+    last_member_index = --LEPT_OBJECT_SIZE(v);
+    if (index != last_member_index) {
+        v->u.o.m[index].k = v->u.o.m[last_member_index].k;
+        v->u.o.m[index].klen = v->u.o.m[last_member_index].klen;
+        lept_move(&v->u.o.m[index].v, &v->u.o.m[last_member_index].v);
+        v->u.o.m[last_member_index].k.p = NULL;
+        v->u.o.m[last_member_index].klen = 0;
+    }
+}
+
+/*
+ * A compiled JSON pointer is allocated at once: the header, the tokens, then their unescaped and
+ * null-terminated keys. The hash of each key is the one of the object index.
+ */
+#define LEPT_POINTER_APPEND ((size_t)-2)   /* the index of "-", past the last element */
+
+typedef struct {
+    const char *k;
+    size_t klen;
+    size_t hash;            /* lept_hash_key() of the key */
+    size_t index;           /* the array index, LEPT_POINTER_APPEND or LEPT_KEY_NOT_EXIST if not an index */
+} lept_pointer_token;
+
+struct lept_pointer {
+    size_t count;
+    lept_pointer_token *tokens;
+};
+
+/* A token is an array index if it is "-" or a decimal number without leading zeros */
+static size_t lept_pointer_index(const char *k, size_t klen) {
+    size_t i, index = 0;
+    if (klen == 1 && *k == '-')
+        return LEPT_POINTER_APPEND;
+    if (klen == 0 || (klen > 1 && *k == '0'))
+        return LEPT_KEY_NOT_EXIST;
+    for (i = 0; i < klen; i++) {
+        if (!ISDIGIT(k[i]) || index > (LEPT_POINTER_APPEND - 1 - (k[i] - '0')) / 10)
+            return LEPT_KEY_NOT_EXIST;
+        index = index * 10 + (k[i] - '0');
+    }
+    return index;
+}
+
+lept_pointer* lept_pointer_compile(const char *pointer) {
+    size_t count = 0, i;
+    const char *p;
+    char *k;
+    lept_pointer *ptr;
+    assert(pointer != NULL);
+    if (*pointer != '\0' && *pointer != '/')
+        return NULL;
+    for (p = pointer; *p != '\0'; p++)
+        count += *p == '/';
+    /* the keys take at most the characters of the pointer, a '/' becomes a null terminator */
+    ptr = (lept_pointer *)malloc(sizeof(lept_pointer) + count * sizeof(lept_pointer_token) + (p - pointer) + 1);
+    ptr->count = count;
+    ptr->tokens = (lept_pointer_token *)(ptr + 1);
+    k = (char *)(ptr->tokens + count);
+    for (p = pointer, i = 0; i < count; i++) {
+        lept_pointer_token *t = &ptr->tokens[i];
+        t->k = k;
+        for (p++; *p != '\0' && *p != '/'; p++) {
+            if (*p != '~')
+                *k++ = *p;
+            else if (p[1] == '0' || p[1] == '1')
+                *k++ = *++p == '0' ? '~' : '/';
+            else {
+                free(ptr);
+                return NULL;
+            }
+        }
+        t->klen = k - t->k;
+        *k++ = '\0';
+        t->hash = lept_hash_key(t->k, t->klen);
+        t->index = lept_pointer_index(t->k, t->klen);
+    }
+    return ptr;
+}
+
+void lept_pointer_free(lept_pointer *ptr) {
+    free(ptr);
+}
+
+static size_t lept_pointer_find_member(const lept_value *v, const lept_pointer_token *t) {
+    size_t i;
+    if (LEPT_OBJECT_INDEXED(LEPT_OBJECT_CAPACITY(v)))
+        return lept_object_index_find(v, t->k, t->klen, t->hash);
+    for (i = 0; i < LEPT_OBJECT_SIZE(v); ++i)
+        if (v->u.o.m[i].klen == t->klen && memcmp(LEPT_KEY(&v->u.o.m[i]), t->k, t->klen) == 0)
+            return i;
+    return LEPT_KEY_NOT_EXIST;
+}
+
+lept_value* lept_pointer_get(const lept_value *v, const lept_pointer *ptr) {
+    size_t i, index;
+    assert(v != NULL && ptr != NULL);
+    for (i = 0; i < ptr->count; i++) {
+        const lept_pointer_token *t = &ptr->tokens[i];
+        LEPT_EXPAND(v);
+        if (v->type == LEPT_OBJECT && (index = lept_pointer_find_member(v, t)) != LEPT_KEY_NOT_EXIST)
+            v = &v->u.o.m[index].v;
+        else if (v->type == LEPT_ARRAY && t->index < LEPT_ARRAY_SIZE(v))
+            v = &v->u.a.e[t->index];
+        else
+            return NULL;
+    }
+    return (lept_value *)v;
+}
+
+lept_value* lept_pointer_set(lept_value *v, const lept_pointer *ptr) {
+    size_t i, index;
+    assert(v != NULL && ptr != NULL);
+    for (i = 0; i < ptr->count; i++) {
+        const lept_pointer_token *t = &ptr->tokens[i];
+        LEPT_EXPAND(v);
+        if (v->type == LEPT_NULL)
+            lept_set_object(v, 0);
+        if (v->type == LEPT_OBJECT) {
+            if ((index = lept_pointer_find_member(v, t)) != LEPT_KEY_NOT_EXIST)
+                v = &v->u.o.m[index].v;
+            else
+                v = lept_set_object_value(v, t->k, t->klen);
+        }
+        else if (v->type == LEPT_ARRAY && t->index < LEPT_ARRAY_SIZE(v))
+            v = &v->u.a.e[t->index];
+        else if (v->type == LEPT_ARRAY && (t->index == LEPT_ARRAY_SIZE(v) || t->index == LEPT_POINTER_APPEND))
+            v = lept_pushback_array_element(v);
+        else
+            return NULL;
+    }
+    lept_free(v);
+    return v;
+}
+
+/*
+ * Projection: the selected paths form a trie of tokens. A member or element without a node in the trie
+ * is only skipped by lept_skip_value(), so its strings are not unescaped and its numbers not converted.
+ * A kept node selects its whole value, which is parsed as usual.
+ */
+struct lept_projection {
+    char *k;                /* the token leading to this node */
+    size_t klen;
+    size_t index;           /* the token as an array index, see lept_pointer_index() */
+    int keep;
+    lept_projection *children;
+    size_t count, capacity;
+    size_t elements;        /* elements past the largest index of the children are not stored */
+};
+
+static void lept_projection_init(lept_projection *node) {
+    node->k = NULL;
+    node->klen = 0;
+    node->index = LEPT_KEY_NOT_EXIST;
+    node->keep = 0;
+    node->children = NULL;
+    node->count = node->capacity = 0;
+    node->elements = 0;
+}
+
+static void lept_projection_free(lept_projection *node) {
+    size_t i;
+    for (i = 0; i < node->count; i++)
+        lept_projection_free(&node->children[i]);
+    free(node->children);
+    free(node->k);
+}
+
+static lept_projection* lept_projection_find(const lept_projection *node, const char *k, size_t klen) {
+    size_t i;
+    for (i = 0; i < node->count; i++)
+        if (node->children[i].klen == klen && memcmp(node->children[i].k, k, klen) == 0)
+            return &node->children[i];
+    return NULL;
+}
+
+static lept_projection* lept_projection_find_index(const lept_projection *node, size_t index) {
+    size_t i;
+    for (i = 0; i < node->count; i++)
+        if (node->children[i].index == index)
+            return &node->children[i];
+    return NULL;
+}
+
+static void lept_projection_add(lept_projection *root, const lept_pointer *ptr) {
+    lept_projection *node = root, *child;
+    size_t i;
+    for (i = 0; i < ptr->count && !node->keep; i++) {
+        const lept_pointer_token *t = &ptr->tokens[i];
+        if ((child = lept_projection_find(node, t->k, t->klen)) == NULL) {
+            if (node->count == node->capacity) {
+                node->capacity = node->capacity == 0 ? 4 : node->capacity * 2;
+                node->children = (lept_projection *)realloc(node->children, node->capacity * sizeof(lept_projection));
+            }
+            child = &node->children[node->count++];
+            lept_projection_init(child);
+            child->k = (char *)malloc(t->klen + 1);
+            memcpy(child->k, t->k, t->klen + 1);
+            child->klen = t->klen;
+            child->index = t->index;
+            if (t->index < LEPT_POINTER_APPEND && t->index >= node->elements)
+                node->elements = t->index + 1;
+        }
+        node = child;
+    }
+    node->keep = 1;     /* a longer path under a kept one changes nothing */
+}
+
+/* Skips a value which is not selected, an invalid one is parsed to report the error of the parser */
+static int lept_parse_skip(lept_context *c) {
+    const char *end = lept_skip_value(c->json, c->end);
+    lept_value e;
+    int ret;
+    if (end == NULL || end == c->json) {
+        lept_init(&e);
+        ret = lept_parse_value(c, &e);
+        lept_free(&e);
+        return ret != LEPT_PARSE_OK ? ret : LEPT_PARSE_INVALID_VALUE;
+    }
+    c->json = end;
+    return LEPT_PARSE_OK;
+}
+
+/* Whether the value at c is kept under node, which may be NULL */
+#define LEPT_PROJECTED(c, node) \
+    ((node) != NULL && ((node)->keep || PEEK(c) == '[' || PEEK(c) == '{'))
+
+static int lept_parse_projected_array(lept_context *c, lept_value *v, const lept_projection *node) {
+    size_t i, index, size = 0;
+    int ret;
+    EXPECT(c, '[');
+    lept_parse_whitespace(c);
+    if (PEEK(c) == ']') {
+        c->json++;
+        lept_set_array(v, 0);
+        return LEPT_PARSE_OK;
+    }
+    for (index = 0; ; index++) {
+        lept_value e;
+        const lept_projection *child = index < node->elements ? lept_projection_find_index(node, index) : NULL;
+        lept_parse_whitespace(c);
+        lept_init(&e);
+        if (!LEPT_PROJECTED(c, child))
+            ret = lept_parse_skip(c);
+        else
+            ret = lept_parse_projection(c, &e, child);
+        if (ret != LEPT_PARSE_OK) {
+            for (i = 0; i < size; ++i)
+                lept_free((lept_value *)lept_context_pop(c, sizeof(lept_value)));
+            return ret;
+        }
+        if (index < node->elements) {
+            memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
+            size++;
+        }
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',')
+            c->json++;
+        else if (PEEK(c) == ']') {
+            c->json++;
+            break;
+        }
+        else {
+            for (i = 0; i < size; ++i)
+                lept_free((lept_value *)lept_context_pop(c, sizeof(lept_value)));
+            return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+    }
+    v->type = LEPT_ARRAY;
+    LEPT_ARRAY_SIZE(v) = size;
+    lept_set_array_storage(v, size > 0 ? malloc(LEPT_ARRAY_STORAGE_SIZE(size)) : NULL, size);
+    size *= sizeof(lept_value);
+    if (size > 0)
+        memcpy(v->u.a.e, lept_context_pop(c, size), size);
+    return LEPT_PARSE_OK;
+}
+
+static int lept_parse_projected_object(lept_context *c, lept_value *v, const lept_projection *node) {
+    size_t i, size = 0;
+    lept_member m;
+    int ret;
+    EXPECT(c, '{');
+    lept_parse_whitespace(c);
+    if (PEEK(c) == '}') {
+        c->json++;
+        lept_set_object(v, 0);
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        const lept_projection *child;
+        char *str;
+        lept_parse_whitespace(c);
+        ret = LEPT_PARSE_MISS_KEY;
+        if (PEEK(c) != '"' || lept_parse_string_raw(c, &str, &m.klen) != LEPT_PARSE_OK)
+            break;
+        child = lept_projection_find(node, str, m.klen);
+        if (child != NULL)
+            lept_member_copy_key(&m, str, m.klen);
+        lept_parse_whitespace(c);
+        if (PEEK(c) != ':') {
+            if (child != NULL)
+                lept_member_free_key(&m);
+            ret = LEPT_PARSE_MISS_COLON;
+            break;
+        }
+        c->json++;
+        lept_parse_whitespace(c);
+        lept_init(&m.v);
+        if (LEPT_PROJECTED(c, child))
+            ret = lept_parse_projection(c, &m.v, child);
+        else {
+            if (child != NULL)
+                lept_member_free_key(&m);
+            child = NULL;
+            ret = lept_parse_skip(c);
+        }
+        if (ret != LEPT_PARSE_OK) {
+            if (child != NULL)
+                lept_member_free_key(&m);
             break;
-        case LEPT_ARRAY:
-            PUT(c, '[');
-            for (i = 0; i < v->u.a.size; ++i) {
-                if (i > 0)
-                    PUT(c, ',');
-                lept_stringify_value(c, &v->u.a.e[i]);
-            }
-            PUT(c, ']');
+        }
+        if (child != NULL) {
+            memcpy(lept_context_push(c, sizeof(lept_member)), &m, sizeof(lept_member));
+            size++;
+        }
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',')
+            c->json++;
+        else if (PEEK(c) == '}') {
+            c->json++;
             break;
-        case LEPT_OBJECT:
-            PUT(c, '{');
-            for (i = 0; i < v->u.o.size; ++i) {
-                if (i > 0)
-                    PUT(c, ',');
-                lept_stringify_string(c, v->u.o.m[i].k, v->u.o.m[i].klen);
-                PUT(c, ':');
-                lept_stringify_value(c, &v->u.o.m[i].v);
-            }
-            PUT(c, '}');
+        }
+        else {
+            ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
             break;
-        default:
-            assert(0 && "invalid type");
+        }
     }
-    return;
+    if (ret == LEPT_PARSE_OK && size > LEPT_SIZE_MAX)
+        ret = LEPT_PARSE_SIZE_TOO_BIG;  /* kept duplicates of a key */
+    if (ret != LEPT_PARSE_OK) {
+        for (i = 0; i < size; ++i) {
+            lept_member *p = (lept_member *)lept_context_pop(c, sizeof(lept_member));
+            lept_member_free_key(p);
+            lept_free(&p->v);
+        }
+        return ret;
+    }
+    v->type = LEPT_OBJECT;
+    LEPT_OBJECT_SIZE(v) = size;
+    lept_set_object_storage(v, size > 0 ? malloc(lept_object_storage_size(size)) : NULL, size);
+    if (size > 0)
+        memcpy(v->u.o.m, lept_context_pop(c, size * sizeof(lept_member)), size * sizeof(lept_member));
+    lept_object_index_rebuild(v);
+    return LEPT_PARSE_OK;
 }
 
-char* lept_stringify(const lept_value *v, size_t* length) {
-    lept_context c;
-    assert(v != NULL);
-    c.stack = (char *)malloc(c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
-    c.top = 0;
-    lept_stringify_value(&c, v);
-    if (length)
-        *length = c.top;
-    PUT(&c, '\0');
-    return c.stack;
+/* The value at c under node: kept as a whole, projected if it is an array or object, or skipped */
+static int lept_parse_projection(lept_context *c, lept_value *v, const lept_projection *node) {
+    int ret;
+    if (node->keep)
+        return lept_parse_value(c, v);
+    if (PEEK(c) != '[' && PEEK(c) != '{')
+        return lept_parse_skip(c);
+    if (c->depth >= c->max_depth)
+        return LEPT_PARSE_DEPTH_EXCEEDED;
+    c->depth++;
+    ret = PEEK(c) == '[' ? lept_parse_projected_array(c, v, node) : lept_parse_projected_object(c, v, node);
+    c->depth--;
+    return ret;
 }
 
-void lept_copy(lept_value *dst, const lept_value *src) {
+int lept_parse_projected(lept_value *v, const char *json, const char *const *paths, size_t npaths) {
+    lept_projection root;
+    lept_context c;
     size_t i;
-    assert(dst != NULL && src != NULL && src != dst);
-    switch(src->type) {
-        case LEPT_STRING:
-            lept_set_string(dst, src->u.s.s, src->u.s.len);
-            break;
-        case LEPT_ARRAY:
-            lept_free(dst);
-            lept_set_array(dst, src->u.a.capacity);
-            for (i = 0; i < src->u.a.size; ++i) {
-                lept_init(&dst->u.a.e[i]);
-                lept_copy(&dst->u.a.e[i], &src->u.a.e[i]);
-            }
-            dst->u.a.size = src->u.a.size;
-            break;
-        case LEPT_OBJECT:
-            lept_free(dst);
-            lept_set_object(dst, src->u.o.capacity);
-            for (i = 0; i < src->u.o.size; ++i) {
-                lept_copy(lept_set_object_value(dst, src->u.o.m[i].k, src->u.o.m[i].klen), 
-                          &src->u.o.m[i].v);
-            }
-            dst->u.o.size = src->u.o.size;
-            break;
-        default:
-            lept_free(dst);
-            memcpy(dst, src, sizeof(lept_value));
-            break;
+    int ret;
+    assert(json != NULL && (paths != NULL || npaths == 0));
+    lept_projection_init(&root);
+    for (i = 0; i < npaths; i++) {
+        lept_pointer *ptr = lept_pointer_compile(paths[i]);
+        assert(ptr != NULL);
+        if (ptr != NULL) {
+            lept_projection_add(&root, ptr);
+            lept_pointer_free(ptr);
+        }
     }
+    lept_context_init(&c, json, strlen(json));
+    c.projection = &root;
+    ret = lept_parse_context(&c, v);
+    lept_projection_free(&root);
+    return ret;
 }
 
-void lept_move(lept_value *dst, lept_value *src) {
-    assert(dst != NULL && src != NULL && src != dst);
-    lept_free(dst);
-    memcpy(dst, src, sizeof(lept_value));
-    lept_init(src);
+/*
+ * A frozen document is one block: the number of words on its tape, the tape, then its strings. Each value
+ * takes two words in document order, the low LEPT_TAPE_TYPE_BITS of the first one being its type:
+ *   number:         the second word holds the number.
+ *   string:         the rest of the first word is the offset of its null-terminated bytes among the
+ *                   strings, the second word is its length.
+ *   array, object:  the rest of the first word is the count of words up to the next sibling, the second
+ *                   word is the count of elements or members. A member is a key string and its value.
+ */
+typedef union {
+    size_t u;
+    double n;
+} lept_tape_word;
+
+struct lept_frozen {
+    lept_tape_word words;   /* followed by the tape and the strings */
+};
+
+#define LEPT_TAPE_TYPE_BITS     3
+#define LEPT_TAPE(d)            ((const lept_tape_word *)(d) + 1)
+#define LEPT_TAPE_STRINGS(d)    ((const char *)(LEPT_TAPE(d) + (d)->words.u))
+#define LEPT_TAPE_TYPE(d, v)    ((lept_type)(LEPT_TAPE(d)[v].u & ((1 << LEPT_TAPE_TYPE_BITS) - 1)))
+#define LEPT_TAPE_PAYLOAD(d, v) (LEPT_TAPE(d)[v].u >> LEPT_TAPE_TYPE_BITS)
+
+typedef struct {
+    lept_context tape, strings;     /* only used as growable buffers */
+    size_t open;                    /* 1 + the tape offset of the innermost open array or object, or 0 */
+} lept_tape_builder;
+
+/* Appends a value and returns its tape offset */
+static size_t lept_tape_push(lept_tape_builder *b, lept_type type, size_t payload, size_t second) {
+    lept_tape_word *w = (lept_tape_word *)lept_context_push(&b->tape, 2 * sizeof(lept_tape_word));
+    w[0].u = (payload << LEPT_TAPE_TYPE_BITS) | type;
+    w[1].u = second;
+    return b->tape.top / sizeof(lept_tape_word) - 2;
 }
 
-void lept_swap(lept_value *lhs, lept_value *rhs) {
-    assert(lhs != NULL && rhs != NULL);
-    if (lhs != rhs) {
-        lept_value temp;
-        memcpy(&temp, lhs, sizeof(lept_value));
-        memcpy(lhs,   rhs, sizeof(lept_value));
-        memcpy(rhs, &temp, sizeof(lept_value));
-    }
+static int lept_tape_null(void *ctx) {
+    lept_tape_push((lept_tape_builder *)ctx, LEPT_NULL, 0, 0);
+    return 1;
 }
 
-void lept_free(lept_value *v) {
-    assert(v != NULL);
-    if (v->type == LEPT_STRING) {
-        free(v->u.s.s);
-        v->u.s.s = NULL;
-    }
-    else if (v->type == LEPT_ARRAY) {
-        size_t i;
-        for (i = 0; i < v->u.a.size; ++i) {
-            lept_free(lept_get_array_element(v, i));
-        }
-        free(v->u.a.e);
-        v->u.a.e = NULL;
-    }
-    else if (v->type == LEPT_OBJECT) {
-        size_t i;
-        for (i = 0; i < v->u.o.size; ++i) {
-            free(v->u.o.m[i].k);
-            lept_free(&v->u.o.m[i].v);
-        }
-        free(v->u.o.m);
-        v->u.o.m = NULL;
-    }
-    v->type = LEPT_NULL;
-    return;
+static int lept_tape_boolean(void *ctx, int b) {
+    lept_tape_push((lept_tape_builder *)ctx, b ? LEPT_TRUE : LEPT_FALSE, 0, 0);
+    return 1;
 }
 
-lept_type lept_get_type(const lept_value* v) {
-    assert(v != NULL);              /* caller should ensure the v is valid */
-    return v->type;
+static int lept_tape_number(void *ctx, double n) {
+    lept_tape_builder *b = (lept_tape_builder *)ctx;
+    size_t v = lept_tape_push(b, LEPT_NUMBER, 0, 0);
+    ((lept_tape_word *)b->tape.stack)[v + 1].n = n;
+    return 1;
 }
 
-int lept_is_equal(const lept_value *lhs, const lept_value *rhs) {
-    size_t i;
-    assert(lhs != NULL && rhs != NULL);
-    if (lhs->type != rhs->type)
-        return 0;
-    switch (lhs->type) {
-        case LEPT_STRING:
-            return lhs->u.s.len == rhs->u.s.len &&
-                   memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
-        case LEPT_NUMBER:
-            return lhs->u.n == rhs->u.n;
-        case LEPT_ARRAY:
-            if (lhs->u.a.size != rhs->u.a.size)
-                return 0;
-            for (i = 0; i < lhs->u.a.size; ++i)
-                if (!lept_is_equal(&lhs->u.a.e[i], &rhs->u.a.e[i]))
-                    return 0;
-            return 1;
-        case LEPT_OBJECT:
-            if (lhs->u.o.size != rhs->u.o.size)
-                return 0;
-            for (i = 0; i < lhs->u.o.size; ++i) {
-                if (!lept_is_equal(&lhs->u.o.m[i].v,
-                                   lept_find_object_value((lept_value *)rhs, lhs->u.o.m[i].k, lhs->u.o.m[i].klen))) {
-                    return 0;
-                }
-            }
-            return 1;
-        default:
-            return 1;
-    }
+static int lept_tape_string(void *ctx, const char *s, size_t len) {
+    lept_tape_builder *b = (lept_tape_builder *)ctx;
+    char *p;
+    lept_tape_push(b, LEPT_STRING, b->strings.top, len);
+    p = (char *)lept_context_push(&b->strings, len + 1);
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return 1;
 }
 
-int lept_get_boolean(const lept_value *v) {
-    assert(v != NULL && (v->type == LEPT_TRUE || v->type == LEPT_FALSE));
-    return v->type == LEPT_TRUE ? 1 : 0;
+/* The second word of an open array or object links to the enclosing one until it is closed */
+static int lept_tape_start(lept_tape_builder *b, lept_type type) {
+    b->open = lept_tape_push(b, type, 0, b->open) + 1;
+    return 1;
 }
 
-void lept_set_boolean(lept_value *v, int b) {
-    assert(v != NULL);
-    v->type = (b != 0 ? LEPT_TRUE : LEPT_FALSE);
-    return;
+static int lept_tape_end(lept_tape_builder *b, lept_type type, size_t count) {
+    size_t v = b->open - 1;
+    lept_tape_word *w = (lept_tape_word *)b->tape.stack + v;
+    b->open = w[1].u;
+    w[0].u = ((b->tape.top / sizeof(lept_tape_word) - v) << LEPT_TAPE_TYPE_BITS) | type;
+    w[1].u = count;
+    return 1;
 }
 
-double lept_get_number(const lept_value* v) {
-    assert(v != NULL && v->type == LEPT_NUMBER);    /* caller should ensure the type of v is correct */
-    return v->u.n;
+static int lept_tape_start_array(void *ctx) {
+    return lept_tape_start((lept_tape_builder *)ctx, LEPT_ARRAY);
 }
 
-void lept_set_number(lept_value *v, double n) {
-    assert(v != NULL);
-    lept_free(v);
-    v->u.n = n;
-    v->type = LEPT_NUMBER;
-    return;
+static int lept_tape_end_array(void *ctx, size_t count) {
+    return lept_tape_end((lept_tape_builder *)ctx, LEPT_ARRAY, count);
 }
 
-const char *lept_get_string(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.s;
+static int lept_tape_start_object(void *ctx) {
+    return lept_tape_start((lept_tape_builder *)ctx, LEPT_OBJECT);
 }
 
-size_t lept_get_string_length(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.len;
+static int lept_tape_end_object(void *ctx, size_t count) {
+    return lept_tape_end((lept_tape_builder *)ctx, LEPT_OBJECT, count);
 }
 
-void lept_set_string(lept_value *v, const char *s, size_t len) {
-    assert(v != NULL && (s != NULL || len == 0));
-    lept_free(v);
-    v->u.s.s = (char *)malloc(len + 1);
-    memcpy(v->u.s.s, s, len);
-    v->u.s.s[len] = '\0';
-    v->u.s.len = len;
-    v->type = LEPT_STRING;
+int lept_parse_frozen(lept_frozen **d, const char *json, size_t len) {
+    static const lept_handler handler = {
+        lept_tape_null, lept_tape_boolean, lept_tape_number, lept_tape_string,
+        lept_tape_start_array, lept_tape_end_array,
+        lept_tape_start_object, lept_tape_string, lept_tape_end_object
+    };
+    lept_tape_builder b;
+    int ret;
+    assert(d != NULL && json != NULL);
+    *d = NULL;
+    b.tape.stack = b.strings.stack = NULL;
+    b.tape.size = b.tape.top = b.strings.size = b.strings.top = 0;
+    b.open = 0;
+    if ((ret = lept_parse_sax(json, len, &handler, &b)) == LEPT_PARSE_OK) {
+        *d = (lept_frozen *)malloc(sizeof(lept_frozen) + b.tape.top + b.strings.top);
+        (*d)->words.u = b.tape.top / sizeof(lept_tape_word);
+        memcpy((lept_tape_word *)LEPT_TAPE(*d), b.tape.stack, b.tape.top);
+        if (b.strings.top > 0)
+            memcpy((char *)LEPT_TAPE_STRINGS(*d), b.strings.stack, b.strings.top);
+    }
+    free(b.tape.stack);
+    free(b.strings.stack);
+    return ret;
 }
 
-void lept_set_array(lept_value *v, size_t capacity) {
-    assert(v != NULL);
-    lept_free(v);
-    v->type = LEPT_ARRAY;
-    v->u.a.size = 0;
-    v->u.a.capacity = capacity;
-    v->u.a.e = capacity > 0 ? (lept_value *)malloc(capacity * sizeof(lept_value)) : NULL;
+void lept_frozen_free(lept_frozen *d) {
+    free(d);
 }
 
-size_t lept_get_array_size(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    return v->u.a.size;
+lept_type lept_frozen_get_type(const lept_frozen *d, size_t v) {
+    assert(d != NULL && v < d->words.u);
+    return LEPT_TAPE_TYPE(d, v);
 }
 
-size_t lept_get_array_capacity(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    return v->u.a.capacity;
+size_t lept_frozen_next(const lept_frozen *d, size_t v) {
+    lept_type type = lept_frozen_get_type(d, v);
+    return type == LEPT_ARRAY || type == LEPT_OBJECT ? v + LEPT_TAPE_PAYLOAD(d, v) : v + 2;
 }
 
-void lept_reserve_array(lept_value *v, size_t capacity) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.capacity < capacity) {
-        v->u.a.capacity = capacity;
-        v->u.a.e = (lept_value *)realloc(v->u.a.e, capacity * sizeof(lept_value));
-    }
+int lept_frozen_get_boolean(const lept_frozen *d, size_t v) {
+    assert(d != NULL && (LEPT_TAPE_TYPE(d, v) == LEPT_TRUE || LEPT_TAPE_TYPE(d, v) == LEPT_FALSE));
+    return LEPT_TAPE_TYPE(d, v) == LEPT_TRUE;
 }
 
-void lept_shrink_array(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.capacity > v->u.a.size) {
-        v->u.a.capacity = v->u.a.size;
-        v->u.a.e = (lept_value *)realloc(v->u.a.e, v->u.a.capacity * sizeof(lept_value));
-    }
+double lept_frozen_get_number(const lept_frozen *d, size_t v) {
+    assert(d != NULL && LEPT_TAPE_TYPE(d, v) == LEPT_NUMBER);
+    return LEPT_TAPE(d)[v + 1].n;
 }
 
-void lept_clear_array(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    lept_erase_array_element(v, 0, v->u.a.size);
+const char* lept_frozen_get_string(const lept_frozen *d, size_t v) {
+    assert(d != NULL && LEPT_TAPE_TYPE(d, v) == LEPT_STRING);
+    return LEPT_TAPE_STRINGS(d) + LEPT_TAPE_PAYLOAD(d, v);
 }
 
-lept_value* lept_get_array_element(const lept_value *v, size_t index) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    assert(index < v->u.a.size);
-    return (v->u.a.e + index);
+size_t lept_frozen_get_string_length(const lept_frozen *d, size_t v) {
+    assert(d != NULL && LEPT_TAPE_TYPE(d, v) == LEPT_STRING);
+    return LEPT_TAPE(d)[v + 1].u;
 }
 
-lept_value* lept_pushback_array_element(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.size == v->u.a.capacity)
-        lept_reserve_array(v, v->u.a.capacity == 0 ? 1 : v->u.a.capacity * 2);
-    lept_init(&v->u.a.e[v->u.a.size]);
-    return &v->u.a.e[v->u.a.size++];
+size_t lept_frozen_get_array_size(const lept_frozen *d, size_t v) {
+    assert(d != NULL && LEPT_TAPE_TYPE(d, v) == LEPT_ARRAY);
+    return LEPT_TAPE(d)[v + 1].u;
 }
 
-void lept_popback_array_element(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY && v->u.a.size > 0);
-    lept_free(&v->u.a.e[--v->u.a.size]);
+size_t lept_frozen_get_array_element(const lept_frozen *d, size_t v, size_t index) {
+    size_t e = v + 2;
+    assert(index < lept_frozen_get_array_size(d, v));
+    while (index-- > 0)
+        e = lept_frozen_next(d, e);
+    return e;
 }
 
-lept_value* lept_insert_array_element(lept_value *v, size_t index) {
-    size_t i;
-    assert(v != NULL && v->type == LEPT_ARRAY && index <= v->u.a.size);
-    if (index == v->u.a.size)
-        return lept_pushback_array_element(v);
-    if (v->u.a.size == v->u.a.capacity)
-        lept_reserve_array(v, v->u.a.capacity == 0 ? 1 : v->u.a.capacity * 2);
-    for (i = v->u.a.size; i > index; --i) {
-        memcpy(&v->u.a.e[i], &v->u.a.e[i-1], sizeof(lept_value));
-    }
-    v->u.a.size++;
-    lept_init(&v->u.a.e[index]);
-    return &v->u.a.e[index];
+size_t lept_frozen_get_object_size(const lept_frozen *d, size_t v) {
+    assert(d != NULL && LEPT_TAPE_TYPE(d, v) == LEPT_OBJECT);
+    return LEPT_TAPE(d)[v + 1].u;
 }
 
-void lept_erase_array_element(lept_value *v, size_t index, size_t count) {
-    size_t i;
-    assert(v != NULL && v->type == LEPT_ARRAY && index + count <= v->u.a.size);
-    for (i = index; i < index + count; ++i)
-        lept_free(&v->u.a.e[i]);
-    if (count != 0 && index + count < v->u.a.size) {
-        for (i = index + count; i < v->u.a.size; ++i) {
-            lept_move(&v->u.a.e[i-count], &v->u.a.e[i]);
-        }
-    }
-    v->u.a.size -= count;
+/* The tape offset of the key of a member, its value follows */
+static size_t lept_frozen_member(const lept_frozen *d, size_t v, size_t index) {
+    size_t m = v + 2;
+    assert(index < lept_frozen_get_object_size(d, v));
+    while (index-- > 0)
+        m = lept_frozen_next(d, m + 2);
+    return m;
 }
 
-void lept_set_object(lept_value *v, size_t capacity) {
-    assert(v != NULL);
-    lept_free(v);
-    v->type = LEPT_OBJECT;
-    v->u.o.size = 0;
-    v->u.o.capacity = capacity;
-    v->u.o.m = capacity > 0 ? (lept_member *)malloc(capacity * sizeof(lept_member)) : NULL;
+const char* lept_frozen_get_object_key(const lept_frozen *d, size_t v, size_t index) {
+    return lept_frozen_get_string(d, lept_frozen_member(d, v, index));
 }
 
-size_t lept_get_object_size(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    return v->u.o.size;
+size_t lept_frozen_get_object_key_length(const lept_frozen *d, size_t v, size_t index) {
+    return lept_frozen_get_string_length(d, lept_frozen_member(d, v, index));
 }
 
-size_t lept_get_object_capacity(const lept_value *v) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    return v->u.o.capacity;
+size_t lept_frozen_get_object_value(const lept_frozen *d, size_t v, size_t index) {
+    return lept_frozen_member(d, v, index) + 2;
 }
 
-void lept_reserve_object(lept_value *v, size_t capacity) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    if (v->u.o.capacity < capacity) {
-        v->u.o.capacity = capacity;
-        v->u.o.m = (lept_member *)realloc(v->u.o.m, capacity * sizeof(lept_member));
-    }
+size_t lept_frozen_find_object_value(const lept_frozen *d, size_t v, const char *key, size_t klen) {
+    size_t i, m = v + 2, size = lept_frozen_get_object_size(d, v);
+    assert(key != NULL);
+    for (i = 0; i < size; i++, m = lept_frozen_next(d, m + 2))
+        if (LEPT_TAPE(d)[m + 1].u == klen && memcmp(lept_frozen_get_string(d, m), key, klen) == 0)
+            return m + 2;
+    return LEPT_KEY_NOT_EXIST;
 }
 
-void lept_shrink_object(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    if (v->u.o.capacity > v->u.o.size) {
-        v->u.o.capacity = v->u.o.size;
-        v->u.o.m = (lept_member *)realloc(v->u.o.m, v->u.o.size * sizeof(lept_member));
+/* Appends v, or opens it and returns 1 if it is an array or object with children to append */
+static int lept_tape_node(lept_tape_builder *b, const lept_value *v) {
+    LEPT_EXPAND(v);
+    switch (v->type) {
+        case LEPT_NULL:
+            lept_tape_null(b);
+            return 0;
+        case LEPT_FALSE:
+        case LEPT_TRUE:
+            lept_tape_boolean(b, v->type == LEPT_TRUE);
+            return 0;
+        case LEPT_NUMBER:
+            lept_tape_number(b, v->u.n);
+            return 0;
+        case LEPT_STRING:
+            lept_tape_string(b, LEPT_STRING(v), LEPT_STRING_LEN(v));
+            return 0;
+        case LEPT_ARRAY:
+            lept_tape_start(b, LEPT_ARRAY);
+            if (LEPT_ARRAY_SIZE(v) > 0)
+                return 1;
+            lept_tape_end(b, LEPT_ARRAY, 0);
+            return 0;
+        case LEPT_OBJECT:
+            lept_tape_start(b, LEPT_OBJECT);
+            if (LEPT_OBJECT_SIZE(v) > 0)
+                return 1;
+            lept_tape_end(b, LEPT_OBJECT, 0);
+            return 0;
+        default:
+            assert(0 && "invalid type");
+            return 0;
     }
 }
 
-void lept_clear_object(lept_value *v) {
-    size_t i;
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    for (i = 0; i < v->u.o.size; ++i) {
-        free(v->u.o.m[i].k);
-        lept_free(&v->u.o.m[i].v);
+/* Appends a tree to the tape the way the event based parser would, without recursion */
+static void lept_tape_value(lept_tape_builder *b, const lept_value *v) {
+    lept_context s;
+    lept_visit *f;
+    size_t i = 0;
+    if (!lept_tape_node(b, v))
+        return;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    for (;;) {
+        size_t size = v->type == LEPT_ARRAY ? LEPT_ARRAY_SIZE(v) : LEPT_OBJECT_SIZE(v);
+        if (i < size) {
+            const lept_value *child;
+            if (v->type == LEPT_ARRAY)
+                child = &v->u.a.e[i];
+            else {
+                lept_tape_string(b, LEPT_KEY(&v->u.o.m[i]), v->u.o.m[i].klen);
+                child = &v->u.o.m[i].v;
+            }
+            i++;
+            if (lept_tape_node(b, child)) {
+                lept_visit_push(&s, (lept_value *)v, NULL, i);
+                v = child;
+                i = 0;
+            }
+        }
+        else {
+            lept_tape_end(b, (lept_type)v->type, size);
+            if (s.top == 0)
+                break;
+            f = (lept_visit *)lept_context_pop(&s, sizeof(lept_visit));
+            v = f->v;
+            i = f->i;
+        }
     }
-    v->u.o.size = 0;
+    free(s.stack);
 }
 
-const char* lept_get_object_key(const lept_value *v, size_t index) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
-    return v->u.o.m[index].k;
+/*
+ * A snapshot file is a header and a frozen document. The magic holds the size of a tape word and the
+ * order field its byte order, a snapshot only opens where both match.
+ */
+#define LEPT_SNAPSHOT_MAGIC     "LEPTSNP"
+#define LEPT_SNAPSHOT_ORDER     ((size_t)0x01020304UL)
+
+typedef struct {
+    char magic[8];          /* LEPT_SNAPSHOT_MAGIC, with its last character replaced by sizeof(size_t) */
+    size_t order;           /* LEPT_SNAPSHOT_ORDER */
+    size_t size;            /* bytes of the frozen document */
+    size_t reserved;        /* keeps the document aligned for a double */
+} lept_snapshot_header;
+
+static void lept_snapshot_header_init(lept_snapshot_header *h, size_t size) {
+    memcpy(h->magic, LEPT_SNAPSHOT_MAGIC, sizeof(h->magic));
+    h->magic[sizeof(h->magic) - 2] = (char)sizeof(size_t);
+    h->order = LEPT_SNAPSHOT_ORDER;
+    h->size = size;
+    h->reserved = 0;
 }
 
-size_t lept_get_object_key_length(const lept_value *v, size_t index) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
-    return v->u.o.m[index].klen;
+int lept_save_snapshot(const lept_value *v, const char *path) {
+    lept_tape_builder b;
+    lept_snapshot_header h;
+    lept_tape_word words;
+    FILE *fp;
+    int ret = 0;
+    assert(v != NULL && path != NULL);
+    b.tape.stack = b.strings.stack = NULL;
+    b.tape.size = b.tape.top = b.strings.size = b.strings.top = 0;
+    b.open = 0;
+    lept_tape_value(&b, v);
+    words.u = b.tape.top / sizeof(lept_tape_word);
+    lept_snapshot_header_init(&h, sizeof(words) + b.tape.top + b.strings.top);
+    if ((fp = fopen(path, "wb")) != NULL) {
+        ret = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(&words, sizeof(words), 1, fp) == 1 &&
+              fwrite(b.tape.stack, 1, b.tape.top, fp) == b.tape.top &&
+              (b.strings.top == 0 || fwrite(b.strings.stack, 1, b.strings.top, fp) == b.strings.top);
+        ret = fclose(fp) == 0 && ret;
+    }
+    free(b.tape.stack);
+    free(b.strings.stack);
+    return ret;
 }
 
-lept_value* lept_get_object_value(const lept_value *v, size_t index) {
-    assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
-    return &v->u.o.m[index].v;
+typedef struct {
+    size_t end;             /* the tape offset after the container */
+    size_t count;           /* its elements or members still to come */
+    int object, key;        /* it is an object, whose next child is a key */
+} lept_tape_frame;
+
+/*
+ * Checks in one pass that the tape of d is a single value that the accessors can walk without leaving
+ * the document: every type is known, every array or object holds its count of children within its skip
+ * count and its parent, every member starts with a string, and every string is inside the pool of
+ * strings bytes and null-terminated there.
+ */
+static int lept_frozen_valid(const lept_frozen *d, size_t strings) {
+    lept_context s;
+    lept_tape_frame f;
+    size_t v = 0, words = d->words.u, payload, second;
+    int valid = words % 2 == 0;
+    s.stack = NULL;
+    s.size = s.top = 0;
+    f.end = words;
+    f.count = 1;
+    f.object = f.key = 0;
+    while (valid) {
+        if (v == f.end) {
+            valid = f.count == 0 && f.key == f.object;
+            if (s.top == 0)
+                break;
+            f = *(lept_tape_frame *)lept_context_pop(&s, sizeof(lept_tape_frame));
+            continue;
+        }
+        if (f.count == 0 || (f.key && LEPT_TAPE_TYPE(d, v) != LEPT_STRING)) {
+            valid = 0;
+            break;
+        }
+        if (f.key)
+            f.key = 0;
+        else {
+            f.count--;
+            f.key = f.object;
+        }
+        payload = LEPT_TAPE_PAYLOAD(d, v);
+        second = LEPT_TAPE(d)[v + 1].u;
+        switch (LEPT_TAPE_TYPE(d, v)) {
+            case LEPT_NULL:
+            case LEPT_FALSE:
+            case LEPT_TRUE:
+            case LEPT_NUMBER:
+                break;
+            case LEPT_STRING:
+                valid = payload < strings && second < strings - payload &&
+                        LEPT_TAPE_STRINGS(d)[payload + second] == '\0';
+                break;
+            case LEPT_ARRAY:
+            case LEPT_OBJECT:
+                if (!(valid = payload >= 2 && payload % 2 == 0 && payload <= f.end - v))
+                    break;
+                *(lept_tape_frame *)lept_context_push(&s, sizeof(lept_tape_frame)) = f;
+                f.end = v + payload;
+                f.count = second;
+                f.object = f.key = LEPT_TAPE_TYPE(d, v) == LEPT_OBJECT;
+                break;
+            default:
+                valid = 0;
+        }
+        v += 2;
+    }
+    free(s.stack);
+    return valid;
 }
 
-size_t lept_find_object_index(const lept_value *v, const char *key, size_t klen) {
-    size_t i;
-    assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
-    for (i = 0; i < v->u.o.size; ++i)
-        if (v->u.o.m[i].klen == klen && memcmp(v->u.o.m[i].k, key, klen) == 0)
-            return i;
-    return LEPT_KEY_NOT_EXIST;
+/* The document of a snapshot of len bytes at p, NULL if it is not one of this platform or is corrupted */
+static lept_frozen* lept_snapshot_document(const char *p, size_t len) {
+    lept_snapshot_header expect;
+    const lept_frozen *d = (const lept_frozen *)(p + sizeof(lept_snapshot_header));
+    if (len < sizeof(lept_snapshot_header) + sizeof(lept_frozen))
+        return NULL;
+    lept_snapshot_header_init(&expect, len - sizeof(lept_snapshot_header));
+    if (memcmp(p, &expect, sizeof(expect)) != 0 || d->words.u < 2 ||
+        d->words.u > (expect.size - sizeof(lept_frozen)) / sizeof(lept_tape_word) ||
+        !lept_frozen_valid(d, expect.size - sizeof(lept_frozen) - d->words.u * sizeof(lept_tape_word)))
+        return NULL;
+    return (lept_frozen *)d;
 }
 
-lept_value* lept_find_object_value(lept_value *v, const char *key, size_t klen) {
-    size_t index = lept_find_object_index(v, key, klen);
-    return index != LEPT_KEY_NOT_EXIST ? &v->u.o.m[index].v : NULL;
+#if defined(_WIN32)
+lept_frozen* lept_open_snapshot(const char *path) {
+    FILE *fp;
+    char *p = NULL;
+    long len;
+    lept_frozen *d = NULL;
+    assert(path != NULL);
+    if ((fp = fopen(path, "rb")) == NULL)
+        return NULL;
+    if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0 &&
+        (p = (char *)malloc(len)) != NULL && fread(p, 1, len, fp) == (size_t)len)
+        d = lept_snapshot_document(p, len);
+    fclose(fp);
+    if (d == NULL)
+        free(p);
+    return d;
 }
 
-lept_value* lept_set_object_value(lept_value *v, const char *key, size_t klen) {
-    size_t new_member_index;
-    lept_value *member_v;
-    assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
-    if ((member_v = lept_find_object_value(v, key, klen)) != NULL) {
-        lept_free(member_v);
-        return member_v;
-    }
-    if (v->u.o.size == v->u.o.capacity)
-        lept_reserve_object(v, v->u.o.capacity == 0 ? 1 : v->u.o.capacity * 2);
-    new_member_index = v->u.o.size++;
-    memcpy(v->u.o.m[new_member_index].k = (char *)malloc(klen+1), key, klen);
-    v->u.o.m[new_member_index].k[klen] = '\0';
-    v->u.o.m[new_member_index].klen = klen;
-    lept_init(&v->u.o.m[new_member_index].v);
-    return &v->u.o.m[new_member_index].v;
+void lept_close_snapshot(lept_frozen *d) {
+    if (d != NULL)
+        free((char *)d - sizeof(lept_snapshot_header));
+}
+#else
+lept_frozen* lept_open_snapshot(const char *path) {
+    struct stat st;
+    void *p;
+    lept_frozen *d;
+    int fd;
+    assert(path != NULL);
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+    p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+    if ((d = lept_snapshot_document((const char *)p, st.st_size)) == NULL)
+        munmap(p, st.st_size);
+    return d;
 }
 
-void lept_remove_object_value(lept_value *v, size_t index) {
-    size_t last_member_index;
-    assert(v != NULL && v->type == LEPT_OBJECT && index < v->u.o.size);
-    free(v->u.o.m[index].k);
-    lept_free(&v->u.o.m[index].v);
-    last_member_index = --v->u.o.size;
-    if (index != last_member_index) {
-        v->u.o.m[index].k = v->u.o.m[last_member_index].k;
-        v->u.o.m[index].klen = v->u.o.m[last_member_index].klen;
-        lept_move(&v->u.o.m[index].v, &v->u.o.m[last_member_index].v);
-        v->u.o.m[last_member_index].k = NULL;
-        v->u.o.m[last_member_index].klen = 0;
+void lept_close_snapshot(lept_frozen *d) {
+    const lept_snapshot_header *h;
+    if (d != NULL) {
+        h = (const lept_snapshot_header *)d - 1;
+        munmap((void *)h, sizeof(*h) + h->size);
     }
 }
+#endif
@@ -2,8 +2,9 @@
 #define LEPTJSON_H__
 
 #include <stddef.h>  /* size_t */
+#include <stdio.h>   /* FILE */
 
-#define lept_init(v)        do { (v)->type = LEPT_NULL; } while(0)
+#define lept_init(v)        do { (v)->type = LEPT_NULL; (v)->flags = 0; } while(0)
 #define lept_set_null(v)    lept_free(v)
 
 /* All possible values for JSON type */
@@ -11,21 +12,55 @@ typedef enum { LEPT_NULL, LEPT_FALSE, LEPT_TRUE, LEPT_NUMBER, LEPT_STRING, LEPT_
 
 #define LEPT_KEY_NOT_EXIST ((size_t)-1)
 
+/*
+ * Defining LEPT_COMPACT selects a 16-byte lept_value (32 on 64-bit targets otherwise): one word of payload
+ * and a 32-bit size, with the capacity of an array or object kept in front of its elements. Strings, arrays
+ * and objects are then limited to 2^32 - 1 bytes or elements: parsing a larger one fails with
+ * LEPT_PARSE_SIZE_TOO_BIG, and building one is a failed assertion. The API is the same for both layouts.
+ */
+#ifndef LEPT_KEY_INLINE_SIZE
+#ifdef LEPT_COMPACT
+#define LEPT_KEY_INLINE_SIZE 8
+#else
+#define LEPT_KEY_INLINE_SIZE 16     /* keys shorter than this are stored in the member */
+#endif
+#endif
+
 typedef struct lept_value lept_value;
 typedef struct lept_member lept_member;
 
+#ifdef LEPT_COMPACT
+struct lept_value {
+    union {
+        struct { lept_member *m; } o;   /* object: members */
+        struct { lept_value *e; } a;    /* array: elements */
+        struct { char *s; } s;          /* string: null-terminated string */
+        char b[sizeof(double)];         /* string: a short one in place, see lept_get_string() */
+        double n;                       /* value for a JSON number */
+    }u;
+    unsigned size;          /* string length, array or object size */
+    unsigned char type;     /* type for a JSON value, a lept_type */
+    unsigned char flags;    /* storage flags, e.g. payload borrowed from an arena */
+};
+#else
 struct lept_value {
     union {
         struct { lept_member *m; size_t size, capacity; } o;  /* object: members, member count */
         struct { lept_value *e; size_t size, capacity; } a;   /* array: elements, elements count */
         struct { char *s; size_t len; } s;          /* string: null-terminated string, string length */
+        char b[3 * sizeof(size_t)];                 /* string: a short one in place, see lept_get_string() */
         double n;                                   /* value for a JSON number */
     }u;
     lept_type type;     /* type for a JSON value */
+    unsigned char flags;    /* storage flags, e.g. payload borrowed from an arena */
 };
+#endif
 
 struct lept_member {
-    char *k;                /* member key string */
+    union {
+        char *p;
+        char s[LEPT_KEY_INLINE_SIZE];
+    } k;                    /* member key string, in s if it is shorter than LEPT_KEY_INLINE_SIZE */
     size_t klen;            /* member key string length */
     lept_value v;           /* member value */
 };
@@ -44,13 +79,199 @@ enum {
     LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     LEPT_PARSE_MISS_KEY,
     LEPT_PARSE_MISS_COLON,
-    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    LEPT_PARSE_CANCELED,
+    LEPT_PARSE_DEPTH_EXCEEDED,
+    LEPT_PARSE_SIZE_TOO_BIG
 };      /* Enumeration for parsing results */
 
+typedef struct lept_arena_block lept_arena_block;
+
+/* A region allocator: memory is bump-allocated from large blocks and only released all at once */
+typedef struct {
+    lept_arena_block *head;     /* most recently allocated block */
+    size_t block_size;          /* size of a regular block */
+} lept_arena;
+
+void lept_arena_init(lept_arena *a, size_t block_size);
+void* lept_arena_alloc(lept_arena *a, size_t size);
+void lept_arena_reset(lept_arena *a);
+void lept_arena_free(lept_arena *a);
+
+/*
+ * A table of interned member keys, shared by any number of documents and threads: each distinct key is
+ * stored once and lookups with an interned key compare pointers. Keys are only released with the table.
+ */
+typedef struct lept_symtab lept_symtab;
+
+lept_symtab* lept_symtab_new(void);
+void lept_symtab_free(lept_symtab *st);
+/* Returns the interned, null-terminated copy of key */
+const char* lept_symtab_intern(lept_symtab *st, const char *key, size_t klen);
+size_t lept_symtab_size(lept_symtab *st);
+
+/* Vector instruction sets used by the parser, LEPT_SIMD_AUTO picks the best one the CPU supports */
+typedef enum { LEPT_SIMD_AUTO, LEPT_SIMD_SCALAR, LEPT_SIMD_SSE2, LEPT_SIMD_AVX2, LEPT_SIMD_NEON } lept_simd;
+
+/*
+ * Returns 0 if simd is not available in this build or on this CPU. The default is picked once, safely from
+ * any thread. A choice must be made before other threads parse or write, as it is not synchronized.
+ */
+int lept_set_simd(lept_simd simd);
+lept_simd lept_get_simd(void);
+
+/* Flags of lept_parse_options, lazy, projected and parallel parses do not use the structural index */
+#define LEPT_PARSE_STRUCTURAL_INDEX 0x01    /* two stages: a SIMD structural index of the text, then a walk of it */
+#define LEPT_PARSE_LAZY             0x02    /* arrays and objects are parsed on first access, see lept_expand() */
+
+/* The default maximum nesting of arrays and objects, a deeper text fails with LEPT_PARSE_DEPTH_EXCEEDED */
+#ifndef LEPT_PARSE_MAX_DEPTH
+#define LEPT_PARSE_MAX_DEPTH 1024
+#endif
+
+typedef struct {
+    unsigned flags;
+    size_t max_depth;       /* maximum nesting of arrays and objects, 0 for lept_get_parse_max_depth() */
+} lept_parse_options;
+
+/* The flags used by the parse functions without options, 0 by default */
+void lept_set_parse_flags(unsigned flags);
+unsigned lept_get_parse_flags(void);
+
+/* The maximum depth used by the parse functions without options, LEPT_PARSE_MAX_DEPTH by default */
+void lept_set_parse_max_depth(size_t depth);
+size_t lept_get_parse_max_depth(void);
+
 /* This function parsing a JSON text into a JSON value */
 int lept_parse(lept_value *v, const char *json);
+/* Parses exactly len bytes of json, which need not be null-terminated */
+int lept_parse_n(lept_value *v, const char *json, size_t len);
+/* Destructive parsing: strings are unescaped within json and the values point into it */
+int lept_parse_insitu(lept_value *v, char *json, size_t len);
+/* Same as lept_parse(), but all strings, arrays and members are allocated from the arena */
+int lept_parse_arena(lept_value *v, const char *json, lept_arena *arena);
+/* Same as lept_parse_n(), but member keys are interned into st, which must outlive v */
+int lept_parse_symtab(lept_value *v, const char *json, size_t len, lept_symtab *st);
+/* Parses exactly len bytes of json with options, which may be NULL for the defaults */
+int lept_parse_ex(lept_value *v, const char *json, size_t len, const lept_parse_options *options);
 char* lept_stringify(const lept_value *v, size_t *length);
 
+/*
+ * Binary encodings of a tree, MessagePack and CBOR (RFC 8949), returned in a buffer from malloc().
+ * Integral numbers are written as integers, other numbers as 64-bit floats. Decoding takes every width
+ * of integers and floats, CBOR indefinite lengths and ignores CBOR tags. Byte strings, extension types
+ * and non-finite numbers are rejected, as well as non-string keys with LEPT_PARSE_MISS_KEY. A truncated
+ * input is LEPT_PARSE_INVALID_VALUE, trailing bytes are LEPT_PARSE_ROOT_NOT_SINGULAR. The last of
+ * duplicate keys wins. lept_encode_msgpack() returns NULL if a string, array or object has 2^32 or more
+ * bytes or elements, which MessagePack cannot express.
+ */
+char* lept_encode_msgpack(const lept_value *v, size_t *length);
+char* lept_encode_cbor(const lept_value *v, size_t *length);
+int lept_decode_msgpack(lept_value *v, const char *buf, size_t len);
+int lept_decode_cbor(lept_value *v, const char *buf, size_t len);
+
+#ifndef LEPT_WRITER_BUFFER_SIZE
+#define LEPT_WRITER_BUFFER_SIZE 4096
+#endif
+
+/* A sink of the writer, returns 0 on failure */
+typedef int (*lept_write_func)(void *ctx, const char *buf, size_t len);
+
+/* Writes JSON to a sink in chunks of at most LEPT_WRITER_BUFFER_SIZE bytes, its fields are private */
+typedef struct {
+    lept_write_func sink;
+    void *ctx;
+    FILE *fp;               /* the FILE of lept_writer_init_file() */
+    int fd;                 /* the file descriptor of lept_writer_init_fd() */
+    size_t len;             /* bytes in buf */
+    int comma;              /* a ',' is due before the next value or key */
+    int error;              /* the sink has failed, later output is dropped */
+    char buf[LEPT_WRITER_BUFFER_SIZE];
+} lept_writer;
+
+void lept_writer_init(lept_writer *w, lept_write_func sink, void *ctx);
+void lept_writer_init_file(lept_writer *w, FILE *fp);
+void lept_writer_init_fd(lept_writer *w, int fd);
+/* Must be called at the end, returns 0 if the sink has failed */
+int lept_writer_flush(lept_writer *w);
+void lept_writer_null(lept_writer *w);
+void lept_writer_boolean(lept_writer *w, int b);
+void lept_writer_number(lept_writer *w, double n);
+void lept_writer_string(lept_writer *w, const char *s, size_t len);
+void lept_writer_key(lept_writer *w, const char *s, size_t len);
+void lept_writer_begin_array(lept_writer *w);
+void lept_writer_end_array(lept_writer *w);
+void lept_writer_begin_object(lept_writer *w);
+void lept_writer_end_object(lept_writer *w);
+/* Writes a whole tree */
+void lept_writer_value(lept_writer *w, const lept_value *v);
+
+/*
+ * Callbacks of the event based parser, any of them may be NULL. Each returns non-zero to continue,
+ * or 0 to stop parsing with LEPT_PARSE_CANCELED. Strings and keys are not null-terminated and are
+ * only valid during the call.
+ */
+typedef struct {
+    int (*null)(void *ctx);
+    int (*boolean)(void *ctx, int b);
+    int (*number)(void *ctx, double n);
+    int (*string)(void *ctx, const char *s, size_t len);
+    int (*start_array)(void *ctx);
+    int (*end_array)(void *ctx, size_t count);      /* count of elements */
+    int (*start_object)(void *ctx);
+    int (*key)(void *ctx, const char *s, size_t len);
+    int (*end_object)(void *ctx, size_t count);     /* count of members */
+} lept_handler;
+
+/* Parses len bytes of json and reports its values to handler instead of building a tree */
+int lept_parse_sax(const char *json, size_t len, const lept_handler *handler, void *ctx);
+
+/* An incremental parser, fed with a JSON text in chunks of any size, its fields are private */
+typedef struct {
+    char *stack;            /* open containers and their children, then a token split by a chunk boundary */
+    size_t size, top;
+    size_t frame;           /* offset of the innermost open container */
+    size_t depth, max_depth;    /* open containers and their limit */
+    size_t token;           /* offset of the buffered token */
+    int state;
+    int error;              /* the first error, or LEPT_PARSE_OK */
+    int escape;             /* the buffered string ends with an unescaped backslash */
+    lept_value root;
+} lept_stream_parser;
+
+void lept_stream_init(lept_stream_parser *s);
+int lept_stream_feed(lept_stream_parser *s, const char *buf, size_t len);
+int lept_stream_finish(lept_stream_parser *s, lept_value *v);
+void lept_stream_free(lept_stream_parser *s);
+
+/*
+ * Newline-delimited JSON, parsed by threads worker threads, or one per processor if threads <= 0.
+ * Without thread support (LEPT_NO_THREADS, Windows) the records are parsed in the calling thread.
+ */
+int lept_parse_ndjson(lept_value *v, const char *json, size_t len, int threads);
+/*
+ * Called concurrently with the byte offset of a record, its parse result and its value, which is
+ * freed after the call unless it is moved out. Returning 0 stops parsing with LEPT_PARSE_CANCELED.
+ */
+typedef int (*lept_ndjson_func)(void *ctx, size_t offset, int ret, lept_value *v);
+int lept_parse_ndjson_each(const char *json, size_t len, int threads, lept_ndjson_func func, void *ctx);
+
+/*
+ * Parses a text with huge arrays at the given depth, 1 being the root value: their elements are parsed
+ * concurrently by threads worker threads, or one per processor if threads <= 0. The tree is allocated
+ * from arena if it is not NULL. Errors are the same as those of lept_parse_n().
+ */
+int lept_parse_parallel(lept_value *v, const char *json, size_t len, int threads, int depth, lept_arena *arena);
+
+/*
+ * With LEPT_PARSE_LAZY, arrays and objects only record their span of the text, which must outlive the
+ * tree. Their contents are not validated until accessed; the array and object functions expand them one
+ * level at a time, which is not thread-safe even for const values. This function expands v explicitly:
+ * it returns the parse error of an invalid array or object, which then becomes empty. Arena, in situ and
+ * event based parsing ignore the flag.
+ */
+int lept_expand(lept_value *v);
+
 void lept_copy(lept_value *dst, const lept_value *src);
 void lept_move(lept_value *dst, lept_value *src);
 void lept_swap(lept_value *lhs, lept_value *rhs);
@@ -96,6 +317,70 @@ lept_value* lept_get_object_value(const lept_value *v, size_t index);
 size_t lept_find_object_index(const lept_value *v, const char *key, size_t klen);
 lept_value *lept_find_object_value(lept_value *v, const char *key, size_t klen);
 lept_value *lept_set_object_value(lept_value *v, const char *key, size_t klen);
+/* Interns key and the keys of v into st, lept_set_object_value() on v copies them back to the heap */
+lept_value *lept_set_object_value_interned(lept_value *v, const char *key, size_t klen, lept_symtab *st);
 void lept_remove_object_value(lept_value *v, size_t index);
 
+/* A JSON pointer (RFC 6901) compiled for repeated lookups */
+typedef struct lept_pointer lept_pointer;
+
+/* Returns NULL if pointer is neither empty nor starts with '/', or has a '~' not followed by '0' or '1' */
+lept_pointer* lept_pointer_compile(const char *pointer);
+void lept_pointer_free(lept_pointer *ptr);
+/* Returns NULL if the value does not exist */
+lept_value* lept_pointer_get(const lept_value *v, const lept_pointer *ptr);
+/*
+ * Returns the value at ptr freed, like lept_set_object_value(). Missing members are added, a null on the
+ * way becomes an object and "-" or the size of an array appends to it. Returns NULL if the path runs
+ * into a number, string, boolean, or an array with a token that is not an index within its size.
+ */
+lept_value* lept_pointer_set(lept_value *v, const lept_pointer *ptr);
+
+/*
+ * Parses only the values at the given JSON pointers, with their members and elements on the way: other
+ * members are left out, other elements are nulls or left out past the last selected index. Values which
+ * are not selected are skipped without being validated.
+ */
+int lept_parse_projected(lept_value *v, const char *json, const char *const *paths, size_t npaths);
+
+/*
+ * A read-only document in a single block, laid out in document order on a tape of words with the strings
+ * after it. Its values are referred to by their offsets on the tape, the root being at 0. Elements and
+ * members are found by skipping over their predecessors: iterate with lept_frozen_next() from the offset
+ * of the first one rather than by index. lept_parse_frozen() sets *d to NULL on error.
+ */
+typedef struct lept_frozen lept_frozen;
+
+int lept_parse_frozen(lept_frozen **d, const char *json, size_t len);
+void lept_frozen_free(lept_frozen *d);
+lept_type lept_frozen_get_type(const lept_frozen *d, size_t v);
+/* The offset of the value after v and its contents, i.e. its next sibling if it has one */
+size_t lept_frozen_next(const lept_frozen *d, size_t v);
+int lept_frozen_get_boolean(const lept_frozen *d, size_t v);
+double lept_frozen_get_number(const lept_frozen *d, size_t v);
+const char* lept_frozen_get_string(const lept_frozen *d, size_t v);
+size_t lept_frozen_get_string_length(const lept_frozen *d, size_t v);
+size_t lept_frozen_get_array_size(const lept_frozen *d, size_t v);
+size_t lept_frozen_get_array_element(const lept_frozen *d, size_t v, size_t index);
+size_t lept_frozen_get_object_size(const lept_frozen *d, size_t v);
+const char* lept_frozen_get_object_key(const lept_frozen *d, size_t v, size_t index);
+size_t lept_frozen_get_object_key_length(const lept_frozen *d, size_t v, size_t index);
+size_t lept_frozen_get_object_value(const lept_frozen *d, size_t v, size_t index);
+/* Returns LEPT_KEY_NOT_EXIST if there is no such member */
+size_t lept_frozen_find_object_value(const lept_frozen *d, size_t v, const char *key, size_t klen);
+
+/*
+ * A snapshot is a file holding a frozen document of a tree, which is mapped into memory as it is when
+ * opened: loading it costs no parsing nor allocation. It only opens on platforms with the same word size
+ * and byte order. lept_save_snapshot() returns 0 on failure, lept_open_snapshot() returns NULL if the
+ * file cannot be read or is not a snapshot. A snapshot is closed with lept_close_snapshot(), not
+ * lept_frozen_free(). Opening checks the header, the word size, the byte order and the size of the file,
+ * then walks the tape once: the skip offsets and child counts of arrays and objects must be consistent,
+ * member keys must be strings, and strings must lie within the string pool and end in a null character.
+ * A corrupted file makes lept_open_snapshot() return NULL.
+ */
+int lept_save_snapshot(const lept_value *v, const char *path);
+lept_frozen* lept_open_snapshot(const char *path);
+void lept_close_snapshot(lept_frozen *d);
+
 #endif /* LEPTJSON_H__ */
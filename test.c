@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "leptjson.h"
 
 static int main_ret = 0;
@@ -106,9 +107,79 @@ static void test_parse_number() {
     TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TEST_NUMBER(1.7976931348623157E308, "1.7976931348623157E308");      /* max double */
     TEST_NUMBER(-1.7976931348623157e308, "-1.7976931348623157e308");
+
+    TEST_NUMBER(9007199254740992.0, "9007199254740993");    /* halfway, round to even */
+    TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000000000000001");
+    TEST_NUMBER(0.1, "0.1000000000000000055511151231257827021181583404541015625");
+    TEST_NUMBER(1.0, "0.99999999999999999999999999");
+    TEST_NUMBER(-123456789012345678901234567890.0, "-123456789012345678901234567890");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(0.0, "0.000000000000000000000000000000000000000000e1000");
     return;
 }
 
+static unsigned long test_random_state = 1;
+
+static unsigned test_random() {
+    test_random_state = (test_random_state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (unsigned)(test_random_state >> 16);
+}
+
+/* Numbers must convert bit-identically to strtod(), and printed doubles must round-trip */
+static void test_parse_number_random() {
+    char json[64];
+    double d, expect;
+    unsigned char bits[sizeof(double)];
+    size_t i, j, len;
+    lept_value v;
+
+    lept_init(&v);
+    for (i = 0; i < 100000; i++) {
+        for (j = 0; j < sizeof(double); j++)
+            bits[j] = (unsigned char)test_random();
+        memcpy(&d, bits, sizeof(double));
+        if (d - d != 0.0)   /* infinity or NaN */
+            continue;
+        sprintf(json, "%.17g", d);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_TRUE(memcmp(&d, &v.u.n, sizeof(double)) == 0);
+        lept_free(&v);
+    }
+
+    for (i = 0; i < 100000; i++) {
+        size_t digits = 1 + test_random() % 25, point = test_random() % (digits + 1);
+        len = 0;
+        if (test_random() % 2)
+            json[len++] = '-';
+        for (j = 0; j < digits; j++) {
+            if (j == point && j > 0)
+                json[len++] = '.';
+            json[len++] = (char)('0' + test_random() % 10);
+            if (j == 0 && digits > 1 && point != 1 && json[len - 1] == '0')
+                json[len - 1] = '1';    /* no leading zeros */
+        }
+        len += sprintf(json + len, "e%d", (int)(test_random() % 700) - 350);
+        expect = strtod(json, NULL);
+        if (expect == HUGE_VAL || expect == -HUGE_VAL)
+            EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse(&v, json));
+        else {
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+            EXPECT_TRUE(memcmp(&expect, &v.u.n, sizeof(double)) == 0);
+        }
+        lept_free(&v);
+    }
+}
+
+#define TEST_ERROR_N(error, json, len)\
+    do {\
+        lept_value v;\
+        lept_init(&v);\
+        lept_set_boolean(&v, 0);\
+        EXPECT_EQ_INT(error, lept_parse_n(&v, json, len));\
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));\
+        lept_free(&v);\
+    } while(0)
+
 #define TEST_STRING(expect, json)\
     do {\
         lept_value v;\
@@ -131,9 +202,49 @@ static void test_parse_string() {
     TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\"");
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");
+    TEST_STRING("\xC2\xA2 \xE2\x82\xAC", "\"\xC2\xA2 \xE2\x82\xAC\"");    /* unescaped UTF-8 */
     return;
 }
 
+static void test_parse_long_string() {
+    char json[80], expect[80];
+    int simd;
+    size_t n, i;
+    lept_value v;
+
+    for (simd = LEPT_SIMD_SCALAR; simd <= LEPT_SIMD_NEON; simd++) {
+        if (!lept_set_simd((lept_simd)simd))
+            continue;
+        for (n = 0; n < 70; n++) {
+            /* an escape after a run of n characters, then another run up to 70 */
+            json[0] = '"';
+            for (i = 0; i < 70; i++)
+                expect[i] = json[i + 1] = (char)('a' + i % 26);
+            memcpy(json + n + 1, "\\n", 2);
+            memmove(json + n + 3, expect + n + 1, 69 - n);
+            expect[n] = '\n';
+            json[72] = '"';
+            lept_init(&v);
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json, 73));
+            EXPECT_EQ_SIZE_T(70, lept_get_string_length(&v));
+            EXPECT_TRUE(memcmp(expect, lept_get_string(&v), 70) == 0);
+            lept_free(&v);
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_insitu(&v, json, 73));
+            EXPECT_EQ_SIZE_T(70, lept_get_string_length(&v));
+            EXPECT_TRUE(memcmp(expect, lept_get_string(&v), 70) == 0);
+            lept_free(&v);
+
+            /* a control character or the end after a run of n characters */
+            for (i = 0; i < 70; i++)
+                json[i + 1] = (char)('a' + i % 26);
+            json[n + 1] = '\x1F';
+            TEST_ERROR_N(LEPT_PARSE_INVALID_STRING_CHAR, json, 73);
+            TEST_ERROR_N(LEPT_PARSE_MISS_QUOTATION_MARK, json, n + 1);
+        }
+    }
+    lept_set_simd(LEPT_SIMD_AUTO);
+}
+
 static void test_parse_array() {
     lept_value v;
 
@@ -347,6 +458,70 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_ERROR(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+/* depth arrays nested in each other, or objects with the key "a" if object is not 0 */
+static char* test_nested(size_t depth, int object) {
+    char *json = (char *)malloc(depth * 6 + 1), *p = json;
+    size_t i;
+    for (i = 0; i < depth; i++) {
+        if (object && i + 1 < depth) {
+            memcpy(p, "{\"a\":", 5);
+            p += 5;
+        }
+        else
+            *p++ = object ? '{' : '[';
+    }
+    for (i = 0; i < depth; i++)
+        *p++ = object ? '}' : ']';
+    *p = '\0';
+    return json;
+}
+
+static void test_parse_depth_exceeded() {
+    static const lept_handler empty = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    lept_parse_options options;
+    lept_value v;
+    char *json;
+    int object;
+
+    for (object = 0; object <= 1; object++) {
+        json = test_nested(LEPT_PARSE_MAX_DEPTH, object);
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        lept_free(&v);
+        free(json);
+        json = test_nested(LEPT_PARSE_MAX_DEPTH + 1, object);
+        TEST_ERROR(LEPT_PARSE_DEPTH_EXCEEDED, json);
+        EXPECT_EQ_INT(LEPT_PARSE_DEPTH_EXCEEDED, lept_parse_sax(json, strlen(json), &empty, NULL));
+        free(json);
+    }
+
+    /* a hostile text fails at the limit instead of exhausting the C stack */
+    json = (char *)malloc(1000001);
+    memset(json, '[', 1000000);
+    json[1000000] = '\0';
+    TEST_ERROR(LEPT_PARSE_DEPTH_EXCEEDED, json);
+    free(json);
+
+    /* nothing is parsed recursively, a limit far beyond the C stack works */
+    lept_set_parse_max_depth(1000000);
+    EXPECT_EQ_SIZE_T(1000000, lept_get_parse_max_depth());
+    json = test_nested(1000000, 0);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_sax(json, 2000000, &empty, NULL));
+    free(json);
+    lept_set_parse_max_depth(LEPT_PARSE_MAX_DEPTH);
+
+    options.flags = 0;
+    options.max_depth = 2;
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, "[{\"a\":1},[]]", 12, &options));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_DEPTH_EXCEEDED, lept_parse_ex(&v, "[{\"a\":[]}]", 10, &options));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_DEPTH_EXCEEDED, lept_parse_ex(&v, "{\"a\":{\"b\":{}}}", 14, &options));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    lept_free(&v);
+}
+
 #define TEST_ROUNDTRIP(json)\
     do {\
         lept_value v;\
@@ -373,14 +548,49 @@ static void test_stringify_number() {
     TEST_ROUNDTRIP("1.234e-20");
 
     TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
-    TEST_ROUNDTRIP("4.9406564584124654e-324"); /* minimum denormal */
-    TEST_ROUNDTRIP("-4.9406564584124654e-324");
-    TEST_ROUNDTRIP("2.2250738585072009e-308");  /* Max subnormal double */
-    TEST_ROUNDTRIP("-2.2250738585072009e-308");
+    TEST_ROUNDTRIP("5e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("-5e-324");
+    TEST_ROUNDTRIP("2.225073858507201e-308");  /* Max subnormal double */
+    TEST_ROUNDTRIP("-2.225073858507201e-308");
     TEST_ROUNDTRIP("2.2250738585072014e-308");  /* Min normal positive double */
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
     TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("0.0001");
+    TEST_ROUNDTRIP("1e-05");
+    TEST_ROUNDTRIP("10000000000000000");
+    TEST_ROUNDTRIP("1.2345678901234568e+17");
+    TEST_ROUNDTRIP("9007199254740992");
+}
+
+/* Shortest output must parse back to the same double and never be longer than "%.17g" */
+static void test_stringify_number_random() {
+    char buf[64];
+    double d;
+    unsigned char bits[sizeof(double)];
+    char* json;
+    size_t i, j, length;
+    lept_value v, v2;
+
+    lept_init(&v);
+    lept_init(&v2);
+    for (i = 0; i < 100000; i++) {
+        for (j = 0; j < sizeof(double); j++)
+            bits[j] = (unsigned char)test_random();
+        memcpy(&d, bits, sizeof(double));
+        if (d - d != 0.0)   /* infinity or NaN */
+            continue;
+        lept_set_number(&v, d);
+        json = lept_stringify(&v, &length);
+        EXPECT_TRUE(length <= (size_t)sprintf(buf, "%.17g", d));
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, json));
+        EXPECT_TRUE(memcmp(&d, &v2.u.n, sizeof(double)) == 0);
+        lept_free(&v2);
+        free(json);
+    }
+    lept_free(&v);
 }
 
 static void test_stringify_string() {
@@ -389,6 +599,7 @@ static void test_stringify_string() {
     TEST_ROUNDTRIP("\"Hello\\nWorld\"");
     TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
     TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+    TEST_ROUNDTRIP("\"\\u001f \xC3\xA9 \xF0\x9D\x84\x9E\"");
 }
 
 static void test_stringify_array() {
@@ -401,14 +612,52 @@ static void test_stringify_object() {
     TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+/* Writers do not recurse either, any tree that can be built can be written */
+static void test_stringify_deep() {
+    lept_value v, v2, *e;
+    lept_parse_options options;
+    char *json;
+    size_t i, length;
+    lept_init(&v);
+    lept_init(&v2);
+    for (i = 0, e = &v; i < 500000; i++) {
+        lept_set_array(e, 1);
+        e = lept_pushback_array_element(e);
+        lept_set_object(e, 1);
+        e = lept_set_object_value(e, "k", 1);
+    }
+    lept_set_number(e, 1.0);
+    json = lept_stringify(&v, &length);
+    EXPECT_EQ_SIZE_T(4000001, length);
+    EXPECT_EQ_STRING("[{\"k\":[{\"k\":", json, 12);
+    EXPECT_EQ_STRING("1}]}]", json + 3000000, 5);
+    options.flags = 0;
+    options.max_depth = 1000000;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v2, json, length, &options));
+    EXPECT_TRUE(lept_is_equal(&v, &v2));
+    free(json);
+    json = lept_encode_msgpack(&v, &length);
+    EXPECT_EQ_SIZE_T(2000001, length);
+    EXPECT_EQ_STRING("\x91\x81\xa1k\x91", json, 5);
+    free(json);
+    json = lept_encode_cbor(&v, &length);
+    EXPECT_EQ_SIZE_T(2000001, length);
+    EXPECT_EQ_STRING("\x81\xa1" "ak\x81", json, 5);
+    free(json);
+    lept_free(&v);
+    lept_free(&v2);
+}
+
 static void test_stringify() {
     TEST_ROUNDTRIP("null");
     TEST_ROUNDTRIP("false");
     TEST_ROUNDTRIP("true");
     test_stringify_number();
+    test_stringify_number_random();
     test_stringify_string();
     test_stringify_array();
     test_stringify_object();
+    test_stringify_deep();
     return;
 }
 
@@ -446,8 +695,12 @@ static void test_equal() {
     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
     TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"c\":2}", 0);
     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+    TEST_EQUAL("[[1,[2]],{\"a\":[3],\"b\":4},5]", "[[1,[2]],{\"b\":4,\"a\":[3]},5]", 1);
+    TEST_EQUAL("[[1,[2]],{\"a\":[3],\"b\":4},5]", "[[1,[2]],{\"a\":[3],\"b\":4},6]", 0);
+    TEST_EQUAL("[[1,[2]],{\"a\":[3],\"b\":4},5]", "[[1,[2]],{\"a\":[3],\"c\":4},5]", 0);
 }
 
 static void test_copy() {
@@ -461,6 +714,32 @@ static void test_copy() {
     lept_free(&v2);
 }
 
+/* Copying, comparing and freeing do not recurse, a nesting far beyond the C stack works */
+static void test_copy_deep() {
+    lept_value v1, v2, *e;
+    size_t i;
+    lept_init(&v1);
+    lept_init(&v2);
+    lept_set_array(&v1, 0);
+    for (i = 0, e = &v1; i < 1000000; i++) {
+        lept_set_string(lept_pushback_array_element(e), "a string which is not inline", 28);
+        e = lept_pushback_array_element(e);
+        if (i % 2 == 0) {
+            lept_set_object(e, 0);
+            e = lept_set_object_value(e, "a key which is not inline", 25);
+        }
+        lept_set_array(e, 0);
+    }
+    lept_set_number(lept_pushback_array_element(e), 1.0);
+    lept_copy(&v2, &v1);
+    EXPECT_TRUE(lept_is_equal(&v2, &v1));
+    lept_set_number(lept_get_array_element(e, 0), 2.0);
+    EXPECT_FALSE(lept_is_equal(&v2, &v1));
+    lept_free(&v1);
+    lept_free(&v2);
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v2));
+}
+
 static void test_move() {
     lept_value v1, v2, v3;
     lept_init(&v1);
@@ -489,6 +768,547 @@ static void test_swap() {
     lept_free(&v2);
 }
 
+static void test_parse_whitespace() {
+    static const char ws[] = " \t\n\r";
+    char json[6 * 80 + 16];
+    int simd;
+    size_t n, i, len;
+    lept_value v;
+
+    for (simd = LEPT_SIMD_SCALAR; simd <= LEPT_SIMD_NEON; simd++) {
+        if (!lept_set_simd((lept_simd)simd))
+            continue;
+        EXPECT_EQ_INT(simd, lept_get_simd());
+        for (n = 0; n < 80; n++) {
+            /* n whitespaces around every token, " [ 1 , \"a\" ] " */
+            const char *tokens[] = { "[", "1", ",", "\"a\"", "]", "" };
+            len = 0;
+            for (i = 0; i < 6; i++) {
+                size_t j;
+                for (j = 0; j < n; j++)
+                    json[len++] = ws[(i + j) % 4];
+                memcpy(json + len, tokens[i], strlen(tokens[i]));
+                len += strlen(tokens[i]);
+            }
+            json[len] = 'x';
+            lept_init(&v);
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json, len));
+            EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(&v));
+            EXPECT_EQ_SIZE_T(2, lept_get_array_size(&v));
+            lept_free(&v);
+            /* the scan must stop at the end, and at the first non-whitespace */
+            TEST_ERROR_N(LEPT_PARSE_ROOT_NOT_SINGULAR, json, len + 1);
+            TEST_ERROR_N(LEPT_PARSE_EXPECT_VALUE, json + len - n, n);
+        }
+    }
+    EXPECT_TRUE(lept_set_simd(LEPT_SIMD_AUTO));
+    EXPECT_TRUE(lept_get_simd() != LEPT_SIMD_AUTO);
+}
+
+static void test_parse_structural_index() {
+    /* pieces which split escapes, strings and numbers at every offset of the 64-byte blocks */
+    static const char *pieces[] = {
+        "\"\\\\\"", "\"\\\"\"", "\"a [1, 2] {\\\"b\\\": 3}\"", "\"\\\\\\\"\\\\\"", "\"  \"",
+        "-12.5e3", "0", "true", "false", "null", "[]", "{}", "[ 1 ,2 ]", "{\"k\" : [null]}"
+    };
+    lept_parse_options options;
+    char json[4096];
+    int simd;
+    size_t len, i, n;
+    unsigned seed = 1;
+    lept_value expect, v;
+
+    options.flags = LEPT_PARSE_STRUCTURAL_INDEX;
+    options.max_depth = 0;
+    for (simd = LEPT_SIMD_SCALAR; simd <= LEPT_SIMD_NEON; simd++) {
+        if (!lept_set_simd((lept_simd)simd))
+            continue;
+        for (n = 0; n < 200; n++) {
+            /* an array of pieces separated by runs of whitespace */
+            len = 0;
+            json[len++] = '[';
+            for (i = 0; i < 40; i++) {
+                size_t j, ws;
+                const char *piece = pieces[(seed >> 16) % (sizeof(pieces) / sizeof(pieces[0]))];
+                seed = seed * 1103515245 + 12345;
+                ws = (seed >> 16) % 9;
+                seed = seed * 1103515245 + 12345;
+                for (j = 0; j < ws; j++)
+                    json[len++] = " \t\n\r"[j % 4];
+                if (i > 0)
+                    json[len++] = ',';
+                for (j = 0; j < ws; j++)
+                    json[len++] = ' ';
+                memcpy(json + len, piece, strlen(piece));
+                len += strlen(piece);
+            }
+            json[len++] = ']';
+            for (i = 0; i < n % 70; i++)
+                json[len++] = ' ';
+            lept_init(&expect);
+            lept_init(&v);
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&expect, json, len));
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, json, len, &options));
+            EXPECT_TRUE(lept_is_equal(&expect, &v));
+            lept_free(&v);
+            /* unterminated, the index must not run past the end */
+            EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_ex(&v, json, len - n % 70 - 1, &options));
+            lept_free(&expect);
+        }
+    }
+    EXPECT_TRUE(lept_set_simd(LEPT_SIMD_AUTO));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, " [ 1 ] ", 7, NULL));
+    lept_free(&v);
+}
+
+static void test_parse_n() {
+    lept_value v;
+
+    /* a slice of a larger buffer */
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, "[1,2,3]garbage", 7));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, "12345", 2));
+    EXPECT_EQ_DOUBLE(12.0, lept_get_number(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, "1.5e3e", 5));
+    EXPECT_EQ_DOUBLE(1500.0, lept_get_number(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, "\"abc\"def\"", 5));
+    EXPECT_EQ_STRING("abc", lept_get_string(&v), lept_get_string_length(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, "\"a\\u0000b\"", 10));
+    EXPECT_EQ_STRING("a\0b", lept_get_string(&v), lept_get_string_length(&v));
+    lept_free(&v);
+
+    /* truncated texts */
+    TEST_ERROR_N(LEPT_PARSE_EXPECT_VALUE, "null", 0);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_VALUE, "true", 3);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_VALUE, "1e5", 2);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_VALUE, "-1", 1);
+    TEST_ERROR_N(LEPT_PARSE_MISS_QUOTATION_MARK, "\"abc\"", 4);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\n\"", 2);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u0041\"", 6);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD834\\uDD1E\"", 8);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\uD834\\uDD1E\"", 12);
+    TEST_ERROR_N(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1,2]", 4);
+    TEST_ERROR_N(LEPT_PARSE_EXPECT_VALUE, "[1,2]", 3);
+    TEST_ERROR_N(LEPT_PARSE_MISS_COLON, "{\"a\":1}", 4);
+    TEST_ERROR_N(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1}", 6);
+
+    /* embedded null characters */
+    TEST_ERROR_N(LEPT_PARSE_INVALID_VALUE, "\0", 1);
+    TEST_ERROR_N(LEPT_PARSE_ROOT_NOT_SINGULAR, "null\0", 5);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_STRING_CHAR, "\"a\0b\"", 5);
+    TEST_ERROR_N(LEPT_PARSE_INVALID_VALUE, "[1,\0]", 5);
+    TEST_ERROR_N(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1\0]", 4);
+    TEST_ERROR_N(LEPT_PARSE_MISS_KEY, "{\0\"a\":1}", 8);
+}
+
+static void test_parse_insitu() {
+    char json[] = "{\"k\":\"Hello\\nWorld\",\"a\":[\"\\u20AC\\uD834\\uDD1E\",\"\",\"x\"],\"n\":1}";
+    char bad[] = "[\"abc\" \"def\"]";
+    lept_value v, *pv;
+    const char *s;
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_insitu(&v, json, sizeof(json) - 1));
+    EXPECT_EQ_SIZE_T(3, lept_get_object_size(&v));
+    EXPECT_EQ_STRING("k", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    pv = lept_get_object_value(&v, 0);
+    s = lept_get_string(pv);
+    EXPECT_EQ_STRING("Hello\nWorld", s, lept_get_string_length(pv));
+    EXPECT_TRUE(s >= json && s < json + sizeof(json));      /* zero-copy */
+    EXPECT_TRUE(s[lept_get_string_length(pv)] == '\0');
+    pv = lept_find_object_value(&v, "a", 1);
+    EXPECT_EQ_STRING("\xE2\x82\xAC\xF0\x9D\x84\x9E", lept_get_string(lept_get_array_element(pv, 0)), lept_get_string_length(lept_get_array_element(pv, 0)));
+    EXPECT_EQ_STRING("", lept_get_string(lept_get_array_element(pv, 1)), lept_get_string_length(lept_get_array_element(pv, 1)));
+    EXPECT_EQ_STRING("x", lept_get_string(lept_get_array_element(pv, 2)), lept_get_string_length(lept_get_array_element(pv, 2)));
+
+    /* values may still be modified, borrowed strings and keys are never freed */
+    lept_set_string(lept_get_array_element(pv, 2), "y", 1);
+    lept_set_boolean(lept_set_object_value(&v, "t", 1), 1);
+    EXPECT_EQ_SIZE_T(4, lept_get_object_size(&v));
+    EXPECT_EQ_STRING("k", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    lept_remove_object_value(&v, 0);
+    EXPECT_EQ_SIZE_T(3, lept_get_object_size(&v));
+    lept_free(&v);
+
+    lept_set_boolean(&v, 0);
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_insitu(&v, bad, sizeof(bad) - 1));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+}
+
+static void test_parse_arena() {
+    const char *json = "{\"s\":\"abc\",\"a\":[1,2,[\"x\"]],\"o\":{\"k\":true}}";
+    lept_arena a;
+    lept_value v, v2, *pv;
+    size_t block_size;
+
+    for (block_size = 0; block_size <= 64; block_size += 64) {  /* default and tiny blocks */
+        lept_arena_init(&a, block_size);
+
+        lept_init(&v);
+        lept_init(&v2);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_arena(&v, json, &a));
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, json));
+        EXPECT_TRUE(lept_is_equal(&v, &v2));
+        pv = lept_find_object_value(&v, "s", 1);
+        EXPECT_EQ_STRING("abc", lept_get_string(pv), lept_get_string_length(pv));
+
+        /* mutations move the storage of arena-backed values to the heap */
+        pv = lept_find_object_value(&v, "a", 1);
+        lept_set_string(lept_pushback_array_element(pv), "Hello", 5);
+        EXPECT_EQ_SIZE_T(4, lept_get_array_size(pv));
+        EXPECT_EQ_DOUBLE(2.0, lept_get_number(lept_get_array_element(pv, 1)));
+        EXPECT_EQ_STRING("Hello", lept_get_string(lept_get_array_element(pv, 3)), lept_get_string_length(lept_get_array_element(pv, 3)));
+        lept_set_number(lept_set_object_value(&v, "n", 1), 1.5);
+        EXPECT_EQ_SIZE_T(4, lept_get_object_size(&v));
+        EXPECT_EQ_DOUBLE(1.5, lept_get_number(lept_find_object_value(&v, "n", 1)));
+        lept_remove_object_value(&v, lept_find_object_index(&v, "s", 1));
+        EXPECT_EQ_SIZE_T(3, lept_get_object_size(&v));
+        pv = lept_find_object_value(&v, "o", 1);
+        EXPECT_EQ_INT(LEPT_TRUE, lept_get_type(lept_find_object_value(pv, "k", 1)));
+        lept_free(&v);      /* releases the heap parts only */
+        lept_free(&v2);
+        lept_arena_reset(&a);
+
+        /* an unmodified document is released by the arena alone */
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_arena(&v, "[\"a very long string that does not fit in a tiny block\"]", &a));
+        pv = lept_get_array_element(&v, 0);
+        EXPECT_EQ_STRING("a very long string that does not fit in a tiny block", lept_get_string(pv), lept_get_string_length(pv));
+        lept_arena_reset(&a);
+
+        lept_init(&v);      /* v refers to released memory after the reset */
+        lept_set_boolean(&v, 0);
+        EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_arena(&v, "[1, \"a\", {\"b\":nul}]", &a));
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+        lept_arena_free(&a);
+    }
+}
+
+/* A sink collecting the chunks of a writer */
+typedef struct {
+    char buf[262144];
+    size_t len, chunks, max_chunk;
+} test_writer_sink;
+
+static int test_writer_write(void *ctx, const char *buf, size_t len) {
+    test_writer_sink *sink = (test_writer_sink *)ctx;
+    if (sink->len + len > sizeof(sink->buf))
+        return 0;
+    memcpy(sink->buf + sink->len, buf, len);
+    sink->len += len;
+    sink->chunks++;
+    if (len > sink->max_chunk)
+        sink->max_chunk = len;
+    return 1;
+}
+
+static void test_writer() {
+    static test_writer_sink sink;
+    lept_writer w;
+    lept_value v;
+    char *json, buf[64];
+    size_t i, length;
+    FILE *fp;
+
+    memset(&sink, 0, sizeof(sink));
+    lept_writer_init(&w, test_writer_write, &sink);
+    lept_writer_begin_object(&w);
+    lept_writer_key(&w, "a", 1);
+    lept_writer_begin_array(&w);
+    lept_writer_null(&w);
+    lept_writer_boolean(&w, 1);
+    lept_writer_number(&w, 0.1);
+    lept_writer_string(&w, "x\"y", 3);
+    lept_writer_begin_object(&w);
+    lept_writer_end_object(&w);
+    lept_writer_end_array(&w);
+    lept_writer_key(&w, "b", 1);
+    lept_writer_boolean(&w, 0);
+    lept_writer_end_object(&w);
+    EXPECT_EQ_SIZE_T(0, sink.len);     /* nothing is written before the buffer fills up */
+    EXPECT_TRUE(lept_writer_flush(&w));
+    EXPECT_EQ_STRING("{\"a\":[null,true,0.1,\"x\\\"y\",{}],\"b\":false}", sink.buf, sink.len);
+
+    /* output larger than the buffer is written in chunks and equals lept_stringify() */
+    memset(&sink, 0, sizeof(sink));
+    lept_init(&v);
+    lept_set_array(&v, 0);
+    for (i = 0; i < 2000; i++) {
+        sprintf(buf, "string %lu with\tescape", (unsigned long)i);
+        lept_set_string(lept_pushback_array_element(&v), buf, strlen(buf));
+        lept_set_number(lept_pushback_array_element(&v), i * 0.25);
+    }
+    lept_set_string(lept_pushback_array_element(&v), sink.buf, LEPT_WRITER_BUFFER_SIZE + 10);
+    lept_writer_init(&w, test_writer_write, &sink);
+    lept_writer_value(&w, &v);
+    EXPECT_TRUE(lept_writer_flush(&w));
+    json = lept_stringify(&v, &length);
+    EXPECT_EQ_SIZE_T(length, sink.len);
+    EXPECT_TRUE(memcmp(json, sink.buf, length) == 0);
+    EXPECT_TRUE(sink.chunks > 1);
+    EXPECT_TRUE(sink.max_chunk <= LEPT_WRITER_BUFFER_SIZE + 10);
+
+    /* FILE sink */
+    if ((fp = tmpfile()) != NULL) {
+        lept_writer_init_file(&w, fp);
+        lept_writer_value(&w, &v);
+        EXPECT_TRUE(lept_writer_flush(&w));
+        EXPECT_EQ_SIZE_T(length, (size_t)ftell(fp));
+        fclose(fp);
+    }
+    free(json);
+    lept_free(&v);
+
+    /* a failing sink is reported by the flush */
+    lept_writer_init_fd(&w, 1000);
+    lept_writer_null(&w);
+    EXPECT_FALSE(lept_writer_flush(&w));
+}
+
+/* Hex digits to bytes, returns the count */
+static size_t test_unhex(char *buf, const char *hex) {
+    size_t n = 0;
+    unsigned b;
+    for (; *hex != '\0'; hex += 2) {
+        sscanf(hex, "%2x", &b);
+        buf[n++] = (char)b;
+    }
+    return n;
+}
+
+typedef char* (*test_encode_func)(const lept_value *v, size_t *length);
+typedef int (*test_decode_func)(lept_value *v, const char *buf, size_t len);
+
+/* json encodes to hex, which decodes back to json */
+static void test_binary(test_encode_func encode, test_decode_func decode, const char *json, const char *hex) {
+    char expect[64], *actual;
+    size_t len = test_unhex(expect, hex), alen;
+    lept_value v, v2;
+    lept_init(&v);
+    lept_init(&v2);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+    actual = encode(&v, &alen);
+    EXPECT_EQ_SIZE_T(len, alen);
+    EXPECT_TRUE(alen == len && memcmp(expect, actual, len) == 0);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, decode(&v2, actual, alen));
+    EXPECT_TRUE(lept_is_equal(&v, &v2));
+    free(actual);
+    lept_free(&v);
+    lept_free(&v2);
+}
+
+/* hex decodes to json, or fails with error and leaves a null */
+static void test_binary_decode(test_decode_func decode, int error, const char *json, const char *hex) {
+    char buf[64];
+    size_t len = test_unhex(buf, hex);
+    lept_value v, v2;
+    lept_init(&v);
+    lept_init(&v2);
+    EXPECT_EQ_INT(error, decode(&v, buf, len));
+    if (error == LEPT_PARSE_OK) {
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, json));
+        EXPECT_TRUE(lept_is_equal(&v, &v2));
+    }
+    else
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    lept_free(&v);
+    lept_free(&v2);
+}
+
+#define TEST_MSGPACK(json, hex) test_binary(lept_encode_msgpack, lept_decode_msgpack, json, hex)
+#define TEST_MSGPACK_DECODE(error, json, hex) test_binary_decode(lept_decode_msgpack, error, json, hex)
+#define TEST_CBOR(json, hex) test_binary(lept_encode_cbor, lept_decode_cbor, json, hex)
+#define TEST_CBOR_DECODE(error, json, hex) test_binary_decode(lept_decode_cbor, error, json, hex)
+
+static void test_msgpack() {
+    TEST_MSGPACK("null", "c0");
+    TEST_MSGPACK("false", "c2");
+    TEST_MSGPACK("true", "c3");
+    TEST_MSGPACK("0", "00");
+    TEST_MSGPACK("127", "7f");
+    TEST_MSGPACK("128", "cc80");
+    TEST_MSGPACK("256", "cd0100");
+    TEST_MSGPACK("65536", "ce00010000");
+    TEST_MSGPACK("4294967296", "cf0000000100000000");
+    TEST_MSGPACK("-1", "ff");
+    TEST_MSGPACK("-32", "e0");
+    TEST_MSGPACK("-33", "d0df");
+    TEST_MSGPACK("-129", "d1ff7f");
+    TEST_MSGPACK("-32769", "d2ffff7fff");
+    TEST_MSGPACK("-2147483649", "d3ffffffff7fffffff");
+    TEST_MSGPACK("-9223372036854775808", "d38000000000000000");
+    TEST_MSGPACK("1.5", "cb3ff8000000000000");
+    TEST_MSGPACK("-0", "cb8000000000000000");
+    TEST_MSGPACK("18446744073709551616", "cb43f0000000000000");
+    TEST_MSGPACK("\"\"", "a0");
+    TEST_MSGPACK("\"IETF\"", "a449455446");
+    TEST_MSGPACK("\"0123456789012345678901234567890123\"", "d92230313233343536373839303132333435363738393031323334353637383930313233");
+    TEST_MSGPACK("[]", "90");
+    TEST_MSGPACK("[1,[2,3]]", "9201920203");
+    TEST_MSGPACK("[0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5]", "dc001000010203040506070809000102030405");
+    TEST_MSGPACK("{}", "80");
+    TEST_MSGPACK("{\"a\":1,\"b\":[2,3]}", "82a16101a162920203");
+
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "1.5", "ca3fc00000");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "18446744073709551615", "cfffffffffffffffff");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "-1", "d0ff");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "-1", "d3ffffffffffffffff");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "\"a\"", "d90161");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "\"a\"", "da000161");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "[1]", "dc000101");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_OK, "{\"a\":2}", "82a16101a16102");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_EXPECT_VALUE, "", "");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_ROOT_NOT_SINGULAR, "", "0102");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "c1");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "c40100");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "d40100");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "9201");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "a36162");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "cd01");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "ddffffffff");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "cb7ff8000000000000");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_NUMBER_TOO_BIG, "", "cb7ff0000000000000");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_MISS_KEY, "", "810101");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_MISS_KEY, "", "82a16101c0c0");
+    TEST_MSGPACK_DECODE(LEPT_PARSE_INVALID_VALUE, "", "819201c1");
+
+#ifndef LEPT_COMPACT
+    /* A forged array of 2^32 elements has no MessagePack length, it fails before reading any of them */
+    if (sizeof(size_t) > 4) {
+        lept_value v;
+        size_t length = 1;
+        lept_init(&v);
+        v.type = LEPT_ARRAY;
+        v.u.a.e = NULL;
+        v.u.a.size = v.u.a.capacity = (size_t)0xffffffffUL + 1;
+        EXPECT_TRUE(lept_encode_msgpack(&v, &length) == NULL);
+        EXPECT_EQ_SIZE_T(0, length);
+    }
+#endif
+}
+
+/* Examples of RFC 8949 appendix A */
+static void test_cbor() {
+    TEST_CBOR("null", "f6");
+    TEST_CBOR("false", "f4");
+    TEST_CBOR("true", "f5");
+    TEST_CBOR("0", "00");
+    TEST_CBOR("23", "17");
+    TEST_CBOR("24", "1818");
+    TEST_CBOR("100", "1864");
+    TEST_CBOR("1000", "1903e8");
+    TEST_CBOR("1000000", "1a000f4240");
+    TEST_CBOR("1000000000000", "1b000000e8d4a51000");
+    TEST_CBOR("-1", "20");
+    TEST_CBOR("-10", "29");
+    TEST_CBOR("-100", "3863");
+    TEST_CBOR("-1000", "3903e7");
+    TEST_CBOR("-9223372036854775808", "3b7fffffffffffffff");
+    TEST_CBOR("1.1", "fb3ff199999999999a");
+    TEST_CBOR("-0", "fb8000000000000000");
+    TEST_CBOR("\"\"", "60");
+    TEST_CBOR("\"a\"", "6161");
+    TEST_CBOR("\"IETF\"", "6449455446");
+    TEST_CBOR("\"\\\"\\\\\"", "62225c");
+    TEST_CBOR("\"\\u00fc\"", "62c3bc");
+    TEST_CBOR("[]", "80");
+    TEST_CBOR("[1,2,3]", "83010203");
+    TEST_CBOR("[1,[2,3],[4,5]]", "8301820203820405");
+    TEST_CBOR("{}", "a0");
+    TEST_CBOR("{\"a\":1,\"b\":[2,3]}", "a26161016162820203");
+
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "0", "f90000");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "-0", "f98000");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "1", "f93c00");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "1.5", "f93e00");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "65504", "f97bff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "5.960464477539063e-8", "f90001");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "0.00006103515625", "f90400");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "-4", "f9c400");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "100000", "fa47c35000");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "3.4028234663852886e+38", "fa7f7fffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "18446744073709551615", "1bffffffffffffffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "-18446744073709551616", "3bffffffffffffffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "\"streaming\"", "7f657374726561646d696e67ff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "\"\"", "7fff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "[]", "9fff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "[1,[2,3],[4,5]]", "9f018202039f0405ffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "{\"a\":1,\"b\":[2,3]}", "bf61610161629f0203ffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "\"2013-03-21T20:04:00Z\"", "c074323031332d30332d32315432303a30343a30305a");
+    TEST_CBOR_DECODE(LEPT_PARSE_OK, "null", "f7");
+    TEST_CBOR_DECODE(LEPT_PARSE_EXPECT_VALUE, "", "");
+    TEST_CBOR_DECODE(LEPT_PARSE_ROOT_NOT_SINGULAR, "", "0001");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "4161");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "5f4161ff");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "7f4161ff");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "7f6161");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "9f01");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "bf6161");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "1c");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "1f");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "ff");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "f0");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "9bffffffffffffffff");
+    TEST_CBOR_DECODE(LEPT_PARSE_INVALID_VALUE, "", "f97e00");
+    TEST_CBOR_DECODE(LEPT_PARSE_NUMBER_TOO_BIG, "", "f9fc00");
+    TEST_CBOR_DECODE(LEPT_PARSE_NUMBER_TOO_BIG, "", "fa7f800000");
+    TEST_CBOR_DECODE(LEPT_PARSE_MISS_KEY, "", "a10101");
+    TEST_CBOR_DECODE(LEPT_PARSE_MISS_KEY, "", "bf6161010101ff");
+}
+
+/* Long strings, big containers and nesting survive both encodings, cutting the last byte off fails */
+static void test_binary_round_trip() {
+    static const test_encode_func encoders[] = { lept_encode_msgpack, lept_encode_cbor };
+    static const test_decode_func decoders[] = { lept_decode_msgpack, lept_decode_cbor };
+    static const size_t lens[] = { 31, 255, 256, 65535, 65536 };
+    lept_value v, v2, *a, *e;
+    char key[16], *buf;
+    size_t i, k, len;
+
+    lept_init(&v);
+    lept_init(&v2);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v,
+        "{\"a\":[null,false,true,-0.5,1e300,-1e-300,0.1,\"\",\"\\u0000\"],\"o\":{\"\":{}},\"x\":-0}"));
+    a = lept_find_object_value(&v, "a", 1);
+    e = lept_pushback_array_element(a);
+    lept_set_array(e, 0);
+    for (i = 0; i < 70000; i++)
+        lept_set_number(lept_pushback_array_element(e), i % 2 ? -(double)i : (double)i * 1000);
+    buf = (char *)malloc(65536);
+    memset(buf, 'x', 65536);
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+        lept_set_string(lept_pushback_array_element(a), buf, lens[i]);
+    free(buf);
+    e = lept_set_object_value(&v, "big", 3);
+    lept_set_object(e, 0);
+    for (i = 0; i < 300; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_set_string(lept_set_object_value(e, key, strlen(key)), "", 0);
+    }
+    for (k = 0; k < 2; k++) {
+        buf = encoders[k](&v, &len);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, decoders[k](&v2, buf, len));
+        EXPECT_TRUE(lept_is_equal(&v, &v2));
+        lept_free(&v2);
+        EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, decoders[k](&v2, buf, len - 1));
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v2));
+        free(buf);
+    }
+    lept_free(&v);
+
+    /* arrays, maps and tags nested deeper than the limit fail */
+    len = LEPT_PARSE_MAX_DEPTH + 8;
+    buf = (char *)malloc(len);
+    for (k = 0; k < 4; k++) {
+        memset(buf, "\x91\x81\xa1\xc0"[k], len);
+        EXPECT_EQ_INT(LEPT_PARSE_DEPTH_EXCEEDED, decoders[k > 0](&v2, buf, len));
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v2));
+    }
+    free(buf);
+}
+
 static void test_access_null() {
     lept_value v;
     lept_init(&v);
@@ -537,6 +1357,49 @@ static void test_access_string() {
     return;
 }
 
+static void test_access_short_string() {
+    const char *s = "0123456789abcdefghijklmnopqrstuv\0w";
+    char json[64];
+    lept_value v, o, c;
+    size_t len;
+
+    /* strings on both sides of the inline capacity, set and parsed */
+    lept_init(&v);
+    lept_init(&c);
+    for (len = 0; len <= 32; len++) {
+        lept_set_string(&v, s, len);
+        EXPECT_TRUE(memcmp(s, lept_get_string(&v), len) == 0);
+        EXPECT_EQ_INT('\0', lept_get_string(&v)[len]);
+        lept_copy(&c, &v);
+        lept_free(&v);
+        EXPECT_EQ_SIZE_T(len, lept_get_string_length(&c));
+        EXPECT_TRUE(memcmp(s, lept_get_string(&c), len) == 0);
+        sprintf(json, "\"%.*s\"", (int)len, s);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_TRUE(lept_is_equal(&v, &c));
+        lept_free(&v);
+    }
+    lept_set_string(&v, s + 32, 2);
+    EXPECT_EQ_STRING("\0w", lept_get_string(&v), lept_get_string_length(&v));
+    lept_free(&v);
+    lept_free(&c);
+
+    /* keys on both sides of LEPT_KEY_INLINE_SIZE move with their members */
+    lept_init(&o);
+    lept_set_object(&o, 0);
+    for (len = 0; len <= 32; len++)
+        lept_set_number(lept_set_object_value(&o, s, len), (double)len);
+    for (len = 0; len <= 32; len++) {
+        EXPECT_EQ_SIZE_T(len, lept_get_object_key_length(&o, len));
+        EXPECT_TRUE(memcmp(s, lept_get_object_key(&o, len), len) == 0);
+        EXPECT_EQ_DOUBLE((double)len, lept_get_number(lept_find_object_value(&o, s, len)));
+    }
+    lept_remove_object_value(&o, 0);
+    EXPECT_EQ_SIZE_T(32, lept_get_object_key_length(&o, 0));
+    EXPECT_TRUE(lept_find_object_value(&o, s, 0) == NULL);
+    lept_free(&o);
+}
+
 static void test_access_array() {
     lept_value a, e;
     size_t i, j;
@@ -682,22 +1545,836 @@ static void test_access_object() {
     lept_free(&o);
 }
 
+/* Large objects go through the hash index, which must stay in sync with inserts and removals */
+static void test_access_object_index() {
+    lept_value o, o2;
+    char key[16], *json;
+    size_t i, index, n = 1000;
+
+    lept_init(&o);
+    lept_set_object(&o, 0);
+    for (i = 0; i < n; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_set_number(lept_set_object_value(&o, key, strlen(key)), (double)i);
+    }
+    lept_set_number(lept_set_object_value(&o, "k7", 2), 7.5);  /* overwrite, not insert */
+    EXPECT_EQ_SIZE_T(n, lept_get_object_size(&o));
+    for (i = 0; i < n; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        index = lept_find_object_index(&o, key, strlen(key));
+        EXPECT_TRUE(index != LEPT_KEY_NOT_EXIST);
+        EXPECT_EQ_DOUBLE(i == 7 ? 7.5 : (double)i, lept_get_number(lept_get_object_value(&o, index)));
+    }
+    EXPECT_TRUE(lept_find_object_value(&o, "k1000", 5) == NULL);
+
+    lept_init(&o2);
+    lept_copy(&o2, &o);
+    EXPECT_TRUE(lept_is_equal(&o, &o2));
+
+    for (i = 0; i < n; i += 3) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_remove_object_value(&o, lept_find_object_index(&o, key, strlen(key)));
+    }
+    EXPECT_EQ_SIZE_T(n - 334, lept_get_object_size(&o));
+    for (i = 0; i < n; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        EXPECT_EQ_INT(i % 3 != 0, lept_find_object_value(&o, key, strlen(key)) != NULL);
+    }
+    EXPECT_FALSE(lept_is_equal(&o, &o2));
+
+    lept_shrink_object(&o);
+    EXPECT_EQ_SIZE_T(n - 334, lept_get_object_capacity(&o));
+    EXPECT_TRUE(lept_find_object_value(&o, "k1", 2) != NULL);
+    EXPECT_TRUE(lept_find_object_value(&o, "k3", 2) == NULL);
+
+    lept_clear_object(&o);
+    EXPECT_TRUE(lept_find_object_value(&o, "k1", 2) == NULL);
+    lept_free(&o);
+
+    json = lept_stringify(&o2, NULL);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&o, json));
+    EXPECT_TRUE(lept_is_equal(&o, &o2));
+    lept_set_number(lept_set_object_value(&o, "new", 3), 1.0);
+    EXPECT_TRUE(lept_find_object_value(&o, "new", 3) != NULL);
+    EXPECT_TRUE(lept_find_object_value(&o, "k999", 4) != NULL);
+    free(json);
+    lept_free(&o);
+    lept_free(&o2);
+}
+
+static void test_access_symtab() {
+    lept_symtab *st = lept_symtab_new();
+    lept_value v1, v2, *e;
+    const char *json, *id;
+    char key[32];
+    int i;
+
+    /* keys shorter than LEPT_KEY_INLINE_SIZE stay in the members, so these are long */
+    lept_init(&v1);
+    lept_init(&v2);
+    json = "{\"record_identifier\":1,\"record_n\\u0061me_string\":\"a\",\"o\":{\"record_identifier\":2}}";
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_symtab(&v1, json, strlen(json), st));
+    json = "{\"record_name_string\":\"b\",\"record_identifier\":3}";
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_symtab(&v2, json, strlen(json), st));
+    EXPECT_EQ_SIZE_T(2, lept_symtab_size(st));
+    /* every document shares the interned keys */
+    id = lept_symtab_intern(st, "record_identifier", 17);
+    EXPECT_TRUE(lept_get_object_key(&v1, 0) == id);
+    EXPECT_TRUE(lept_get_object_key(&v2, 1) == id);
+    EXPECT_TRUE(lept_get_object_key(&v1, 1) == lept_get_object_key(&v2, 0));
+    EXPECT_TRUE(lept_get_object_key(lept_find_object_value(&v1, "o", 1), 0) == id);
+    EXPECT_EQ_DOUBLE(3.0, lept_get_number(lept_find_object_value(&v2, id, 17)));
+    EXPECT_TRUE(lept_find_object_value(&v2, id, 16) == NULL);
+    EXPECT_EQ_STRING("id", lept_symtab_intern(st, "idx", 2), 2);
+    EXPECT_EQ_SIZE_T(3, lept_symtab_size(st));
+
+    /* interned and owned keys do not mix within an object */
+    lept_set_number(lept_set_object_value_interned(&v2, "interned_field_x", 16, st), 4.0);
+    EXPECT_TRUE(lept_get_object_key(&v2, 2) == lept_symtab_intern(st, "interned_field_x", 16));
+    lept_set_number(lept_set_object_value(&v2, "interned_field_y", 16), 5.0);
+    EXPECT_TRUE(lept_get_object_key(&v2, 1) != id);
+    lept_set_number(lept_set_object_value_interned(&v2, "interned_field_z", 16, st), 6.0);
+    EXPECT_TRUE(lept_get_object_key(&v2, 1) == id);
+    lept_set_number(lept_set_object_value_interned(&v2, "w", 1, st), 7.0);
+    EXPECT_EQ_STRING("w", lept_get_object_key(&v2, 5), 1);
+    lept_remove_object_value(&v2, 0);
+    EXPECT_EQ_SIZE_T(5, lept_get_object_size(&v2));
+    EXPECT_EQ_STRING("w", lept_get_object_key(&v2, 0), 1);
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "interned_member_%d", i);
+        lept_set_number(lept_set_object_value_interned(&v1, key, strlen(key), st), (double)i);
+    }
+    e = lept_find_object_value(&v1, lept_symtab_intern(st, "interned_member_42", 18), 18);
+    EXPECT_EQ_DOUBLE(42.0, lept_get_number(e));
+    EXPECT_EQ_SIZE_T(106, lept_symtab_size(st));
+
+    lept_free(&v1);
+    lept_free(&v2);
+    json = "{\"a\":1,\"b\"}";
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_parse_symtab(&v2, json, strlen(json), st));
+    lept_symtab_free(st);
+}
+
+static lept_value* test_pointer_get(const lept_value *v, const char *pointer) {
+    lept_pointer *ptr = lept_pointer_compile(pointer);
+    lept_value *ret;
+    EXPECT_TRUE(ptr != NULL);
+    ret = lept_pointer_get(v, ptr);
+    lept_pointer_free(ptr);
+    return ret;
+}
+
+static lept_value* test_pointer_set(lept_value *v, const char *pointer) {
+    lept_pointer *ptr = lept_pointer_compile(pointer);
+    lept_value *ret;
+    EXPECT_TRUE(ptr != NULL);
+    ret = lept_pointer_set(v, ptr);
+    lept_pointer_free(ptr);
+    return ret;
+}
+
+static void test_access_pointer() {
+    /* the example of RFC 6901 */
+    static const char json[] = "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,"
+                               "\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8}";
+    static const char *pointers[] = { "/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n" };
+    lept_value v, *e;
+    lept_pointer *ptr;
+    char key[8];
+    int i;
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+    EXPECT_TRUE(test_pointer_get(&v, "") == &v);
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(test_pointer_get(&v, "/foo")));
+    e = test_pointer_get(&v, "/foo/0");
+    EXPECT_EQ_STRING("bar", lept_get_string(e), lept_get_string_length(e));
+    for (i = 0; i < 9; i++)
+        EXPECT_EQ_DOUBLE((double)i, lept_get_number(test_pointer_get(&v, pointers[i])));
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/2") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/-") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/01") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/bar") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/0/x") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/bar") == NULL);
+    EXPECT_TRUE(test_pointer_get(&v, "/foo/99999999999999999999999") == NULL);
+
+    /* set adds members and elements on the way */
+    lept_set_number(test_pointer_set(&v, "/foo/1"), 1.0);
+    lept_set_number(test_pointer_set(&v, "/foo/-"), 2.0);
+    lept_set_number(test_pointer_set(&v, "/foo/3"), 3.0);
+    EXPECT_EQ_SIZE_T(4, lept_get_array_size(test_pointer_get(&v, "/foo")));
+    EXPECT_EQ_DOUBLE(3.0, lept_get_number(test_pointer_get(&v, "/foo/3")));
+    EXPECT_TRUE(test_pointer_set(&v, "/foo/5") == NULL);
+    EXPECT_TRUE(test_pointer_set(&v, "/foo/0/x") == NULL);
+    /* missing members are added as objects, where "-" and numbers are keys */
+    lept_set_boolean(test_pointer_set(&v, "/x/y~1z/0"), 1);
+    EXPECT_EQ_INT(LEPT_TRUE, lept_get_type(test_pointer_get(&v, "/x/y~1z/0")));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_get_type(test_pointer_get(&v, "/x/y~1z")));
+    lept_set_number(test_pointer_set(&v, "/x/-"), 4.0);
+    EXPECT_EQ_DOUBLE(4.0, lept_get_number(lept_find_object_value(test_pointer_get(&v, "/x"), "-", 1)));
+    lept_set_null(test_pointer_set(&v, "/x/y~1z"));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(test_pointer_get(&v, "/x/y~1z")));
+    lept_free(&v);
+
+    /* indexed objects use the precomputed hashes */
+    ptr = lept_pointer_compile("/o/k7");
+    lept_set_object(&v, 0);
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "/o/k%d", i);
+        lept_set_number(test_pointer_set(&v, key), (double)i);
+    }
+    EXPECT_TRUE(64 <= lept_get_object_capacity(test_pointer_get(&v, "/o")));
+    EXPECT_EQ_DOUBLE(7.0, lept_get_number(lept_pointer_get(&v, ptr)));
+    lept_pointer_free(ptr);
+    lept_free(&v);
+
+    EXPECT_TRUE(lept_pointer_compile("a") == NULL);
+    EXPECT_TRUE(lept_pointer_compile("/~2") == NULL);
+    EXPECT_TRUE(lept_pointer_compile("/a~") == NULL);
+}
+
+/* The sizes given in leptjson.h, the API behaves the same for both layouts */
+static void test_access_layout() {
+#ifdef LEPT_COMPACT
+    EXPECT_EQ_SIZE_T(16, sizeof(lept_value));
+    EXPECT_EQ_SIZE_T(sizeof(double), sizeof(((lept_value *)0)->u));
+    EXPECT_EQ_SIZE_T(4, sizeof(((lept_value *)0)->size));
+#else
+    if (sizeof(size_t) == 8)
+        EXPECT_EQ_SIZE_T(32, sizeof(lept_value));
+#endif
+}
+
 static void test_access() {
+    test_access_layout();
     test_access_null();
     test_access_boolean();
     test_access_number();
     test_access_string();
+    test_access_short_string();
     test_access_array();
     test_access_object();
+    test_access_object_index();
+    test_access_pointer();
+    test_access_symtab();
     return;
 }
 
+/* Records the events of the SAX parser as text */
+typedef struct {
+    char trace[256];
+    size_t len;
+    int events, cancel_at;  /* a callback returns 0 when events reaches cancel_at */
+    const char *json;
+    int copied;             /* strings or keys not pointing into json */
+} test_sax_recorder;
+
+static int test_sax_event(void *ctx, const char *s, size_t len) {
+    test_sax_recorder *r = (test_sax_recorder *)ctx;
+    if (r->len + len + 1 < sizeof(r->trace)) {
+        memcpy(r->trace + r->len, s, len);
+        r->len += len;
+        r->trace[r->len++] = ' ';
+        r->trace[r->len] = '\0';
+    }
+    return ++r->events != r->cancel_at;
+}
+
+static int test_sax_null(void *ctx) { return test_sax_event(ctx, "n", 1); }
+static int test_sax_boolean(void *ctx, int b) { return test_sax_event(ctx, b ? "t" : "f", 1); }
+static int test_sax_start_array(void *ctx) { return test_sax_event(ctx, "[", 1); }
+static int test_sax_start_object(void *ctx) { return test_sax_event(ctx, "{", 1); }
+
+static int test_sax_number(void *ctx, double n) {
+    char buf[32];
+    return test_sax_event(ctx, buf, sprintf(buf, "%g", n));
+}
+
+static void test_sax_check_copy(void *ctx, const char *s) {
+    test_sax_recorder *r = (test_sax_recorder *)ctx;
+    if (s < r->json || s > r->json + strlen(r->json))
+        r->copied++;
+}
+
+static int test_sax_string(void *ctx, const char *s, size_t len) {
+    test_sax_check_copy(ctx, s);
+    return test_sax_event(ctx, s, len);
+}
+
+static int test_sax_key(void *ctx, const char *s, size_t len) {
+    char buf[64];
+    memcpy(buf, s, len);
+    buf[len] = ':';
+    test_sax_check_copy(ctx, s);
+    return test_sax_event(ctx, buf, len + 1);
+}
+
+static int test_sax_end_array(void *ctx, size_t count) {
+    char buf[32];
+    return test_sax_event(ctx, buf, sprintf(buf, "]%lu", (unsigned long)count));
+}
+
+static int test_sax_end_object(void *ctx, size_t count) {
+    char buf[32];
+    return test_sax_event(ctx, buf, sprintf(buf, "}%lu", (unsigned long)count));
+}
+
+static const lept_handler test_sax_handler = {
+    test_sax_null, test_sax_boolean, test_sax_number, test_sax_string,
+    test_sax_start_array, test_sax_end_array, test_sax_start_object, test_sax_key, test_sax_end_object
+};
+
+#define TEST_SAX(error, expect, copies, text, cancel)\
+    do {\
+        test_sax_recorder r;\
+        r.len = 0;\
+        r.trace[0] = '\0';\
+        r.events = 0;\
+        r.cancel_at = cancel;\
+        r.json = text;\
+        r.copied = 0;\
+        EXPECT_EQ_INT(error, lept_parse_sax(text, strlen(text), &test_sax_handler, &r));\
+        EXPECT_EQ_STRING(expect, r.trace, r.len);\
+        EXPECT_EQ_INT(copies, r.copied);\
+    } while(0)
+
+static void test_parse_sax() {
+    lept_handler empty;
+    TEST_SAX(LEPT_PARSE_OK, "n ", 0, " null ", 0);
+    TEST_SAX(LEPT_PARSE_OK, "1.5 ", 0, "1.5", 0);
+    TEST_SAX(LEPT_PARSE_OK, "[ ]0 ", 0, "[ ]", 0);
+    TEST_SAX(LEPT_PARSE_OK, "{ }0 ", 0, "{}", 0);
+    TEST_SAX(LEPT_PARSE_OK, "[ n f t -2 abc [ ]0 { }0 ]7 ", 0, "[null,false,true,-2,\"abc\",[],{}]", 0);
+    TEST_SAX(LEPT_PARSE_OK, "{ a: 1 b: [ x { c: n }1 ]2 }2 ", 0, "{\"a\":1,\"b\":[\"x\",{\"c\":null}]}", 0);
+    /* only strings with escapes are copied */
+    TEST_SAX(LEPT_PARSE_OK, "{ a\tb: x\ny }1 ", 2, "{\"a\\tb\":\"x\\ny\"}", 0);
+
+    /* errors after some events, and cancellation by a callback */
+    TEST_SAX(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[ 1 ", 0, "[1 2]", 0);
+    TEST_SAX(LEPT_PARSE_MISS_COLON, "{ a: ", 0, "{\"a\" 1}", 0);
+    TEST_SAX(LEPT_PARSE_ROOT_NOT_SINGULAR, "t ", 0, "true x", 0);
+    TEST_SAX(LEPT_PARSE_CANCELED, "[ 1 ", 0, "[1,2,3]", 2);
+    TEST_SAX(LEPT_PARSE_CANCELED, "{ a: ", 0, "{\"a\":1}", 2);
+    TEST_SAX(LEPT_PARSE_CANCELED, "[ ]0 ", 0, "[]", 2);
+
+    /* missing callbacks accept their events */
+    memset(&empty, 0, sizeof(empty));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_sax("{\"a\":[1,\"b\",null]}", 18, &empty, NULL));
+}
+
+/* Feeds json in chunks of every size, the result must be the same as that of lept_parse_n() */
+static void test_stream_chunks(const char *json) {
+    lept_stream_parser s;
+    lept_value expect, v;
+    size_t len = strlen(json), chunk, i;
+    int ret;
+
+    lept_init(&expect);
+    ret = lept_parse_n(&expect, json, len);
+    for (chunk = 1; chunk <= len + 1; chunk++) {
+        lept_stream_init(&s);
+        for (i = 0; i < len; i += chunk)
+            lept_stream_feed(&s, json + i, len - i < chunk ? len - i : chunk);
+        lept_init(&v);
+        EXPECT_EQ_INT(ret, lept_stream_finish(&s, &v));
+        if (ret == LEPT_PARSE_OK)
+            EXPECT_TRUE(lept_is_equal(&expect, &v));
+        else
+            EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+        lept_free(&v);
+    }
+    lept_free(&expect);
+}
+
+static void test_parse_stream() {
+    static const char *texts[] = {
+        "null", " true ", "false", "0", "-0.5e-3", "123456789012345678901234567890", "\"\"",
+        "\"Hello\\nWorld\"", "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\u0024 \\u00A2 \\u20AC \\uD834\\uDD1E\"",
+        "[ ]", "{ }", "[1,[2,[3]],{\"a\":[]}]",
+        " { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }, \"\\u00e9\\\\\" : \"x\\\"\" } ",
+        "{\"a\":0,\"b\":1,\"c\":2,\"d\":3,\"e\":4,\"f\":5,\"g\":6,\"h\":7,\"i\":8,"
+        "\"j\":9,\"k\":10,\"l\":11,\"m\":12,\"n\":13,\"o\":14,\"p\":15,\"q\":16}",
+        /* errors */
+        "", " ", "nul", "nulx", "nullx", "?", "+0", "01", "1.", "1e", "1e309", "-", "[1,]", "[\"a\", nul]",
+        "[1", "[1 2]", "[", "{", "{1:1}", "{\"a\"", "{\"a\" 1}", "{\"a\":1", "{\"a\":1,}", "{\"a\":1 \"b\"}",
+        "{\"a\":{}", "\"abc", "\"\\v\"", "\"\\", "\"\\u12\"", "\"\\uD800\"", "\"\\uD800\\uE000\"", "\"\x01\"",
+        "null x", "[1]]", "{\"a\\q\":1}"
+    };
+    lept_stream_parser s;
+    lept_value v;
+    char *buf;
+    size_t i;
+    for (i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+        test_stream_chunks(texts[i]);
+    lept_set_parse_max_depth(4);
+    for (i = 4; i <= 5; i++) {
+        buf = test_nested(i, 1);
+        test_stream_chunks(buf);
+        free(buf);
+    }
+    lept_set_parse_max_depth(LEPT_PARSE_MAX_DEPTH);
+
+    /* an error stops parsing, and an abandoned parser can be released */
+    lept_stream_init(&s);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_stream_feed(&s, "[\"abc\", {\"x\":", 13));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_stream_feed(&s, "1 2", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_stream_feed(&s, "}]", 2));
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_stream_finish(&s, &v));
+    lept_stream_init(&s);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_stream_feed(&s, "[\"abc\", {\"x\":[1, \"ab", 20));
+    lept_stream_free(&s);
+}
+
+/* Marks the records seen by lept_parse_ndjson_each(), each callback writes its own byte only */
+typedef struct {
+    char *seen;
+    const char *stop_at;    /* returns 0 for the record at this offset */
+    const char *json;
+} test_ndjson_marks;
+
+static int test_ndjson_mark(void *ctx, size_t offset, int ret, lept_value *v) {
+    test_ndjson_marks *marks = (test_ndjson_marks *)ctx;
+    marks->seen[offset] = ret == LEPT_PARSE_OK && lept_get_type(v) == LEPT_OBJECT ? 1 : 2;
+    return marks->json + offset != marks->stop_at;
+}
+
+static void test_parse_ndjson() {
+    static const int threads[] = { 1, 3, 0 };
+    char *json, *p, *seen;
+    size_t i, n = 20000, len;
+    lept_value v, *e;
+    test_ndjson_marks marks;
+    int t, count;
+
+    json = (char *)malloc(n * 64);
+    for (i = 0, p = json; i < n; i++)
+        p += sprintf(p, i % 1000 == 999 ? "\r\n  \n" : "{\"id\":%lu,\"s\":\"r\\u0065cord\",\"a\":[%lu]}\n", (unsigned long)i, (unsigned long)i);
+    len = p - json;
+    for (t = 0; t < 3; t++) {
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, json, len, threads[t]));
+        EXPECT_EQ_SIZE_T(n - n / 1000, lept_get_array_size(&v));
+        for (i = 0, count = 0; i < lept_get_array_size(&v); i++) {
+            e = lept_get_array_element(&v, i);
+            count += lept_get_number(lept_find_object_value(e, "id", 2)) == (double)(i + i / 999);
+        }
+        EXPECT_EQ_INT((int)(n - n / 1000), count);
+        e = lept_find_object_value(lept_get_array_element(&v, 0), "s", 1);
+        EXPECT_EQ_STRING("record", lept_get_string(e), lept_get_string_length(e));
+        lept_free(&v);
+    }
+
+    /* the first error in input order wins */
+    strchr(json + len / 2, '\n')[1] = '?';
+    strchr(json + len - 80, '\n')[1] = '?';
+    for (t = 0; t < 3; t++) {
+        lept_set_boolean(&v, 1);
+        EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_ndjson(&v, json, len, threads[t]));
+        EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    }
+
+    /* every record reaches the callback, errors included */
+    seen = (char *)malloc(len);
+    marks.seen = seen;
+    marks.json = json;
+    marks.stop_at = NULL;
+    for (t = 0; t < 3; t++) {
+        memset(seen, 0, len);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson_each(json, len, threads[t], test_ndjson_mark, &marks));
+        for (i = 0, count = 0; i < len; i++)
+            count += seen[i] == 1 ? 1 : seen[i] == 2 ? 1000000 : 0;
+        EXPECT_EQ_INT((int)(n - n / 1000 - 2) + 2000000, count);
+    }
+    marks.stop_at = json;
+    EXPECT_EQ_INT(LEPT_PARSE_CANCELED, lept_parse_ndjson_each(json, len, 2, test_ndjson_mark, &marks));
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, "", 0, 0));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, "1\n[2]\n\"3\"", 9, 2));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    lept_free(&v);
+    free(seen);
+    free(json);
+}
+
+static void test_parse_lazy() {
+    static const char json[] = " { \"n\" : null , \"a\" : [ 1, [ \"]\\\"\" ], { \"b\" : {} } ], \"o\" : { \"x\" : [ ] } } ";
+    lept_parse_options options;
+    lept_value v, expect, copy, *a, *e;
+    char *s1, *s2;
+
+    options.flags = LEPT_PARSE_LAZY;
+    options.max_depth = 0;
+    lept_init(&expect);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&expect, json));
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, json, sizeof(json) - 1, &options));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(3, lept_get_object_size(&v));
+    a = lept_find_object_value(&v, "a", 1);
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(a));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(a));
+    e = lept_get_array_element(lept_get_array_element(a, 1), 0);
+    EXPECT_EQ_STRING("]\"", lept_get_string(e), lept_get_string_length(e));
+    /* "o" is still lazy: copies share the text, comparison and stringify expand it */
+    lept_init(&copy);
+    lept_copy(&copy, &v);
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    EXPECT_TRUE(lept_is_equal(&copy, &expect));
+    s1 = lept_stringify(&expect, NULL);
+    s2 = lept_stringify(&copy, NULL);
+    EXPECT_TRUE(strcmp(s1, s2) == 0);
+    free(s1);
+    free(s2);
+    lept_free(&copy);
+    lept_free(&v);
+    lept_free(&expect);
+
+    /* untouched subtrees are only matched, not validated */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, "[1, [?}, {\"a\" 2}]", 17, &options));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    EXPECT_EQ_DOUBLE(1.0, lept_get_number(lept_get_array_element(&v, 0)));
+    e = lept_get_array_element(&v, 1);
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_expand(e));
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(e));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(e));
+    e = lept_get_array_element(&v, 2);
+    EXPECT_EQ_SIZE_T(0, lept_get_object_size(e));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_expand(e));
+    lept_pushback_array_element(&v);
+    EXPECT_EQ_SIZE_T(4, lept_get_array_size(&v));
+    lept_free(&v);
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_ex(&v, "[[1, \"]\"]", 9, &options));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_ex(&v, " {", 2, &options));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_ex(&v, "[] x", 4, &options));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, "[]", 2, &options));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_expand(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_expand(&v));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(&v));
+    lept_free(&v);
+}
+
+static void test_parse_projected() {
+    static const char json[] = "{ \"id\" : 1, \"user\": {\"name\": \"n\", \"age\": 3, \"tags\": [\"a\"]}, "
+        "\"items\": [{\"x\": 1}, {\"x\": 2, \"y\": 0}, {\"x\": 3}], \"bad\": [\"\\q\", 1x, {]], \"n~/\": 4 }";
+    static const char *paths[] = { "/id", "/user/name", "/items/1/x", "/missing/a", "/id/x", "/n~0~1", "/user/name/0" };
+    static const char *all[] = { "/items", "" };
+    lept_value v, expect;
+
+    lept_init(&expect);
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&expect, "{\"id\":1,\"user\":{\"name\":\"n\"},\"items\":[null,{\"x\":2}],\"n~/\":4}"));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_projected(&v, json, paths, 7));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+
+    /* the root path keeps the whole text, which must then be valid */
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_STRING_ESCAPE, lept_parse_projected(&v, json, all, 2));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_projected(&v, json, all, 1));
+    EXPECT_EQ_SIZE_T(1, lept_get_object_size(&v));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(lept_find_object_value(&v, "items", 5)));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_projected(&v, json, NULL, 0));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(0, lept_get_object_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_projected(&v, " [ ] ", paths, 1));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_projected(&v, "\"s\"", paths, 1));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    lept_free(&expect);
+
+    /* errors on the way are those of the parser */
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_parse_projected(&v, "{\"a\" 1}", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, lept_parse_projected(&v, "{\"a\": 1, }", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_projected(&v, "{\"a\": }", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_projected(&v, "[1,]", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parse_projected(&v, "[1,", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_projected(&v, "{\"a\": [1, 2", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_projected(&v, "{\"id\": 1 \"a\"", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_projected(&v, "{\"id\": 1} x", paths, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_projected(&v, "{\"id\": 1x}", paths, 1));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+}
+
+/* The parallel parser must build the same tree as lept_parse_n() and report the same error */
+static void test_parallel_same(const char *json, size_t len, int threads, int depth) {
+    lept_value expect, v;
+    lept_arena arena;
+    int ret;
+    lept_init(&expect);
+    ret = lept_parse_n(&expect, json, len);
+    lept_init(&v);
+    EXPECT_EQ_INT(ret, lept_parse_parallel(&v, json, len, threads, depth, NULL));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+    lept_arena_init(&arena, 0);
+    EXPECT_EQ_INT(ret, lept_parse_parallel(&v, json, len, threads, depth, &arena));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+    lept_arena_free(&arena);
+    lept_free(&expect);
+}
+
+static void test_parse_parallel() {
+    static const char small[] = "{ \"a\" : [ 1, \"x,]\\\"\", [2, {\"b\": []}], {}, null ], \"c\": [[true], [], [\"\\\\\", -0.5] ] }";
+    static const char bad[] = "?],\"\\ {";
+    char *json, *p, *copy;
+    size_t i, j, n = 20000, len;
+    int depth;
+
+    json = (char *)malloc(n * 64 + 2);
+    p = json;
+    *p++ = '[';
+    for (i = 0; i < n; i++)
+        p += sprintf(p, i % 3 == 0 ? "{\"id\":%lu,\"s\":\"]\\\"}\"},\n" : i % 3 == 1 ? "[%lu, \"\\u0065\", []] ," : "%lu,", (unsigned long)i);
+    p[-1] = ']';
+    len = p - json;
+    test_parallel_same(json, len, 1, 1);
+    test_parallel_same(json, len, 4, 1);
+    test_parallel_same(json, len, 0, 2);
+
+    /* the first error in document order wins */
+    json[len / 2] = '?';
+    json[len - 40] = '?';
+    test_parallel_same(json, len, 4, 1);
+    json[len / 2 - 30] = '{';
+    test_parallel_same(json, len, 4, 1);
+    test_parallel_same(json, len - 1, 4, 1);
+    free(json);
+
+    /* every depth, and every single character replaced by one that may break the text */
+    copy = (char *)malloc(sizeof(small));
+    for (depth = 1; depth <= 4; depth++) {
+        test_parallel_same(small, sizeof(small) - 1, 2, depth);
+        for (i = 0; i < sizeof(small) - 1; i++) {
+            for (j = 0; j < sizeof(bad) - 1; j++) {
+                memcpy(copy, small, sizeof(small));
+                copy[i] = bad[j];
+                test_parallel_same(copy, sizeof(small) - 1, 2, depth);
+            }
+            test_parallel_same(small, i, 2, depth);
+        }
+    }
+    free(copy);
+    test_parallel_same("[]", 2, 2, 1);
+    test_parallel_same(" 1 ", 3, 2, 1);
+    test_parallel_same("[ 1 ]", 5, 2, 1);
+    test_parallel_same("[1 2]", 5, 2, 1);
+}
+
+/* Walks a frozen value along the tree of the same text */
+static void test_frozen_same(const lept_frozen *d, size_t f, const lept_value *v) {
+    size_t i, e;
+    EXPECT_EQ_INT(lept_get_type(v), lept_frozen_get_type(d, f));
+    switch (lept_get_type(v)) {
+        case LEPT_TRUE:
+        case LEPT_FALSE:
+            EXPECT_EQ_INT(lept_get_boolean(v), lept_frozen_get_boolean(d, f));
+            break;
+        case LEPT_NUMBER:
+            EXPECT_EQ_DOUBLE(lept_get_number(v), lept_frozen_get_number(d, f));
+            break;
+        case LEPT_STRING:
+            EXPECT_EQ_SIZE_T(lept_get_string_length(v), lept_frozen_get_string_length(d, f));
+            EXPECT_TRUE(memcmp(lept_get_string(v), lept_frozen_get_string(d, f), lept_get_string_length(v) + 1) == 0);
+            break;
+        case LEPT_ARRAY:
+            EXPECT_EQ_SIZE_T(lept_get_array_size(v), lept_frozen_get_array_size(d, f));
+            for (i = 0, e = f + 2; i < lept_get_array_size(v); i++, e = lept_frozen_next(d, e)) {
+                EXPECT_EQ_SIZE_T(e, lept_frozen_get_array_element(d, f, i));
+                test_frozen_same(d, e, lept_get_array_element(v, i));
+            }
+            break;
+        case LEPT_OBJECT:
+            EXPECT_EQ_SIZE_T(lept_get_object_size(v), lept_frozen_get_object_size(d, f));
+            for (i = 0; i < lept_get_object_size(v); i++) {
+                EXPECT_EQ_SIZE_T(lept_get_object_key_length(v, i), lept_frozen_get_object_key_length(d, f, i));
+                EXPECT_TRUE(memcmp(lept_get_object_key(v, i), lept_frozen_get_object_key(d, f, i),
+                    lept_get_object_key_length(v, i) + 1) == 0);
+                test_frozen_same(d, lept_frozen_get_object_value(d, f, i), lept_get_object_value(v, i));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void test_parse_frozen() {
+    static const char *const texts[] = {
+        "null", "-1.5e3", "\"\"", "\"a\\u0000b\"", "[]", "{}",
+        "[null,false,true,123,\"abc\",[1,2,3],{\"k\":[[]]}]",
+        " { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"s\" : \"abc\", "
+        " \"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : { \"\" : [ {} ] } } } "
+    };
+    lept_frozen *d;
+    lept_value v;
+    size_t i, o;
+    const char *json;
+
+    for (i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, texts[i]));
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_frozen(&d, texts[i], strlen(texts[i])));
+        test_frozen_same(d, 0, &v);
+        lept_frozen_free(d);
+        lept_free(&v);
+    }
+
+    json = texts[7];
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_frozen(&d, json, strlen(json)));
+    o = lept_frozen_find_object_value(d, 0, "o", 1);
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_frozen_get_type(d, o));
+    EXPECT_EQ_DOUBLE(2.0, lept_frozen_get_number(d, lept_frozen_find_object_value(d, o, "2", 1)));
+    EXPECT_EQ_SIZE_T(LEPT_KEY_NOT_EXIST, lept_frozen_find_object_value(d, o, "4", 1));
+    EXPECT_EQ_SIZE_T(LEPT_KEY_NOT_EXIST, lept_frozen_find_object_value(d, 0, "", 0));
+    /* the root and its contents end the tape */
+    EXPECT_EQ_SIZE_T(lept_frozen_next(d, o), lept_frozen_next(d, 0));
+    /* a member value is followed by the key of the next member */
+    o = lept_frozen_next(d, lept_frozen_find_object_value(d, 0, "s", 1));
+    EXPECT_EQ_STRING("a", lept_frozen_get_string(d, o), lept_frozen_get_string_length(d, o));
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_frozen_get_type(d, o + 2));
+    lept_frozen_free(d);
+
+    json = "[1,{\"a\":[2,}]";
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_frozen(&d, json, strlen(json)));
+    EXPECT_TRUE(d == NULL);
+    json = "[1] 2";
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_frozen(&d, json, strlen(json)));
+    EXPECT_TRUE(d == NULL);
+}
+
+#define TEST_SNAPSHOT_PATH "leptjson_test.snapshot"
+
+/* The tape of a snapshot follows its header of 8 + 3 words and its count of words */
+#define TEST_SNAPSHOT_TAPE (8 + 4 * sizeof(size_t))
+
+/* A snapshot of len bytes does not open once its tape word i is replaced by (word & mask) + add */
+static void test_snapshot_corrupt(const char *snapshot, size_t len, size_t i, size_t mask, size_t add) {
+    char buf[1024];
+    size_t u;
+    FILE *fp;
+    memcpy(buf, snapshot, len);
+    memcpy(&u, buf + TEST_SNAPSHOT_TAPE + i * sizeof(size_t), sizeof(u));
+    u = (u & mask) + add;
+    memcpy(buf + TEST_SNAPSHOT_TAPE + i * sizeof(size_t), &u, sizeof(u));
+    if ((fp = fopen(TEST_SNAPSHOT_PATH, "wb")) != NULL) {
+        fwrite(buf, 1, len, fp);
+        fclose(fp);
+        EXPECT_TRUE(lept_open_snapshot(TEST_SNAPSHOT_PATH) == NULL);
+    }
+}
+
+static void test_snapshot() {
+    const char *json = "{\"a\":[null,false,true,-0.5,\"\",\"\\u0000\",{\"\":[]}],"
+                       "\"a somewhat longer key\":\"and a somewhat longer string\",\"n\":{\"m\":{}}}";
+    lept_parse_options options;
+    lept_frozen *d;
+    lept_value v, *e;
+    FILE *fp;
+    char buf[64], snapshot[1024];
+    size_t len;
+
+    /* lazy values are expanded on the way */
+    options.flags = LEPT_PARSE_LAZY;
+    options.max_depth = 0;
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ex(&v, json, strlen(json), &options));
+    EXPECT_EQ_INT(1, lept_save_snapshot(&v, TEST_SNAPSHOT_PATH));
+    d = lept_open_snapshot(TEST_SNAPSHOT_PATH);
+    EXPECT_TRUE(d != NULL);
+    if (d != NULL) {
+        test_frozen_same(d, 0, &v);
+        EXPECT_EQ_STRING("and a somewhat longer string",
+            lept_frozen_get_string(d, lept_frozen_find_object_value(d, 0, "a somewhat longer key", 21)),
+            lept_frozen_get_string_length(d, lept_frozen_find_object_value(d, 0, "a somewhat longer key", 21)));
+        lept_close_snapshot(d);
+    }
+
+    /* a corrupted tape is rejected before it is read out of bounds */
+    len = 0;
+    if ((fp = fopen(TEST_SNAPSHOT_PATH, "rb")) != NULL) {
+        len = fread(snapshot, 1, sizeof(snapshot), fp);
+        fclose(fp);
+    }
+    EXPECT_TRUE(len > TEST_SNAPSHOT_TAPE + 8 * sizeof(size_t) && len < sizeof(snapshot));
+    if (len > TEST_SNAPSHOT_TAPE + 8 * sizeof(size_t) && len < sizeof(snapshot)) {
+        test_snapshot_corrupt(snapshot, len, 0, ~(size_t)0, 2 << 3);   /* the root skips past the tape */
+        test_snapshot_corrupt(snapshot, len, 0, 7, 1 << 3);            /* or not past itself */
+        test_snapshot_corrupt(snapshot, len, 1, ~(size_t)0, 1);        /* one member too many */
+        test_snapshot_corrupt(snapshot, len, 1, 0, 2);                 /* or too few */
+        test_snapshot_corrupt(snapshot, len, 2, ~(size_t)7, LEPT_NUMBER);  /* a key that is no string */
+        test_snapshot_corrupt(snapshot, len, 2, ~(size_t)0, 7 - LEPT_STRING);  /* an unknown type */
+        test_snapshot_corrupt(snapshot, len, 2, 7, (size_t)len << 3);  /* a string outside the pool */
+        test_snapshot_corrupt(snapshot, len, 3, 0, len);
+        test_snapshot_corrupt(snapshot, len, 3, 0, 0);                 /* or not null-terminated */
+        test_snapshot_corrupt(snapshot, len, 4, ~(size_t)0, 2 << 3);   /* an array past its parent's member */
+        test_snapshot_corrupt(snapshot, len, 5, ~(size_t)0, 1);
+        snapshot[len - 1] = 'x';                                        /* the last string runs off the pool */
+        test_snapshot_corrupt(snapshot, len, 0, ~(size_t)0, 0);
+    }
+
+    /* the tape is built without recursion */
+    lept_set_array(&v, 1);
+    for (len = 0, e = &v; len < 1000000; len++) {
+        e = lept_pushback_array_element(e);
+        lept_set_array(e, 1);
+    }
+    lept_set_number(lept_pushback_array_element(e), 1.0);
+    EXPECT_EQ_INT(1, lept_save_snapshot(&v, TEST_SNAPSHOT_PATH));
+    d = lept_open_snapshot(TEST_SNAPSHOT_PATH);
+    EXPECT_TRUE(d != NULL);
+    if (d != NULL) {
+        EXPECT_EQ_SIZE_T(2000004, lept_frozen_next(d, 0));
+        EXPECT_EQ_INT(LEPT_ARRAY, lept_frozen_get_type(d, 2000000));
+        EXPECT_EQ_DOUBLE(1.0, lept_frozen_get_number(d, 2000002));
+        lept_close_snapshot(d);
+    }
+    lept_set_string(&v, "", 0);
+    EXPECT_EQ_INT(1, lept_save_snapshot(&v, TEST_SNAPSHOT_PATH));
+    d = lept_open_snapshot(TEST_SNAPSHOT_PATH);
+    EXPECT_TRUE(d != NULL);
+    if (d != NULL) {
+        test_frozen_same(d, 0, &v);
+        lept_close_snapshot(d);
+    }
+
+    /* a truncated snapshot or another file is rejected */
+    if ((fp = fopen(TEST_SNAPSHOT_PATH, "rb")) != NULL) {
+        len = fread(buf, 1, sizeof(buf), fp);
+        fclose(fp);
+        while (len-- > 0) {
+            fp = fopen(TEST_SNAPSHOT_PATH, "wb");
+            fwrite(buf, 1, len, fp);
+            fclose(fp);
+            EXPECT_TRUE(lept_open_snapshot(TEST_SNAPSHOT_PATH) == NULL);
+        }
+    }
+    fp = fopen(TEST_SNAPSHOT_PATH, "wb");
+    fputs(json, fp);
+    fclose(fp);
+    EXPECT_TRUE(lept_open_snapshot(TEST_SNAPSHOT_PATH) == NULL);
+    remove(TEST_SNAPSHOT_PATH);
+    EXPECT_TRUE(lept_open_snapshot(TEST_SNAPSHOT_PATH) == NULL);
+    EXPECT_EQ_INT(0, lept_save_snapshot(&v, "no/such/directory/" TEST_SNAPSHOT_PATH));
+    lept_free(&v);
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
     test_parse_false();
     test_parse_number();
+    test_parse_number_random();
     test_parse_string();
+    test_parse_long_string();
     test_parse_array();
     test_parse_object();
     test_parse_expect_value();
@@ -713,15 +2390,39 @@ static void test_parse() {
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_depth_exceeded();
+    test_parse_n();
+    test_parse_whitespace();
+    test_parse_structural_index();
+    test_parse_insitu();
+    test_parse_arena();
+    test_parse_sax();
+    test_parse_stream();
+    test_parse_ndjson();
+    test_parse_parallel();
+    test_parse_lazy();
+    test_parse_projected();
+    test_parse_frozen();
     return;
 }
 
 int main() {
     test_parse();
+    /* again with the two-stage parser */
+    lept_set_parse_flags(LEPT_PARSE_STRUCTURAL_INDEX);
+    EXPECT_EQ_INT(LEPT_PARSE_STRUCTURAL_INDEX, lept_get_parse_flags());
+    test_parse();
+    lept_set_parse_flags(0);
     test_stringify();
+    test_writer();
+    test_msgpack();
+    test_cbor();
+    test_binary_round_trip();
+    test_snapshot();
     test_access();
     test_equal();
     test_copy();
+    test_copy_deep();
     test_move();
     test_swap();
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);